@@ -4,10 +4,12 @@ namespace roxlu {
 
 
 Shape::Shape() 
-	:density(0.0f)
+	:body(NULL)
+	,density(0.0f)
 	,restitution(0.0f)
 	,friction(0.0f)
 	,body_type_set(false)
+	,index(-1)
 {
 }
 
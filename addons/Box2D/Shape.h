@@ -12,7 +12,7 @@ namespace roxlu {
 class Shape {
 public:
 	Shape();
-	~Shape();
+	virtual ~Shape();
 	
 	virtual void make(b2World& w) = 0;
 	virtual void setRestitution(const float& v);
@@ -27,6 +27,7 @@ public:
 	virtual void addForce(const float& x, const float& y);
 	
 	Vec2 getPosition();
+	float getAngle();
 	
 	b2Body*			body;
 	b2BodyDef		body_def;
@@ -37,6 +38,7 @@ public:
 	float friction;
 	
 	bool body_type_set;
+	int index; // slot in Simulation2D::shapes, used for O(1) removal
 	
 };
 
@@ -83,6 +85,10 @@ inline Vec2 Shape::getPosition() {
 	return Vec2(METERS_TO_PIXELS(p.x), METERS_TO_PIXELS(p.y));
 }
 
+inline float Shape::getAngle() {
+	return body->GetAngle();
+}
+
 // b2_kinematicBody, b2_staticBody, b2_dynamicBody 
  inline void Shape::setBodyType(b2BodyType t) {
 	body_def.type = t;
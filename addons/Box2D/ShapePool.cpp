@@ -0,0 +1,40 @@
+#include "ShapePool.h"
+
+namespace roxlu {
+
+ShapePool::ShapePool(size_t blockSize, size_t blocksPerChunk)
+	:block_size(blockSize)
+	,blocks_per_chunk(blocksPerChunk)
+	,num_allocated(0)
+{
+	// keep every block aligned for doubles/pointers
+	size_t align = sizeof(double) > sizeof(void*) ? sizeof(double) : sizeof(void*);
+	block_size = ((block_size + align - 1) / align) * align;
+}
+
+ShapePool::~ShapePool() {
+	for(vector<char*>::iterator it = chunks.begin(); it != chunks.end(); ++it) {
+		free(*it);
+	}
+	chunks.clear();
+	free_blocks.clear();
+}
+
+void ShapePool::grow() {
+	char* chunk = (char*)malloc(block_size * blocks_per_chunk);
+	chunks.push_back(chunk);
+	free_blocks.reserve(free_blocks.size() + blocks_per_chunk);
+
+	// push in reverse so we hand out blocks in memory order
+	for(int i = blocks_per_chunk - 1; i >= 0; --i) {
+		free_blocks.push_back(chunk + i * block_size);
+	}
+}
+
+void ShapePool::reserve(size_t num) {
+	while(free_blocks.size() < num) {
+		grow();
+	}
+}
+
+} // roxlu
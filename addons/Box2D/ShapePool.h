@@ -0,0 +1,61 @@
+#ifndef ROXLU_BOX2D_SHAPEPOOLH
+#define ROXLU_BOX2D_SHAPEPOOLH
+
+#include <vector>
+#include <stdlib.h>
+
+using std::vector;
+
+/**
+ * Fixed size block allocator for the Box2D shape wrappers.
+ *
+ * Every block is large enough to hold the biggest Shape subclass.
+ * Memory is allocated in chunks of "blocks_per_chunk" blocks and
+ * never returned to the system until the pool is destroyed; released
+ * blocks go onto a free list and are handed out again by allocate().
+ * Use placement new to construct a shape in a block and call its
+ * destructor explicitly before releasing it.
+ *
+ */
+namespace roxlu {
+
+class ShapePool {
+public:
+	ShapePool(size_t blockSize, size_t blocksPerChunk = 256);
+	~ShapePool();
+	void* allocate();
+	void release(void* block);
+	void reserve(size_t num);
+	size_t size(); // number of blocks in use
+private:
+	void grow();
+
+	size_t block_size;
+	size_t blocks_per_chunk;
+	size_t num_allocated;
+	vector<char*> chunks;
+	vector<void*> free_blocks;
+};
+
+inline void* ShapePool::allocate() {
+	if(free_blocks.empty()) {
+		grow();
+	}
+	void* block = free_blocks.back();
+	free_blocks.pop_back();
+	++num_allocated;
+	return block;
+}
+
+inline void ShapePool::release(void* block) {
+	free_blocks.push_back(block);
+	--num_allocated;
+}
+
+inline size_t ShapePool::size() {
+	return num_allocated;
+}
+
+} // roxlu
+
+#endif
@@ -1,7 +1,17 @@
 #include "Simulation2D.h"
+#include <algorithm>
+#include <new>
 
 namespace roxlu {
 
+static size_t simulation2d_max_shape_size() {
+	size_t s = sizeof(Rectangle);
+	s = std::max<size_t>(s, sizeof(Circle));
+	s = std::max<size_t>(s, sizeof(Polygon));
+	s = std::max<size_t>(s, sizeof(Chain));
+	return s;
+}
+
 Simulation2D::Simulation2D()
 	:gravity(0.0f, -10.0f)
 	,world(gravity)
@@ -9,6 +19,7 @@ Simulation2D::Simulation2D()
 	,position_iterations(8)
 	,timestep(1.0f/30.0f)
 //	,pixels_per_meter(100) // 1 meter is 100 pixels
+	,pool(simulation2d_max_shape_size())
 {
 	world.SetDebugDraw(&debug_draw);
 	
@@ -24,18 +35,55 @@ Simulation2D::Simulation2D()
 Simulation2D::~Simulation2D() {
 	vector<Shape*>::iterator it = shapes.begin();
 	while(it != shapes.end()) {
-		delete (*it);
+		(*it)->~Shape();
+		pool.release(*it);
 		++it;
 	}
+	shapes.clear();
 }
 
+// O(1): move the last shape into the slot of the removed one.
 void Simulation2D::destroyShape(Shape* shape) {
-	vector<Shape*>::iterator it = std::find(shapes.begin(), shapes.end(), shape);;
-	if(it != shapes.end()) {
+	if(shape->index < 0 || shape->index >= (int)shapes.size() || shapes[shape->index] != shape) {
+		printf("Simulation2D: shape not part of this simulation.\n");
+		return;
+	}
+	
+	Shape* last = shapes.back();
+	shapes[shape->index] = last;
+	last->index = shape->index;
+	shapes.pop_back();
+	
+	if(shape->body != NULL) {
 		world.DestroyBody(shape->body);
-		shapes.erase(it);
-		delete shape;
 	}
+	shape->~Shape();
+	pool.release(shape);
+}
+
+void Simulation2D::reserve(size_t num) {
+	shapes.reserve(num);
+	if(num > pool.size()) {
+		pool.reserve(num - pool.size());
+	}
+}
+
+size_t Simulation2D::getTransforms(float* result) {
+	float* dest = result;
+	for(vector<Shape*>::iterator it = shapes.begin(); it != shapes.end(); ++it) {
+		b2Body* b = (*it)->body;
+		if(b == NULL) { 
+			dest[0] = dest[1] = dest[2] = 0.0f;
+		}
+		else {
+			const b2Transform& xf = b->GetTransform();
+			dest[0] = METERS_TO_PIXELS(xf.p.x);
+			dest[1] = METERS_TO_PIXELS(xf.p.y);
+			dest[2] = xf.q.GetAngle();
+		}
+		dest += 3;
+	}
+	return shapes.size();
 }
 
 void Simulation2D::update() {
@@ -57,31 +105,47 @@ void Simulation2D::debugDraw(float* viewMatrix, float* projectionMatrix) {
 }
 
 Rectangle* Simulation2D::createRectangle(float x0, float x1, float y0, float y1) {
-	Rectangle* rect = new Rectangle();
+	Rectangle* rect = new (pool.allocate()) Rectangle();
 	rect->setPosition(x0, y0);
 	rect->setSize((x1-x0)*0.5, (y1-y0)*0.5);
-	shapes.push_back(rect);
+	addShape(rect);
 	return rect;
 }
 
+void Simulation2D::createRectangles(const float* rects, size_t num, vector<Rectangle*>& result) {
+	reserve(shapes.size() + num);
+	result.reserve(result.size() + num);
+	for(size_t i = 0; i < num; ++i, rects += 4) {
+		result.push_back(createRectangle(rects[0], rects[1], rects[2], rects[3]));
+	}
+}
+
 Circle* Simulation2D::createCircle(float x, float y, float r) {
-	Circle* c = new Circle();
+	Circle* c = new (pool.allocate()) Circle();
 	c->setPosition(x,y);
 	c->setRadius(r);
-	shapes.push_back(c);
+	addShape(c);
 	return c;
 }
 
+void Simulation2D::createCircles(const float* circles, size_t num, vector<Circle*>& result) {
+	reserve(shapes.size() + num);
+	result.reserve(result.size() + num);
+	for(size_t i = 0; i < num; ++i, circles += 3) {
+		result.push_back(createCircle(circles[0], circles[1], circles[2]));
+	}
+}
+
 // ALWAYS USE COUNTER CLOCKWISE VERTICES, MAX 8 VERTICES, SEE maxPolygonVertices
 Polygon* Simulation2D::createPolygon() {
-	Polygon* p = new Polygon();
-	shapes.push_back(p);
+	Polygon* p = new (pool.allocate()) Polygon();
+	addShape(p);
 	return p;
 }
 
 Chain* Simulation2D::createChain() {
-	Chain* c = new Chain();
-	shapes.push_back(c);
+	Chain* c = new (pool.allocate()) Chain();
+	addShape(c);
 	return c;
 }
 
@@ -11,6 +11,7 @@
 #include "Polygon.h"
 #include "Chain.h"
 #include "Utils.h"
+#include "ShapePool.h"
 
 using std::vector;
 
@@ -27,8 +28,17 @@ public:
 	Polygon* createPolygon();
 	Chain* createChain(); 
 	
+	// batched creation; rects: [x0,x1,y0,y1, ...], circles: [x,y,r, ...]
+	void createRectangles(const float* rects, size_t num, vector<Rectangle*>& result);
+	void createCircles(const float* circles, size_t num, vector<Circle*>& result);
+	void reserve(size_t num);
+	
 	void destroyShape(Shape* shape);
 	
+	// writes [x,y,angle] (pixels, radians) for every shape, in the order of "shapes"; shape->index is the slot.
+	size_t getTransforms(vector<float>& result);
+	size_t getTransforms(float* result);
+	
 //	void setPixelsPerMeter(const float& ppm);
 	void debugDraw(float* viewMatrix, float* projectionMatrix);
 	
@@ -41,7 +51,23 @@ public:
 	
 	vector<Shape*> shapes;
 //	float pixels_per_meter;
+private:
+	void addShape(Shape* shape);
+	ShapePool pool;
 };
+
+inline void Simulation2D::addShape(Shape* shape) {
+	shape->index = shapes.size();
+	shapes.push_back(shape);
+}
+
+inline size_t Simulation2D::getTransforms(vector<float>& result) {
+	result.resize(shapes.size() * 3);
+	if(shapes.empty()) {
+		return 0;
+	}
+	return getTransforms(&result[0]);
+}
 //
 //inline void Simulation2D::setPixelsPerMeter(const float& ppm) {
 //	pixels_per_meter = ppm;
@@ -1,14 +1,24 @@
 #include "Database.h"
+#include <string.h>
 
 namespace roxlu  {
 
 Database::Database()
 	:file("")
+	,db(NULL)
 	,opened(false)
+	,writer(NULL)
+	,max_statements(32)
+	,statement_counter(0)
 {
 }
 
 Database::~Database() {
+	stopWriter();
+	clearStatementCache();
+	if(opened) {
+		sqlite3_close(db);
+	}
 }
 
 //http://icculus.org/~chunky/stuff/sqlite3_example/sqlite3_example_bind.c
@@ -28,6 +38,10 @@ bool Database::query(const string& sql) {
 		printf("Warning query(): db not opened\n");
 		return false;
 	}
+	if(writer) {
+		QueryParams no_params;
+		return writer->execute(sql, no_params, QUERY_RAW);
+	}
 	sqlite3_stmt* statement;
 	if (SQLITE_OK != sqlite3_prepare_v2(db, sql.c_str(),-1, &statement, 0)) {
 		printf("Error: %s with: %s\n", sqlite3_errmsg(db), sql.c_str());
@@ -41,14 +55,28 @@ bool Database::query(const string& sql) {
 	return true;
 }
 
+// In async mode the writer creates the transactions.
 bool Database::beginTransaction() {
+	if(writer) {
+		return true;
+	}
 	return (SQLITE_OK == sqlite3_exec(db, "BEGIN TRANSACTION", 0, 0, 0));
 }
 
 bool Database::endTransaction() {
+	if(writer) {
+		return true;
+	}
 	return (SQLITE_OK == sqlite3_exec(db, "COMMIT", 0, 0, 0));
 }
 
+bool Database::rollbackTransaction() {
+	if(writer) {
+		return false;
+	}
+	return (SQLITE_OK == sqlite3_exec(db, "ROLLBACK", 0, 0, 0));
+}
+
 int Database::lastInsertID() {
 	return sqlite3_last_insert_rowid(db);
 }
@@ -58,6 +86,11 @@ QueryInsert Database::insert(const string& table) {
 	return insert;
 }
 
+QueryBulkInsert Database::bulkInsert(const string& table) {
+	QueryBulkInsert bulk(*this, table);
+	return bulk;
+}
+
 QuerySelect Database::select(const string& selectFields) {
 	QuerySelect select(*this, selectFields);
 	return select;
@@ -94,56 +127,245 @@ bool Database::prepare(const string& sql, sqlite3_stmt** stmt) {
 
 // Bind values in given QueryParams
 bool Database::bind(const vector<QueryParam*>& params, sqlite3_stmt** stmt, int queryType) {
-	vector<QueryParam*>::const_iterator it = params.begin();
-	//printf("bind count: %d\n", sqlite3_bind_parameter_count(*stmt));
-	while(it != params.end()) {
-		QueryParam* qp = (*it);
-		int parameter_index = sqlite3_bind_parameter_index(*stmt, qp->getBindName().c_str());
-		
-		// sqlite quirk, the index count sometimes start at 1 depending on query
-		/*
-			Wierd: sometimes I need index +1 sometimes not....
-		queryType == QUERY_SELECT
-			||
-		*/
-		
-		if( queryType == QUERY_DELETE 
-		)
-		{
-			parameter_index += 1; 
+	// cached statements remember the indices of the parameters.
+	DatabaseStatement* cached = NULL;
+	map<sqlite3_stmt*, DatabaseStatement*>::iterator cit = statement_handles.find(*stmt);
+	if(cit != statement_handles.end()) {
+		cached = cit->second;
+		if(cached->bind_fields.size() != params.size()) {
+			cached->bind_fields.assign(params.size(), "");
+			cached->bind_indices.assign(params.size(), 0);
+		}
+	}
+	
+	for(size_t i = 0; i < params.size(); ++i) {
+		QueryParam* qp = params[i];
+		if(qp->getType() != QueryParam::SQL_PARAM_TEXT) {
+			continue;
 		}
 		
-		switch(qp->getType()) {
+		int parameter_index = 0;
+		if(cached && cached->bind_indices[i] && cached->bind_fields[i] == qp->getField()) {
+			parameter_index = cached->bind_indices[i];
+		}
+		else {
+			parameter_index = sqlite3_bind_parameter_index(*stmt, qp->getBindName().c_str());
 		
-			// TEXT
-			// ---------------
-			case QueryParam::SQL_PARAM_TEXT: {
-				//printf("bind: %s,  %s, %d\n",qp->getBindName().c_str(), qp->getValue().c_str(), parameter_index);
-				int result = sqlite3_bind_text(
-									 *stmt
-									,parameter_index
-									,qp->getValue().c_str()
-									,-1
-									,SQLITE_TRANSIENT
-								);
-							
-				if(result != SQLITE_OK) {
-					printf("Error: cannot bind: %s(%d) =  %s\n", qp->getField().c_str(),parameter_index, sqlite3_errmsg(db));
-					return false;
-				}
-				break;
+			// sqlite quirk, the index count sometimes start at 1 depending on query
+			/*
+				Wierd: sometimes I need index +1 sometimes not....
+			queryType == QUERY_SELECT
+				||
+			*/
+			
+			if( queryType == QUERY_DELETE 
+			)
+			{
+				parameter_index += 1; 
 			}
-				
-			default: {
-				break;
+			if(cached) {
+				cached->bind_fields[i] = qp->getField();
+				cached->bind_indices[i] = parameter_index;
 			}
 		}
+		
+		// TEXT
+		// ---------------
+		//printf("bind: %s,  %s, %d\n",qp->getBindName().c_str(), qp->getValue().c_str(), parameter_index);
+		const string& value = qp->getValue();
+		int result = sqlite3_bind_text(
+							 *stmt
+							,parameter_index
+							,value.c_str()
+							,value.size()
+							,SQLITE_TRANSIENT
+						);
+					
+		if(result != SQLITE_OK) {
+			printf("Error: cannot bind: %s(%d) =  %s\n", qp->getField().c_str(),parameter_index, sqlite3_errmsg(db));
+			return false;
+		}
+	}
+	return true;
+}
+
+// Executes an insert or delete.
+bool Database::execute(const string& sql, QueryParams& params, int queryType) {
+	if(writer) {
+		return writer->execute(sql, params, queryType);
+	}
+	sqlite3_stmt* stmt = acquireStatement(sql);
+	if(!stmt) {
+		return false;
+	}
+	
+	if(!bind(params.getParams(), &stmt, queryType)) {
+		releaseStatement(stmt);
+		return false;
+	}
+		
+	if(sqlite3_step(stmt) != SQLITE_DONE) {
+		printf("error: %s\n", sqlite3_errmsg(db));
+		releaseStatement(stmt);
+		return false;
+	}
+	releaseStatement(stmt);
+	return true;
+}
+
+// Only used in async mode, see QueryBulkInsert::execute().
+bool Database::executeBulk(QueryBulkInsert& bulk) {
+	if(!writer) {
+		return bulk.execute();
+	}
+	return writer->executeBulk(bulk);
+}
+
+// Calls the listener with the result; in async mode on the writer thread.
+bool Database::executeSelect(const string& sql, QueryParams& params, IDatabaseSelectListener* listener) {
+	if(writer) {
+		return writer->executeSelect(sql, params, listener);
+	}
+	QueryResult result(*this);
+	if(!result.execute(sql, params, QUERY_SELECT)) {
+		return false;
+	}
+	if(listener) {
+		listener->onSelectResult(result);
+	}
+	return true;
+}
 
-		++it;
+// Async mode
+// -----------------------------------------------------------------------------
+bool Database::startWriter(const DatabaseWriterSettings& settings) {
+	if(!opened) {
+		printf("Warning startWriter(): db not opened\n");
+		return false;
+	}
+	if(writer) {
+		return true;
+	}
+	sqlite3_busy_timeout(db, settings.busy_timeout_millis);
+	writer = new DatabaseWriter();
+	if(!writer->start(file, settings)) {
+		delete writer;
+		writer = NULL;
+		return false;
 	}
 	return true;
 }
 
+void Database::stopWriter() {
+	if(!writer) {
+		return;
+	}
+	writer->stop();
+	delete writer;
+	writer = NULL;
+}
+
+bool Database::flush() {
+	if(!writer) {
+		return true;
+	}
+	return writer->flush();
+}
+
+void Database::getWriterStats(DatabaseWriterStats& stats) {
+	if(!writer) {
+		memset(&stats, 0, sizeof(stats));
+		return;
+	}
+	writer->getStats(stats);
+}
+
+// Statement cache
+// -----------------------------------------------------------------------------
+
+// Returns a prepared statement for the sql, from the cache when we have one.
+// When the cached statement is still in use (e.g. by a QueryResult) we
+// prepare a new one which is finalized by releaseStatement().
+sqlite3_stmt* Database::acquireStatement(const string& sql) {
+	if(!opened) {
+		printf("Warning acquireStatement(): db not opened\n");
+		return NULL;
+	}
+	map<string, DatabaseStatement*>::iterator it = statements.find(sql);
+	if(it != statements.end() && !it->second->in_use) {
+		it->second->in_use = true;
+		it->second->last_used = ++statement_counter;
+		return it->second->stmt;
+	}
+	
+	sqlite3_stmt* stmt = NULL;
+	if(!prepare(sql, &stmt)) {
+		sqlite3_finalize(stmt);
+		return NULL;
+	}
+	if(it != statements.end() || !max_statements) {
+		return stmt;
+	}
+	
+	DatabaseStatement* cached = new DatabaseStatement();
+	cached->sql = sql;
+	cached->stmt = stmt;
+	cached->in_use = true;
+	cached->last_used = ++statement_counter;
+	statements[sql] = cached;
+	statement_handles[stmt] = cached;
+	trimStatementCache();
+	return stmt;
+}
+
+// Resets the statement so it can be used again.
+void Database::releaseStatement(sqlite3_stmt* stmt) {
+	if(!stmt) {
+		return;
+	}
+	map<sqlite3_stmt*, DatabaseStatement*>::iterator it = statement_handles.find(stmt);
+	if(it == statement_handles.end()) {
+		sqlite3_finalize(stmt);
+		return;
+	}
+	sqlite3_reset(stmt);
+	sqlite3_clear_bindings(stmt);
+	it->second->in_use = false;
+	trimStatementCache();
+}
+
+void Database::setMaxCachedStatements(size_t num) {
+	max_statements = num;
+	trimStatementCache();
+}
+
+void Database::clearStatementCache() {
+	size_t max = max_statements;
+	max_statements = 0;
+	trimStatementCache();
+	max_statements = max;
+}
+
+// Finalizes the least recently used statements which are not in use.
+void Database::trimStatementCache() {
+	while(statements.size() > max_statements) {
+		map<string, DatabaseStatement*>::iterator oldest = statements.end();
+		for(map<string, DatabaseStatement*>::iterator it = statements.begin(); it != statements.end(); ++it) {
+			if(!it->second->in_use && (oldest == statements.end() || it->second->last_used < oldest->second->last_used)) {
+				oldest = it;
+			}
+		}
+		if(oldest == statements.end()) {
+			break;
+		}
+		DatabaseStatement* cached = oldest->second;
+		statement_handles.erase(cached->stmt);
+		statements.erase(oldest);
+		sqlite3_finalize(cached->stmt);
+		delete cached;
+	}
+}
+
 void Database::printCompileInfo() {
 	sqlite3_stmt* st;
 	if (SQLITE_OK == sqlite3_prepare_v2(db, "PRAGMA compile_options", -1, &st, NULL)) {
@@ -3,24 +3,41 @@
 
 #include <vector>
 #include <string>
+#include <map>
+#include <stdint.h>
 #include "sqlite3.h"
 #include "QueryInsert.h"
+#include "QueryBulkInsert.h"
 #include "QuerySelect.h"
 #include "QueryDelete.h"
 #include "QueryParam.h"
 #include "QueryParams.h"
+#include "DatabaseWriter.h"
 
 using std::string;
 using std::vector;
+using std::map;
 
 namespace roxlu {
 
+// A prepared statement in the statement cache of Database. The bind
+// indices for the parameter names are resolved once per statement.
+struct DatabaseStatement {
+	string sql;
+	sqlite3_stmt* stmt;
+	bool in_use;
+	uint64_t last_used;
+	vector<string> bind_fields;
+	vector<int> bind_indices;
+};
+
 class Database {
 public:
 	enum QueryTypes {
  		 QUERY_INSERT
 		,QUERY_SELECT
 		,QUERY_DELETE
+		,QUERY_RAW
 	};
 	
 	Database();
@@ -30,7 +47,9 @@ public:
 	int lastInsertID();
 	bool beginTransaction();
 	bool endTransaction();
+	bool rollbackTransaction();
 	QueryInsert insert(const string& table);
+	QueryBulkInsert bulkInsert(const string& table);
 	QuerySelect	select(const string& selectFields);
 	QuerySelect select();
 	QueryDelete remove();
@@ -38,12 +57,35 @@ public:
 	
 	bool prepare(const string& sql, sqlite3_stmt** stmt);
 	bool bind(const vector<QueryParam*>& params, sqlite3_stmt** stmt, int queryType);
+	bool execute(const string& sql, QueryParams& params, int queryType); // insert/delete, queued in async mode
+	bool executeBulk(QueryBulkInsert& bulk);
+	bool executeSelect(const string& sql, QueryParams& params, IDatabaseSelectListener* listener);
+	
+	bool startWriter(const DatabaseWriterSettings& settings = DatabaseWriterSettings()); // async mode
+	void stopWriter(); // writes everything which is queued
+	bool flush(); // blocks until all queued operations are committed
+	bool isAsync();
+	void getWriterStats(DatabaseWriterStats& stats);
+	
+	sqlite3_stmt* acquireStatement(const string& sql); // from the statement cache, call releaseStatement() when ready
+	void releaseStatement(sqlite3_stmt* stmt);
+	void setMaxCachedStatements(size_t num);
+	void clearStatementCache(); // finalizes the statements which are not in use
 	sqlite3* getDB();
 	void printCompileInfo();
 private:
+	Database(const Database& other); // not copyable: owns the connection, cache and writer
+	Database& operator=(const Database& other);
+	void trimStatementCache();
+
 	string file;
 	sqlite3* db;
 	bool opened;
+	DatabaseWriter* writer;
+	map<string, DatabaseStatement*> statements; // cache, by sql
+	map<sqlite3_stmt*, DatabaseStatement*> statement_handles; // cached statements by handle
+	size_t max_statements;
+	uint64_t statement_counter; // for last_used
 };
 
 
@@ -51,6 +93,10 @@ inline sqlite3* Database::getDB() {
 	return db;
 }
 
+inline bool Database::isAsync() {
+	return writer != NULL;
+}
+
 /*
 db.open("test.db");
 	db.query("CREATE TABLE IF NOT EXISTS scores (" \
@@ -97,6 +143,36 @@ db.open("test.db");
 			cout << result.getString(0) << endl;
 		}
 	}
+	
+	
+	// Many rows at once; one transaction and one prepared statement.
+	QueryBulkInsert bulk = db.bulkInsert("scores").fields("time,score,name");
+	for(int i = 0; i < 10000; ++i) {
+		bulk.use("now").use(i).use("diederick");
+	}
+	bulk.execute();
+	
+	
+	Statements are cached by their sql (the values are bound, so the sql of 
+	the same query with other values is the same). The cache keeps the last
+	used 32 statements, see setMaxCachedStatements().
+	
+	
+	Async mode:
+	-----------
+	After startWriter() all inserts, deletes, bulk inserts and query() calls
+	are queued and executed by a writer thread in batched transactions, see
+	DatabaseWriter. Selects with a QueryResult still run right away on this 
+	connection (with WAL they don't wait for the writer) but don't see the 
+	queued operations until they are committed; call flush() when you need
+	that. begin/endTransaction() are ignored in async mode.
+	
+	db.open("events.db");
+	db.query("CREATE TABLE IF NOT EXISTS ...");
+	db.startWriter();
+	...
+	db.insert("events").use("name", "click").execute(); // never waits for the disk
+	db.select("count(*)").from("events").execute(&listener); // onSelectResult() on the writer thread
 */
 
 } // roxlu 
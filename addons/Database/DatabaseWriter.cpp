@@ -0,0 +1,410 @@
+#include "DatabaseWriter.h"
+#include "Database.h"
+#include <sys/time.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <sched.h>
+
+namespace roxlu {
+
+DatabaseWriterSettings::DatabaseWriterSettings()
+	:journal_mode("WAL")
+	,synchronous("NORMAL")
+	,max_batch_ops(1000)
+	,max_batch_millis(50)
+	,max_queued(0)
+	,busy_timeout_millis(1000)
+{
+}
+
+DatabaseOperation::DatabaseOperation()
+	:type(DB_OP_EXECUTE)
+	,query_type(0)
+	,bulk(NULL)
+	,listener(NULL)
+	,next(NULL)
+{
+}
+
+DatabaseOperation::~DatabaseOperation() {
+	delete bulk;
+}
+
+// -----------------------------------------------------------------------------
+
+DatabaseWriter::DatabaseWriter()
+	:db(NULL)
+	,started(false)
+	,running(false)
+	,num_adding(0)
+	,head(&stub)
+	,tail(&stub)
+	,sleeping(0)
+	,num_flush_requests(0)
+	,num_flushed(0)
+	,in_transaction(false)
+	,batch_start(0)
+	,batch_ops(0)
+{
+	memset(&stats, 0, sizeof(stats));
+	pthread_mutex_init(&mutex, NULL);
+	pthread_cond_init(&wake_cond, NULL);
+	pthread_mutex_init(&flush_mutex, NULL);
+	pthread_cond_init(&flush_cond, NULL);
+}
+
+DatabaseWriter::~DatabaseWriter() {
+	stop();
+
+	// stop() executes everything which was queued; this is just a safety net
+	DatabaseOperation* op = NULL;
+	while((op = pop())) {
+		delete op;
+	}
+	pthread_cond_destroy(&flush_cond);
+	pthread_mutex_destroy(&flush_mutex);
+	pthread_cond_destroy(&wake_cond);
+	pthread_mutex_destroy(&mutex);
+}
+
+bool DatabaseWriter::start(const string& filepath, const DatabaseWriterSettings& writerSettings) {
+	if(started) {
+		return true;
+	}
+	settings = writerSettings;
+	db = new Database();
+	if(!db->open(filepath)) {
+		delete db;
+		db = NULL;
+		return false;
+	}
+	sqlite3_busy_timeout(db->getDB(), settings.busy_timeout_millis);
+	if(settings.journal_mode.size()) {
+		db->query("PRAGMA journal_mode=" +settings.journal_mode);
+	}
+	if(settings.synchronous.size()) {
+		db->query("PRAGMA synchronous=" +settings.synchronous);
+	}
+
+	running = true;
+	if(pthread_create(&thread, NULL, &DatabaseWriter::threadFunction, this) != 0) {
+		printf("DatabaseWriter: cannot create thread.\n");
+		running = false;
+		delete db;
+		db = NULL;
+		return false;
+	}
+	started = true;
+	return true;
+}
+
+void DatabaseWriter::stop() {
+	if(!started) {
+		return;
+	}
+	pthread_mutex_lock(&mutex);
+	running = false;
+	pthread_cond_signal(&wake_cond);
+	pthread_mutex_unlock(&mutex);
+	pthread_join(thread, NULL);
+
+	// add() rejects operations from now on; execute the ones which were
+	// pushed by producers that passed their check just before we stopped.
+	while(num_adding) {
+		sched_yield();
+	}
+	run();
+	started = false;
+	delete db;
+	db = NULL;
+
+	// wake up the threads which wait in flush()
+	pthread_mutex_lock(&flush_mutex);
+	num_flushed = num_flush_requests;
+	pthread_cond_broadcast(&flush_cond);
+	pthread_mutex_unlock(&flush_mutex);
+}
+
+bool DatabaseWriter::execute(const string& sql, QueryParams& params, int queryType) {
+	DatabaseOperation* op = new DatabaseOperation();
+	op->type = DB_OP_EXECUTE;
+	op->query_type = queryType;
+	op->sql = sql;
+	op->params = params;
+	if(!add(op)) {
+		delete op;
+		return false;
+	}
+	return true;
+}
+
+bool DatabaseWriter::executeBulk(QueryBulkInsert& bulk) {
+	if(!started) {
+		printf("DatabaseWriter: not started.\n");
+		return false;
+	}
+	DatabaseOperation* op = new DatabaseOperation();
+	op->type = DB_OP_BULK_INSERT;
+	op->bulk = new QueryBulkInsert(*db, "");
+	op->bulk->swap(bulk);
+	if(!add(op)) {
+		bulk.swap(*op->bulk); // the caller keeps the rows
+		delete op;
+		return false;
+	}
+	return true;
+}
+
+bool DatabaseWriter::executeSelect(const string& sql, QueryParams& params, IDatabaseSelectListener* listener) {
+	DatabaseOperation* op = new DatabaseOperation();
+	op->type = DB_OP_SELECT;
+	op->query_type = Database::QUERY_SELECT;
+	op->sql = sql;
+	op->params = params;
+	op->listener = listener;
+	if(!add(op)) {
+		delete op;
+		return false;
+	}
+	return true;
+}
+
+bool DatabaseWriter::flush() {
+	if(!started) {
+		return true;
+	}
+	DatabaseOperation* op = new DatabaseOperation();
+	op->type = DB_OP_FLUSH;
+	// the flush numbers must be queued in order, so push while locked;
+	// a flush is never rejected.
+	pthread_mutex_lock(&flush_mutex);
+	__sync_add_and_fetch(&num_adding, 1);
+	if(!running) {
+		// stop() commits everything
+		__sync_fetch_and_sub(&num_adding, 1);
+		pthread_mutex_unlock(&flush_mutex);
+		delete op;
+		return true;
+	}
+	int flush_number = ++num_flush_requests;
+	op->query_type = flush_number;
+	__sync_fetch_and_add(&stats.num_queued, 1);
+	push(op);
+	__sync_fetch_and_sub(&num_adding, 1);
+
+	while(num_flushed < flush_number) {
+		pthread_cond_wait(&flush_cond, &flush_mutex);
+	}
+	pthread_mutex_unlock(&flush_mutex);
+	return true;
+}
+
+// The stats are written by the writer thread, so they can be a bit behind.
+void DatabaseWriter::getStats(DatabaseWriterStats& result) {
+	__sync_synchronize();
+	result = stats;
+}
+
+// -----------------------------------------------------------------------------
+
+// The caller deletes the operation when we return false.
+bool DatabaseWriter::add(DatabaseOperation* op) {
+	__sync_add_and_fetch(&num_adding, 1);
+	if(!started || !running) {
+		__sync_fetch_and_sub(&num_adding, 1);
+		printf("DatabaseWriter: not started.\n");
+		return false;
+	}
+	size_t num = __sync_add_and_fetch(&stats.num_queued, 1);
+	if(settings.max_queued && num > settings.max_queued) {
+		__sync_fetch_and_sub(&stats.num_queued, 1);
+		__sync_fetch_and_add(&stats.num_rejected, 1);
+		__sync_fetch_and_sub(&num_adding, 1);
+		return false;
+	}
+	push(op);
+	__sync_fetch_and_sub(&num_adding, 1);
+	return true;
+}
+
+// Wakes up the writer thread when it sleeps; the writer sets `sleeping`
+// before it checks the queue for the last time, so we can't miss it.
+void DatabaseWriter::push(DatabaseOperation* op) {
+	op->next = NULL;
+	__sync_synchronize();
+	DatabaseOperation* prev = __sync_lock_test_and_set(&head, op);
+	prev->next = op;
+	__sync_synchronize();
+	if(sleeping) {
+		pthread_mutex_lock(&mutex);
+		pthread_cond_signal(&wake_cond);
+		pthread_mutex_unlock(&mutex);
+	}
+}
+
+// Only called by the consumer. Returns NULL when the queue is empty or
+// when a producer is between its exchange and setting `next`.
+DatabaseOperation* DatabaseWriter::pop() {
+	DatabaseOperation* t = tail;
+	DatabaseOperation* next = t->next;
+	if(t == &stub) {
+		if(!next) {
+			return NULL;
+		}
+		tail = next;
+		t = next;
+		next = next->next;
+	}
+	if(next) {
+		__sync_synchronize();
+		tail = next;
+		return t;
+	}
+	if(t != head) {
+		return NULL;
+	}
+	push(&stub);
+	next = t->next;
+	if(next) {
+		__sync_synchronize();
+		tail = next;
+		return t;
+	}
+	return NULL;
+}
+
+// Only called by the consumer; false while a producer is adding.
+bool DatabaseWriter::isEmpty() {
+	return tail == &stub && !stub.next && head == &stub;
+}
+
+// -----------------------------------------------------------------------------
+
+void* DatabaseWriter::threadFunction(void* user) {
+	DatabaseWriter* writer = static_cast<DatabaseWriter*>(user);
+	writer->run();
+	return NULL;
+}
+
+uint64_t DatabaseWriter::now() {
+	timeval time;
+	gettimeofday(&time, NULL);
+	return uint64_t(time.tv_sec) * 1000000 + time.tv_usec;
+}
+
+void DatabaseWriter::run() {
+	uint64_t batch_micros = settings.max_batch_millis * 1000;
+	while(true) {
+		DatabaseOperation* op = pop();
+		if(op) {
+			size_t num = __sync_fetch_and_sub(&stats.num_queued, 1);
+			if(num > stats.max_num_queued) {
+				stats.max_num_queued = num;
+			}
+			if(op->type == DB_OP_FLUSH) {
+				commit();
+				pthread_mutex_lock(&flush_mutex);
+				num_flushed = std::max<int>(num_flushed, op->query_type);
+				pthread_cond_broadcast(&flush_cond);
+				pthread_mutex_unlock(&flush_mutex);
+				delete op;
+				continue;
+			}
+
+			if(!in_transaction) {
+				in_transaction = db->beginTransaction();
+				batch_start = now();
+				batch_ops = 0;
+			}
+			if(!executeOperation(op)) {
+				++stats.num_errors;
+			}
+			++stats.num_executed;
+			delete op;
+			if(++batch_ops >= settings.max_batch_ops || now() - batch_start >= batch_micros) {
+				commit();
+			}
+			continue;
+		}
+
+		uint64_t timeout = 100000;
+		if(in_transaction) {
+			uint64_t age = now() - batch_start;
+			if(age >= batch_micros) {
+				commit();
+			}
+			else {
+				timeout = batch_micros - age;
+			}
+		}
+		if(!running) {
+			commit();
+			if(isEmpty()) {
+				break;
+			}
+			continue;
+		}
+
+		// sleep until we get work, or the transaction must be committed.
+		pthread_mutex_lock(&mutex);
+		__sync_lock_test_and_set(&sleeping, 1);
+		__sync_synchronize();
+		if(isEmpty() && running) {
+			uint64_t wake_at = now() + timeout;
+			timespec ts;
+			ts.tv_sec = wake_at / 1000000;
+			ts.tv_nsec = (wake_at % 1000000) * 1000;
+			pthread_cond_timedwait(&wake_cond, &mutex, &ts);
+		}
+		__sync_lock_release(&sleeping);
+		pthread_mutex_unlock(&mutex);
+	}
+}
+
+bool DatabaseWriter::executeOperation(DatabaseOperation* op) {
+	switch(op->type) {
+		case DB_OP_EXECUTE: {
+			if(op->query_type == Database::QUERY_RAW) {
+				return db->query(op->sql);
+			}
+			return db->execute(op->sql, op->params, op->query_type);
+		}
+		case DB_OP_BULK_INSERT: {
+			return op->bulk->execute();
+		}
+		case DB_OP_SELECT: {
+			QueryResult result(*db);
+			if(!result.execute(op->sql, op->params, op->query_type)) {
+				return false;
+			}
+			if(op->listener) {
+				op->listener->onSelectResult(result);
+			}
+			return true;
+		}
+		default: {
+			return false;
+		}
+	}
+}
+
+void DatabaseWriter::commit() {
+	if(!in_transaction) {
+		return;
+	}
+	uint64_t start = now();
+	if(!db->endTransaction()) {
+		printf("DatabaseWriter: cannot commit: %s\n", sqlite3_errmsg(db->getDB()));
+		db->rollbackTransaction();
+		++stats.num_errors;
+	}
+	in_transaction = false;
+	stats.last_commit_micros = now() - start;
+	if(stats.last_commit_micros > stats.max_commit_micros) {
+		stats.max_commit_micros = stats.last_commit_micros;
+	}
+	++stats.num_commits;
+}
+
+} // roxlu
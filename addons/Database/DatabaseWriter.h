@@ -0,0 +1,133 @@
+#ifndef ROXLU_DATABASE_WRITERH
+#define ROXLU_DATABASE_WRITERH
+
+#include <stdint.h>
+#include <string>
+#include <pthread.h>
+#include "sqlite3.h"
+#include "QueryParams.h"
+
+using std::string;
+
+namespace roxlu {
+
+/*
+
+Write-behind for Database, see Database::startWriter().
+
+The writer thread has its own connection to the database. Inserts,
+deletes, bulk inserts and raw queries are pushed on a lock-free queue
+(many producers, one consumer) and the writer thread executes them in
+transactions of max_batch_ops operations or max_batch_millis, so a
+commit/fsync never blocks the thread which adds the operations.
+
+Selects with a listener (QuerySelect::execute(listener)) are executed by
+the writer thread too; they see all operations which were added before.
+NOTE: the listener is called on the writer thread.
+
+*/
+
+class Database;
+class QueryBulkInsert;
+class IDatabaseSelectListener;
+
+struct DatabaseWriterSettings {
+	DatabaseWriterSettings();
+	string journal_mode; // "WAL", so readers don't wait for the writer
+	string synchronous; // "NORMAL"; with WAL only a checkpoint syncs
+	size_t max_batch_ops; // commit after this many operations
+	uint64_t max_batch_millis; // or when the transaction is this old
+	size_t max_queued; // when > 0, adding an operation fails when the queue is this full
+	int busy_timeout_millis;
+};
+
+struct DatabaseWriterStats {
+	size_t num_queued; // waiting in the queue
+	size_t max_num_queued; // the deepest the queue has been
+	uint64_t num_executed;
+	uint64_t num_rejected; // because the queue was full
+	uint64_t num_errors;
+	uint64_t num_commits;
+	uint64_t last_commit_micros;
+	uint64_t max_commit_micros;
+};
+
+enum DatabaseOperationTypes {
+	 DB_OP_EXECUTE
+	,DB_OP_BULK_INSERT
+	,DB_OP_SELECT
+	,DB_OP_FLUSH
+};
+
+struct DatabaseOperation {
+	DatabaseOperation();
+	~DatabaseOperation();
+	int type;
+	int query_type; // Database::QueryTypes, or the flush number
+	string sql;
+	QueryParams params;
+	QueryBulkInsert* bulk;
+	IDatabaseSelectListener* listener;
+	DatabaseOperation* volatile next;
+};
+
+class DatabaseWriter {
+public:
+	DatabaseWriter();
+	~DatabaseWriter(); // calls stop()
+	bool start(const string& filepath, const DatabaseWriterSettings& settings);
+	void stop(); // executes and commits everything which is queued
+	bool execute(const string& sql, QueryParams& params, int queryType); // copies the params
+	bool executeBulk(QueryBulkInsert& bulk); // takes the rows
+	bool executeSelect(const string& sql, QueryParams& params, IDatabaseSelectListener* listener);
+	bool flush(); // blocks until everything which is queued is committed
+	void getStats(DatabaseWriterStats& result);
+	bool isStarted();
+
+private:
+	static void* threadFunction(void* user);
+	static uint64_t now(); // micros
+	void run();
+	bool add(DatabaseOperation* op);
+	void push(DatabaseOperation* op);
+	DatabaseOperation* pop();
+	bool isEmpty();
+	bool executeOperation(DatabaseOperation* op);
+	void commit();
+
+	Database* db; // used by the writer thread only
+	DatabaseWriterSettings settings;
+	pthread_t thread;
+	bool started;
+	volatile bool running;
+	volatile int num_adding; // producers between their `running` check and push()
+
+	// intrusive mpsc queue (Dmitry Vyukov)
+	DatabaseOperation* volatile head; // producers push here
+	DatabaseOperation* tail; // consumer pops here
+	DatabaseOperation stub;
+
+	// the writer thread sleeps when there is nothing to do
+	pthread_mutex_t mutex;
+	pthread_cond_t wake_cond;
+	volatile int sleeping;
+
+	pthread_mutex_t flush_mutex;
+	pthread_cond_t flush_cond;
+	int num_flush_requests;
+	int num_flushed;
+
+	bool in_transaction;
+	uint64_t batch_start;
+	size_t batch_ops;
+
+	DatabaseWriterStats stats;
+};
+
+inline bool DatabaseWriter::isStarted() {
+	return started;
+}
+
+} // roxlu
+
+#endif
@@ -8,8 +8,11 @@ Query::Query(Database& db)
 {
 }
 
+// The db is a reference, so a query can't be moved to another database.
 Query& Query::operator=(const Query& other) {
-	db = other.db;
+	if(&db != &other.db) {
+		printf("Query: cannot assign a query of another database.\n");
+	}
 	return *this;
 }
 
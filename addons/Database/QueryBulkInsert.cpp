@@ -0,0 +1,179 @@
+#include "QueryBulkInsert.h"
+#include "Database.h"
+#include <string.h>
+#include <algorithm>
+
+namespace roxlu {
+
+QueryBulkInsert::QueryBulkInsert(Database& db, const string& table)
+	:Query(db)
+	,table(table)
+	,num_fields(0)
+{
+}
+
+QueryBulkInsert::QueryBulkInsert(const QueryBulkInsert& other)
+	:Query(other.db)
+{
+	*this = other;
+}
+
+QueryBulkInsert& QueryBulkInsert::operator=(const QueryBulkInsert& other) {
+	if(this == &other) {
+		return *this;
+	}
+	table = other.table;
+	field_list = other.field_list;
+	or_clause = other.or_clause;
+	num_fields = other.num_fields;
+	values = other.values;
+	text = other.text;
+	return *this;
+}
+
+QueryBulkInsert::~QueryBulkInsert() {
+}
+
+QueryBulkInsert& QueryBulkInsert::fields(const string& fieldList) {
+	field_list = fieldList;
+	num_fields = fieldList.size() ? 1 : 0;
+	for(size_t i = 0; i < fieldList.size(); ++i) {
+		if(fieldList[i] == ',') {
+			++num_fields;
+		}
+	}
+	return *this;
+}
+
+QueryBulkInsert& QueryBulkInsert::use(const char* value) {
+	BulkValue v;
+	v.type = BULK_TEXT;
+	v.offset = text.size();
+	v.length = strlen(value);
+	text.append(value, v.length);
+	values.push_back(v);
+	return *this;
+}
+
+void QueryBulkInsert::swap(QueryBulkInsert& other) {
+	table.swap(other.table);
+	field_list.swap(other.field_list);
+	or_clause.swap(other.or_clause);
+	std::swap(num_fields, other.num_fields);
+	values.swap(other.values);
+	text.swap(other.text);
+}
+
+void QueryBulkInsert::reserve(size_t numRows) {
+	values.reserve(numRows * num_fields);
+}
+
+void QueryBulkInsert::clear() {
+	values.clear();
+	text.clear();
+}
+
+// Creates the sql with positional params.
+string QueryBulkInsert::toString() {
+	string sql;
+	if(!num_fields) {
+		return sql;
+	}
+	sql.reserve(32 + table.size() + field_list.size() + num_fields * 2);
+	sql.append("insert ");
+	sql.append(or_clause);
+	sql.append(" into ");
+	sql.append(table);
+	sql.append("(");
+	sql.append(field_list);
+	sql.append(") values (");
+	for(size_t i = 0; i < num_fields; ++i) {
+		sql.append(i ? ",?" : "?");
+	}
+	sql.append(")");
+	return sql;
+}
+
+bool QueryBulkInsert::bindRow(sqlite3_stmt* stmt, size_t row) {
+	const BulkValue* row_values = &values[row * num_fields];
+	const char* text_data = text.data();
+	for(size_t i = 0; i < num_fields; ++i) {
+		const BulkValue& v = row_values[i];
+		int result = SQLITE_OK;
+		switch(v.type) {
+			case BULK_INT: result = sqlite3_bind_int64(stmt, i + 1, v.i); break;
+			case BULK_FLOAT: result = sqlite3_bind_double(stmt, i + 1, v.d); break;
+			case BULK_TEXT: result = sqlite3_bind_text(stmt, i + 1, text_data + v.offset, v.length, SQLITE_STATIC); break;
+			case BULK_NULL: result = sqlite3_bind_null(stmt, i + 1); break;
+			default: break;
+		}
+		if(result != SQLITE_OK) {
+			printf("Error: cannot bind field %zu of row %zu: %s\n", i, row, sqlite3_errmsg(getSQLite()));
+			return false;
+		}
+	}
+	return true;
+}
+
+// Inserts all rows; when one row fails nothing is inserted (when we
+// started the transaction ourself).
+bool QueryBulkInsert::execute() {
+	if(!num_fields) {
+		printf("Error: bulk insert into %s without fields.\n", table.c_str());
+		return false;
+	}
+	if(values.size() % num_fields) {
+		printf("Error: bulk insert into %s has an incomplete row.\n", table.c_str());
+		return false;
+	}
+	if(!values.size()) {
+		return true;
+	}
+	if(getDB().isAsync()) {
+		return getDB().executeBulk(*this);
+	}
+	
+	sqlite3_stmt* stmt = getDB().acquireStatement(toString());
+	if(!stmt) {
+		return false;
+	}
+	
+	bool own_transaction = sqlite3_get_autocommit(getSQLite());
+	if(own_transaction && !getDB().beginTransaction()) {
+		printf("Error: cannot begin transaction: %s\n", sqlite3_errmsg(getSQLite()));
+		getDB().releaseStatement(stmt);
+		return false;
+	}
+	
+	bool ok = true;
+	size_t num_rows = size();
+	for(size_t i = 0; i < num_rows; ++i) {
+		if(!bindRow(stmt, i)) {
+			ok = false;
+			break;
+		}
+		if(sqlite3_step(stmt) != SQLITE_DONE) {
+			printf("error: %s\n", sqlite3_errmsg(getSQLite()));
+			ok = false;
+			break;
+		}
+		sqlite3_reset(stmt);
+	}
+	getDB().releaseStatement(stmt);
+	
+	if(own_transaction) {
+		if(ok && !getDB().endTransaction()) {
+			printf("Error: cannot commit: %s\n", sqlite3_errmsg(getSQLite()));
+			ok = false;
+		}
+		if(!ok) {
+			getDB().rollbackTransaction();
+		}
+	}
+	if(ok) {
+		clear();
+	}
+	return ok;
+}
+
+} // roxlu
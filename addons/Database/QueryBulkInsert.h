@@ -0,0 +1,141 @@
+#ifndef ROXLU_DATABASE_QUERY_BULK_INSERTH
+#define ROXLU_DATABASE_QUERY_BULK_INSERTH
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "Query.h"
+
+using std::string;
+using std::vector;
+
+namespace roxlu {
+
+/*
+
+Inserts many rows with one prepared statement in one transaction (unless
+you're already in a transaction, then we use that one). The values are
+stored typed and bound by position, so no sql is created per row.
+
+	QueryBulkInsert bulk = db.bulkInsert("log").fields("time,level,msg");
+	for(...) {
+		bulk.use(time).use(level).use(msg);
+	}
+	bulk.execute(); // clears the rows when successful
+
+In async mode (Database::startWriter()) execute() hands the rows to the
+writer thread.
+
+*/
+
+class Database;
+class QueryBulkInsert : public Query {
+public:
+	QueryBulkInsert(Database& db, const string& table);
+	QueryBulkInsert(const QueryBulkInsert& other);
+	QueryBulkInsert& operator=(const QueryBulkInsert& other);
+	~QueryBulkInsert();
+	
+	QueryBulkInsert& fields(const string& fieldList); // comma separated
+	QueryBulkInsert& orReplace();
+	QueryBulkInsert& orIgnore();
+	
+	// the values, row by row, in the order of the fields.
+	QueryBulkInsert& use(int value);
+	QueryBulkInsert& use(int64_t value);
+	QueryBulkInsert& use(float value);
+	QueryBulkInsert& use(double value);
+	QueryBulkInsert& use(const char* value);
+	QueryBulkInsert& use(const string& value);
+	QueryBulkInsert& useNull();
+	
+	size_t size(); // number of complete rows
+	void reserve(size_t numRows);
+	void clear();
+	string toString();
+	bool execute(); // queued in async mode
+	void swap(QueryBulkInsert& other); // rows, table and fields
+	
+private:
+	enum BulkValueType {
+		 BULK_INT
+		,BULK_FLOAT
+		,BULK_TEXT
+		,BULK_NULL
+	};
+	
+	struct BulkValue {
+		int type;
+		int64_t i;
+		double d;
+		size_t offset; // into text
+		size_t length;
+	};
+	
+	bool bindRow(sqlite3_stmt* stmt, size_t row);
+	
+	string table;
+	string field_list;
+	string or_clause;
+	size_t num_fields;
+	vector<BulkValue> values;
+	string text; // all text values
+};
+
+inline QueryBulkInsert& QueryBulkInsert::orReplace() {
+	or_clause = " OR REPLACE ";
+	return *this;
+}
+
+inline QueryBulkInsert& QueryBulkInsert::orIgnore() {
+	or_clause = " OR IGNORE ";
+	return *this;
+}
+
+inline QueryBulkInsert& QueryBulkInsert::use(int value) {
+	return use((int64_t)value);
+}
+
+inline QueryBulkInsert& QueryBulkInsert::use(int64_t value) {
+	BulkValue v;
+	v.type = BULK_INT;
+	v.i = value;
+	values.push_back(v);
+	return *this;
+}
+
+inline QueryBulkInsert& QueryBulkInsert::use(float value) {
+	return use((double)value);
+}
+
+inline QueryBulkInsert& QueryBulkInsert::use(double value) {
+	BulkValue v;
+	v.type = BULK_FLOAT;
+	v.d = value;
+	values.push_back(v);
+	return *this;
+}
+
+inline QueryBulkInsert& QueryBulkInsert::use(const string& value) {
+	BulkValue v;
+	v.type = BULK_TEXT;
+	v.offset = text.size();
+	v.length = value.size();
+	text.append(value);
+	values.push_back(v);
+	return *this;
+}
+
+inline QueryBulkInsert& QueryBulkInsert::useNull() {
+	BulkValue v;
+	v.type = BULK_NULL;
+	values.push_back(v);
+	return *this;
+}
+
+inline size_t QueryBulkInsert::size() {
+	return num_fields ? values.size() / num_fields : 0;
+}
+
+} // roxlu
+#endif
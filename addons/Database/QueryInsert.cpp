@@ -74,24 +74,7 @@ bool QueryInsert::execute() {
 		return false;
 	}
 
-	sqlite3_stmt* stmt;
-	if(!getDB().prepare(sql, &stmt)) {
-		sqlite3_finalize(stmt);
-		return false;
-	}
-	
-	if(!getDB().bind(field_values.getParams(), &stmt, Database::QUERY_INSERT)) {
-		sqlite3_finalize(stmt);
-		return false;
-	}
-		
-	if(sqlite3_step(stmt) != SQLITE_DONE) {
-		printf("error: %s\n", sqlite3_errmsg(getSQLite()));
-		sqlite3_finalize(stmt);
-		return false;
-	}
-	sqlite3_finalize(stmt);
-	return true;
+	return getDB().execute(sql, field_values, Database::QUERY_INSERT);
 }
 
 
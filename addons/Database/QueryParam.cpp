@@ -31,7 +31,7 @@ QueryParam& QueryParam::operator=(const QueryParam& other) {
 	return *this;
 }
 
-string QueryParam::getField() {
+const string& QueryParam::getField() {
 	return field;
 }
 
@@ -77,7 +77,7 @@ string QueryParam::getBindSQL() {
 	return result;
 }
 
-string QueryParam::getValue() {
+const string& QueryParam::getValue() {
 	return value;
 }
 
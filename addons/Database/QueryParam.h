@@ -44,8 +44,8 @@ public:
 	void setType(QueryParamType valueType);
 	virtual int getType();
 	
-	string getField();
-	string getValue();
+	const string& getField();
+	const string& getValue();
 	string getBindName();
 	string getBindSQL();
 
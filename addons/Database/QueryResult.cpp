@@ -1,14 +1,16 @@
 #include "QueryResult.h"
 #include "Database.h"
-#include <sstream>
 
 namespace roxlu {
 
 QueryResult::QueryResult(Database& db) 
 	:db(db)
-	,is_ok(true)
 	,stmt(NULL)
+	,owns_stmt(false)
+	,is_ok(true)
 	,row_index(0)
+	,last_result(SQLITE_DONE)
+	,row_count_hint(0)
 {
 }
 
@@ -16,43 +18,60 @@ QueryResult& QueryResult::operator=(const QueryResult& other) {
 	if(this == &other) {
 		return *this;
 	}
-	//printf("copy query: %p", other.stmt);
-	db = other.db;
+	if(&db != &other.db) {
+		printf("QueryResult: cannot assign a result of another database.\n");
+		return *this;
+	}
+	releaseStatement();
 	stmt = other.stmt;
+	owns_stmt = false;
 	is_ok = other.is_ok;
 	row_index = other.row_index;
 	last_result = other.last_result;
+	columns = other.columns;
+	row_count_hint = other.row_count_hint;
 	return *this;
 }
 
 QueryResult::QueryResult(const QueryResult& other) 
 	:db(other.db)
+	,stmt(NULL)
+	,owns_stmt(false)
 {
 	*this = other;
 }
 
 QueryResult::~QueryResult() {
-	// @todo we need to "finalize" the stmt somewhere!!
-	
-	//printf("remove query.... %p\n", stmt);
-//	if(stmt != NULL && SQLITE_OK != sqlite3_finalize(stmt)) {
-//		printf("Error: cannot finalit statement.\n");
-//	}
+	releaseStatement();
+}
+
+// The statement goes back into the cache of the db.
+void QueryResult::releaseStatement() {
+	if(stmt && owns_stmt) {
+		getDB().releaseStatement(stmt);
+	}
+	stmt = NULL;
+	owns_stmt = false;
 }
 
 bool QueryResult::execute(const string& sql, QueryParams& params, int queryType) {
-	if(!getDB().prepare(sql, &stmt)) {
-		sqlite3_finalize(stmt);
+	releaseStatement();
+	last_result = SQLITE_DONE;
+	stmt = getDB().acquireStatement(sql);
+	if(!stmt) {
 		printf("error: cannot prepare\n");
+		is_ok = false;
 		return false;
 	}
+	owns_stmt = true;
 	//printf("db: %p\n", &getDB());
 	if(!getDB().bind(params.getParams(), &stmt, queryType)) {
 		printf("error: cannot bind..\n");
-
-		//sqlite3_finalize(stmt);
+		releaseStatement();
+		is_ok = false;
 		return false;
 	}
+	is_ok = true;
 	row_index = 0;
 	return true;
 }
@@ -62,25 +81,56 @@ bool QueryResult::isLast() {
 	return last_result != SQLITE_ROW;
 }
 
+// When we're at the end the statement is released right away so it can be
+// used by the next query.
 bool QueryResult::next() {
+	if(!stmt) {
+		return false;
+	}
 	last_result = sqlite3_step(stmt);
-	return last_result == SQLITE_ROW;
+	if(last_result != SQLITE_ROW) {
+		releaseStatement();
+		return false;
+	}
+	++row_index;
+	return true;
 }
 
 string QueryResult::getString(int index) {
-	if(last_result != SQLITE_ROW) {
+	size_t length = 0;
+	const char* text = getText(index, &length);
+	if(!text) {
 		return "";
 	}
-	std::stringstream ss;
-	ss << sqlite3_column_text(stmt, index);
-	return ss.str();
+	return string(text, length);
+}
+
+const char* QueryResult::getText(int index, size_t* length) {
+	if(last_result != SQLITE_ROW) {
+		return NULL;
+	}
+	const char* text = (const char*)sqlite3_column_text(stmt, index);
+	if(length) {
+		*length = sqlite3_column_bytes(stmt, index);
+	}
+	return text;
+}
+
+const void* QueryResult::getBlob(int index, size_t& size) {
+	size = 0;
+	if(last_result != SQLITE_ROW) {
+		return NULL;
+	}
+	const void* data = sqlite3_column_blob(stmt, index);
+	size = sqlite3_column_bytes(stmt, index);
+	return data;
 }
 
 int64_t QueryResult::getInt(int index) {
 	if(last_result != SQLITE_ROW) {
 		return 0;
 	}
-	return sqlite3_column_int(stmt, index);
+	return sqlite3_column_int64(stmt, index);
 }
 
 float QueryResult::getFloat(int index) {
@@ -90,5 +140,94 @@ float QueryResult::getFloat(int index) {
 	return sqlite3_column_double(stmt, index);
 }
 
+double QueryResult::getDouble(int index) {
+	if(last_result != SQLITE_ROW) {
+		return 0;
+	}
+	return sqlite3_column_double(stmt, index);
+}
+
+bool QueryResult::isNull(int index) {
+	if(last_result != SQLITE_ROW) {
+		return true;
+	}
+	return sqlite3_column_type(stmt, index) == SQLITE_NULL;
+}
+
+int QueryResult::getNumColumns() {
+	if(!stmt) {
+		return 0;
+	}
+	return sqlite3_column_count(stmt);
+}
+
+// Bulk columns
+// -----------------------------------------------------------------------------
+void QueryResult::bindColumn(int index, int type, void* values) {
+	QueryColumnBinding binding;
+	binding.column = index;
+	binding.type = type;
+	binding.values = values;
+	columns.push_back(binding);
+}
+
+void QueryResult::reserveColumns(size_t numRows) {
+	for(size_t i = 0; i < columns.size(); ++i) {
+		QueryColumnBinding& b = columns[i];
+		switch(b.type) {
+			case QUERY_COLUMN_INT: { vector<int>* v = (vector<int>*)b.values; v->reserve(v->size() + numRows); break; }
+			case QUERY_COLUMN_INT64: { vector<int64_t>* v = (vector<int64_t>*)b.values; v->reserve(v->size() + numRows); break; }
+			case QUERY_COLUMN_FLOAT: { vector<float>* v = (vector<float>*)b.values; v->reserve(v->size() + numRows); break; }
+			case QUERY_COLUMN_DOUBLE: { vector<double>* v = (vector<double>*)b.values; v->reserve(v->size() + numRows); break; }
+			case QUERY_COLUMN_STRING: { vector<string>* v = (vector<string>*)b.values; v->reserve(v->size() + numRows); break; }
+			default: break;
+		}
+	}
+}
+
+// The values are read straight from sqlite into the vectors; no
+// per cell conversions to strings. Returns 0 when there are no more rows.
+size_t QueryResult::fetch(size_t maxRows) {
+	if(!stmt || !columns.size()) {
+		return 0;
+	}
+	if(row_count_hint) {
+		reserveColumns(row_count_hint);
+		row_count_hint = 0;
+	}
+	
+	size_t num_rows = 0;
+	size_t num_columns = columns.size();
+	const QueryColumnBinding* bindings = &columns[0];
+	while(num_rows < maxRows) {
+		last_result = sqlite3_step(stmt);
+		if(last_result != SQLITE_ROW) {
+			releaseStatement();
+			break;
+		}
+		for(size_t i = 0; i < num_columns; ++i) {
+			const QueryColumnBinding& b = bindings[i];
+			switch(b.type) {
+				case QUERY_COLUMN_INT: ((vector<int>*)b.values)->push_back(sqlite3_column_int(stmt, b.column)); break;
+				case QUERY_COLUMN_INT64: ((vector<int64_t>*)b.values)->push_back(sqlite3_column_int64(stmt, b.column)); break;
+				case QUERY_COLUMN_FLOAT: ((vector<float>*)b.values)->push_back(sqlite3_column_double(stmt, b.column)); break;
+				case QUERY_COLUMN_DOUBLE: ((vector<double>*)b.values)->push_back(sqlite3_column_double(stmt, b.column)); break;
+				case QUERY_COLUMN_STRING: {
+					const char* text = (const char*)sqlite3_column_text(stmt, b.column);
+					vector<string>* v = (vector<string>*)b.values;
+					v->push_back(string());
+					if(text) {
+						v->back().assign(text, sqlite3_column_bytes(stmt, b.column));
+					}
+					break;
+				}
+				default: break;
+			}
+		}
+		++num_rows;
+	}
+	row_index += num_rows;
+	return num_rows;
+}
 
 } // roxlu
\ No newline at end of file
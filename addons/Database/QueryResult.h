@@ -2,11 +2,56 @@
 #define ROXLU_DATABASE_QUERYRESULTH
 
 #include <stdint.h>
+#include <vector>
 #include "sqlite3.h"
 #include "QueryParams.h"
 
+using std::vector;
+
 namespace roxlu {
 
+/*
+
+Iterating:
+----------
+	while(result.next()) {
+		size_t len = 0;
+		const char* name = result.getText(0, &len); // no copy, valid until next()
+		int64_t id = result.getInt(1);
+	}
+
+Bulk columns:
+-------------
+Reading lots of numeric rows is fastest by binding vectors to columns and 
+fetching rows in batches; the values are appended to the vectors.
+	
+	vector<int64_t> ids;
+	vector<float> values;
+	result.bindColumn(0, ids);
+	result.bindColumn(1, values);
+	result.setRowCountHint(1000000); // reserves the vectors once
+	while(result.fetch(10000)) {
+		...
+	}
+	
+Don't mix next() and fetch() on one result.
+
+*/
+
+enum QueryColumnTypes {
+	 QUERY_COLUMN_INT
+	,QUERY_COLUMN_INT64
+	,QUERY_COLUMN_FLOAT
+	,QUERY_COLUMN_DOUBLE
+	,QUERY_COLUMN_STRING
+};
+
+struct QueryColumnBinding {
+	int column;
+	int type;
+	void* values; // vector<T>*
+};
+
 class Database;
 
 class QueryResult {
@@ -21,17 +66,37 @@ public:
 	bool next();
 	
 	string getString(int index);
+	const char* getText(int index, size_t* length = NULL); // valid until next(), NULL for null values
+	const void* getBlob(int index, size_t& size); // valid until next()
 	int64_t getInt(int index);
 	float getFloat(int index);
+	double getDouble(int index);
+	bool isNull(int index);
+	int getNumColumns();
+	int getRowIndex(); // number of rows read
 	bool isLast();
 	
+	void bindColumn(int index, vector<int>& values);
+	void bindColumn(int index, vector<int64_t>& values);
+	void bindColumn(int index, vector<float>& values);
+	void bindColumn(int index, vector<double>& values);
+	void bindColumn(int index, vector<string>& values);
+	void setRowCountHint(size_t numRows);
+	size_t fetch(size_t maxRows); // appends the next rows to the bound columns, returns the number of rows
+	
 private:
+	void releaseStatement();
+	void bindColumn(int index, int type, void* values);
+	void reserveColumns(size_t numRows);
 	Database& getDB();
 	Database& db;
-	sqlite3_stmt* stmt;
+	sqlite3_stmt* stmt; // from the statement cache of the db
+	bool owns_stmt; // copies don't release the statement
 	bool is_ok;
 	int row_index;
 	int last_result;
+	vector<QueryColumnBinding> columns;
+	size_t row_count_hint;
 };
 
 inline bool QueryResult::isOK() {
@@ -42,6 +107,34 @@ inline Database& QueryResult::getDB() {
 	return db;
 }
 
+inline int QueryResult::getRowIndex() {
+	return row_index;
+}
+
+inline void QueryResult::bindColumn(int index, vector<int>& values) {
+	bindColumn(index, QUERY_COLUMN_INT, &values);
+}
+
+inline void QueryResult::bindColumn(int index, vector<int64_t>& values) {
+	bindColumn(index, QUERY_COLUMN_INT64, &values);
+}
+
+inline void QueryResult::bindColumn(int index, vector<float>& values) {
+	bindColumn(index, QUERY_COLUMN_FLOAT, &values);
+}
+
+inline void QueryResult::bindColumn(int index, vector<double>& values) {
+	bindColumn(index, QUERY_COLUMN_DOUBLE, &values);
+}
+
+inline void QueryResult::bindColumn(int index, vector<string>& values) {
+	bindColumn(index, QUERY_COLUMN_STRING, &values);
+}
+
+inline void QueryResult::setRowCountHint(size_t numRows) {
+	row_count_hint = numRows;
+}
+
 } // roxlu
 
 #endif
\ No newline at end of file
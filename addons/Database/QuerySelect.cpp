@@ -127,4 +127,12 @@ bool QuerySelect::execute(QueryResult& result) {
 	return result.execute(sql, field_values, Database::QUERY_SELECT);
 }
 
+bool QuerySelect::execute(IDatabaseSelectListener* listener) {
+	string sql = toString();
+	if(!sql.length()) {
+		return false;
+	}
+	return getDB().executeSelect(sql, field_values, listener);
+}
+
 } // roxlu
\ No newline at end of file
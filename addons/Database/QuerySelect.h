@@ -12,6 +12,12 @@ namespace roxlu {
 
 class Database;
 
+class IDatabaseSelectListener {
+public:
+	virtual ~IDatabaseSelectListener() {}
+	virtual void onSelectResult(QueryResult& result) = 0;
+};
+
 class QuerySelect : public Query {
 public:
 	QuerySelect(Database& db);
@@ -22,6 +28,7 @@ public:
 	
 	QuerySelect& from(const string& fromTable);
 	bool execute(QueryResult& result);
+	bool execute(IDatabaseSelectListener* listener); // in async mode on the writer thread
 	string toString();
 	
 	template<typename T>
@@ -0,0 +1,426 @@
+#include "Delaunay2D.h"
+#include "RandomGenerator.h"
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+
+#define DELAUNAY2D_GRID (1 << 24)
+
+namespace roxlu {
+
+// -----------------------------------------------------------------------------
+// 128 bit integers for the exact incircle test. The grid coordinates
+// (including the outer triangle) are < 2^27, so the lifted terms fit
+// in 64 bits and their products in 128 bits.
+
+struct Delaunay2DInt128 {
+	uint64_t hi;
+	uint64_t lo;
+};
+
+static Delaunay2DInt128 delaunay2d_mul(int64_t a, int64_t b) {
+	bool neg = (a < 0) != (b < 0);
+	uint64_t ua = (a < 0) ? -(uint64_t)a : (uint64_t)a;
+	uint64_t ub = (b < 0) ? -(uint64_t)b : (uint64_t)b;
+	uint64_t a0 = ua & 0xFFFFFFFF;
+	uint64_t a1 = ua >> 32;
+	uint64_t b0 = ub & 0xFFFFFFFF;
+	uint64_t b1 = ub >> 32;
+	uint64_t p00 = a0 * b0;
+	uint64_t p01 = a0 * b1;
+	uint64_t p10 = a1 * b0;
+	uint64_t p11 = a1 * b1;
+	uint64_t mid = (p00 >> 32) + (p01 & 0xFFFFFFFF) + (p10 & 0xFFFFFFFF);
+	Delaunay2DInt128 r;
+	r.lo = (p00 & 0xFFFFFFFF) | (mid << 32);
+	r.hi = p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+	if(neg) {
+		r.lo = ~r.lo + 1;
+		r.hi = ~r.hi + (r.lo == 0 ? 1 : 0);
+	}
+	return r;
+}
+
+static Delaunay2DInt128 delaunay2d_add(const Delaunay2DInt128& a, const Delaunay2DInt128& b) {
+	Delaunay2DInt128 r;
+	r.lo = a.lo + b.lo;
+	r.hi = a.hi + b.hi + (r.lo < a.lo ? 1 : 0);
+	return r;
+}
+
+// index on a 2^16 x 2^16 hilbert curve
+static uint32_t delaunay2d_hilbert(uint32_t x, uint32_t y) {
+	uint32_t d = 0;
+	for(uint32_t s = 1 << 15; s > 0; s >>= 1) {
+		uint32_t rx = (x & s) ? 1 : 0;
+		uint32_t ry = (y & s) ? 1 : 0;
+		d += s * s * ((3 * rx) ^ ry);
+		if(ry == 0) {
+			if(rx == 1) {
+				x = 0xFFFF - x;
+				y = 0xFFFF - y;
+			}
+			std::swap(x, y);
+		}
+	}
+	return d;
+}
+
+// -----------------------------------------------------------------------------
+
+Delaunay2D::Delaunay2D(float xmin, float ymin, float xmax, float ymax)
+	:min_x(xmin)
+	,min_y(ymin)
+	,scale(1.0f)
+	,last_triangle(0)
+	,walk_counter(0)
+	,dirty_first(1)
+	,dirty_last(0)
+{
+	float size = std::max<float>(xmax - xmin, ymax - ymin);
+	if(size > 0.0f) {
+		scale = DELAUNAY2D_GRID / size;
+	}
+	clear();
+}
+
+void Delaunay2D::clear() {
+	const int32_t m = DELAUNAY2D_GRID;
+	points.clear();
+	vertices.clear();
+	triangles.clear();
+	indices.clear();
+	flip_stack.clear();
+
+	// outer triangle, counter clockwise around [0, m] x [0, m]
+	Point a = { -2 * m, -2 * m };
+	Point b = { 5 * m, -2 * m };
+	Point c = { -2 * m, 5 * m };
+	points.push_back(a);
+	points.push_back(b);
+	points.push_back(c);
+	int t = newTriangle();
+	setTriangle(t, 0, 1, 2, -1, -1, -1);
+	last_triangle = t;
+}
+
+void Delaunay2D::reserve(size_t numPoints) {
+	points.reserve(numPoints + 3);
+	vertices.reserve(numPoints);
+	triangles.reserve(numPoints * 2 + 1);
+	indices.reserve((numPoints * 2 + 1) * 3);
+}
+
+bool Delaunay2D::snap(float x, float y, Point& p) {
+	float gx = floorf((x - min_x) * scale + 0.5f);
+	float gy = floorf((y - min_y) * scale + 0.5f);
+	if(gx < 0.0f || gy < 0.0f || gx > DELAUNAY2D_GRID || gy > DELAUNAY2D_GRID) {
+		return false;
+	}
+	p.x = (int32_t)gx;
+	p.y = (int32_t)gy;
+	return true;
+}
+
+int Delaunay2D::insert(float x, float y) {
+	Point p;
+	if(!snap(x, y, p)) {
+		printf("Delaunay2D: point %f, %f is outside the bounds.\n", x, y);
+		return -1;
+	}
+	return insertPoint(x, y, p);
+}
+
+// Biased randomized insertion order: every point ends up in round k with
+// probability 2^-(k+1); the rounds with the fewest points go first and
+// in each round the points are sorted along a hilbert curve.
+void Delaunay2D::insert(const float* xy, size_t num, int* resultIndices) {
+	vector<std::pair<uint64_t, uint32_t> > order;
+	order.reserve(num);
+	RandomGenerator rng(num);
+	for(size_t i = 0; i < num; ++i) {
+		Point p;
+		if(!snap(xy[i * 2], xy[i * 2 + 1], p)) {
+			printf("Delaunay2D: point %f, %f is outside the bounds.\n", xy[i * 2], xy[i * 2 + 1]);
+			if(resultIndices != NULL) {
+				resultIndices[i] = -1;
+			}
+			continue;
+		}
+		uint32_t bits = rng.next();
+		uint64_t round = 0;
+		while((bits & 1) && round < 31) {
+			bits >>= 1;
+			++round;
+		}
+		uint32_t hx = std::min<uint32_t>(p.x >> 8, 0xFFFF);
+		uint32_t hy = std::min<uint32_t>(p.y >> 8, 0xFFFF);
+		order.push_back(std::make_pair(((31 - round) << 32) | delaunay2d_hilbert(hx, hy), (uint32_t)i));
+	}
+	std::sort(order.begin(), order.end());
+
+	reserve(vertices.size() + order.size());
+	for(size_t i = 0; i < order.size(); ++i) {
+		uint32_t dx = order[i].second;
+		Point p;
+		snap(xy[dx * 2], xy[dx * 2 + 1], p);
+		int v = insertPoint(xy[dx * 2], xy[dx * 2 + 1], p);
+		if(resultIndices != NULL) {
+			resultIndices[dx] = v;
+		}
+	}
+}
+
+void Delaunay2D::getTriangles(vector<int>& result) const {
+	result.clear();
+	for(size_t i = 0; i < triangles.size(); ++i) {
+		const Delaunay2DTriangle& tri = triangles[i];
+		if(tri.v[0] < 3 || tri.v[1] < 3 || tri.v[2] < 3) {
+			continue;
+		}
+		result.push_back(tri.v[0] - 3);
+		result.push_back(tri.v[1] - 3);
+		result.push_back(tri.v[2] - 3);
+	}
+}
+
+int Delaunay2D::insertPoint(float x, float y, const Point& p) {
+	int edge = -1;
+	int vertex = -1;
+	int t = locate(p, edge, vertex);
+	if(vertex >= 0) {
+		return vertex - 3;
+	}
+	int v = points.size();
+	points.push_back(p);
+	vertices.push_back(Vec2(x, y));
+	if(edge >= 0) {
+		splitEdge(t, edge, v);
+	}
+	else {
+		splitTriangle(t, v);
+	}
+	legalize();
+	return v - 3;
+}
+
+// Walk from the last triangle towards p; the start edge changes on
+// every step so we can't get stuck in a cycle.
+int Delaunay2D::locate(const Point& p, int& edge, int& vertex) {
+	int t = last_triangle;
+	while(true) {
+		const Delaunay2DTriangle& tri = triangles[t];
+		int start = walk_counter++ % 3;
+		int next = -1;
+		for(int k = 0; k < 3; ++k) {
+			int i = (start + k) % 3;
+			if(orient(tri.v[(i + 1) % 3], tri.v[(i + 2) % 3], p) < 0) {
+				next = tri.n[i];
+				break;
+			}
+		}
+		if(next < 0) {
+			break;
+		}
+		t = next;
+	}
+
+	edge = -1;
+	vertex = -1;
+	const Delaunay2DTriangle& tri = triangles[t];
+	for(int i = 0; i < 3; ++i) {
+		if(orient(tri.v[(i + 1) % 3], tri.v[(i + 2) % 3], p) != 0) {
+			continue;
+		}
+		if(edge >= 0) {
+			vertex = tri.v[3 - i - edge];
+			edge = -1;
+			break;
+		}
+		edge = i;
+	}
+	return t;
+}
+
+// v lies inside t
+void Delaunay2D::splitTriangle(int t, int v) {
+	Delaunay2DTriangle old = triangles[t];
+	int t1 = newTriangle();
+	int t2 = newTriangle();
+	setTriangle(t, old.v[0], old.v[1], v, t1, t2, old.n[2]);
+	setTriangle(t1, old.v[1], old.v[2], v, t2, t, old.n[0]);
+	setTriangle(t2, old.v[2], old.v[0], v, t, t1, old.n[1]);
+	replaceNeighbor(old.n[0], t, t1);
+	replaceNeighbor(old.n[1], t, t2);
+	flip_stack.push_back(t);
+	flip_stack.push_back(2);
+	flip_stack.push_back(t1);
+	flip_stack.push_back(2);
+	flip_stack.push_back(t2);
+	flip_stack.push_back(2);
+	last_triangle = t;
+}
+
+// v lies on the edge opposite triangles[t].v[edge]; splits t and its neighbor
+void Delaunay2D::splitEdge(int t, int edge, int v) {
+	Delaunay2DTriangle tt = triangles[t];
+	int a = tt.v[edge];
+	int b = tt.v[(edge + 1) % 3];
+	int c = tt.v[(edge + 2) % 3];
+	int nb = tt.n[(edge + 1) % 3];
+	int nc = tt.n[(edge + 2) % 3];
+
+	int u = tt.n[edge];
+	Delaunay2DTriangle uu = triangles[u];
+	int j = (uu.n[0] == t) ? 0 : (uu.n[1] == t) ? 1 : 2;
+	int d = uu.v[j];
+	int ub = uu.n[(j + 2) % 3];
+	int uc = uu.n[(j + 1) % 3];
+
+	int t2 = newTriangle();
+	int u2 = newTriangle();
+	setTriangle(t, a, b, v, u2, t2, nc);
+	setTriangle(t2, a, v, c, u, nb, t);
+	setTriangle(u, d, c, v, t2, u2, ub);
+	setTriangle(u2, d, v, b, t, uc, u);
+	replaceNeighbor(nb, t, t2);
+	replaceNeighbor(uc, u, u2);
+	flip_stack.push_back(t);
+	flip_stack.push_back(2);
+	flip_stack.push_back(t2);
+	flip_stack.push_back(1);
+	flip_stack.push_back(u);
+	flip_stack.push_back(2);
+	flip_stack.push_back(u2);
+	flip_stack.push_back(1);
+	last_triangle = t;
+}
+
+// Flip the edges on the stack until they are all locally Delaunay. The
+// edge is always the one opposite to the new vertex.
+void Delaunay2D::legalize() {
+	while(!flip_stack.empty()) {
+		int e = flip_stack.back();
+		flip_stack.pop_back();
+		int t = flip_stack.back();
+		flip_stack.pop_back();
+
+		Delaunay2DTriangle tt = triangles[t];
+		int u = tt.n[e];
+		if(u < 0) {
+			continue;
+		}
+		Delaunay2DTriangle uu = triangles[u];
+		int j = (uu.n[0] == t) ? 0 : (uu.n[1] == t) ? 1 : 2;
+		int d = uu.v[j];
+		if(!inCircle(tt.v[0], tt.v[1], tt.v[2], d)) {
+			continue;
+		}
+
+		int p = tt.v[e];
+		int q = tt.v[(e + 1) % 3];
+		int r = tt.v[(e + 2) % 3];
+		int tq = tt.n[(e + 1) % 3];
+		int tr = tt.n[(e + 2) % 3];
+		int uq = uu.n[(j + 2) % 3];
+		int ur = uu.n[(j + 1) % 3];
+		setTriangle(t, p, q, d, ur, u, tr);
+		setTriangle(u, p, d, r, uq, tq, t);
+		replaceNeighbor(ur, u, t);
+		replaceNeighbor(tq, t, u);
+		flip_stack.push_back(t);
+		flip_stack.push_back(0);
+		flip_stack.push_back(u);
+		flip_stack.push_back(0);
+	}
+}
+
+int Delaunay2D::newTriangle() {
+	Delaunay2DTriangle tri;
+	triangles.push_back(tri);
+	indices.resize(indices.size() + 3, 0);
+	return triangles.size() - 1;
+}
+
+void Delaunay2D::setTriangle(int t, int v0, int v1, int v2, int n0, int n1, int n2) {
+	Delaunay2DTriangle& tri = triangles[t];
+	tri.v[0] = v0;
+	tri.v[1] = v1;
+	tri.v[2] = v2;
+	tri.n[0] = n0;
+	tri.n[1] = n1;
+	tri.n[2] = n2;
+
+	int* dest = &indices[t * 3];
+	if(v0 < 3 || v1 < 3 || v2 < 3) {
+		dest[0] = dest[1] = dest[2] = 0;
+	}
+	else {
+		dest[0] = v0 - 3;
+		dest[1] = v1 - 3;
+		dest[2] = v2 - 3;
+	}
+
+	if(dirty_first > dirty_last) {
+		dirty_first = dirty_last = t;
+	}
+	else {
+		dirty_first = std::min<size_t>(dirty_first, t);
+		dirty_last = std::max<size_t>(dirty_last, t);
+	}
+}
+
+void Delaunay2D::replaceNeighbor(int t, int from, int to) {
+	if(t < 0) {
+		return;
+	}
+	Delaunay2DTriangle& tri = triangles[t];
+	for(int i = 0; i < 3; ++i) {
+		if(tri.n[i] == from) {
+			tri.n[i] = to;
+			return;
+		}
+	}
+}
+
+// True when d lies inside the circumcircle of the counter clockwise
+// triangle a, b, c. A floating point filter handles most cases; when
+// the result is too close to call we evaluate it exactly.
+bool Delaunay2D::inCircle(int a, int b, int c, int d) const {
+	const Point& pa = points[a];
+	const Point& pb = points[b];
+	const Point& pc = points[c];
+	const Point& pd = points[d];
+	int64_t adx = pa.x - pd.x;
+	int64_t ady = pa.y - pd.y;
+	int64_t bdx = pb.x - pd.x;
+	int64_t bdy = pb.y - pd.y;
+	int64_t cdx = pc.x - pd.x;
+	int64_t cdy = pc.y - pd.y;
+
+	double alift = (double)adx * adx + (double)ady * ady;
+	double blift = (double)bdx * bdx + (double)bdy * bdy;
+	double clift = (double)cdx * cdx + (double)cdy * cdy;
+	double bc0 = (double)bdx * cdy;
+	double bc1 = (double)cdx * bdy;
+	double ca0 = (double)cdx * ady;
+	double ca1 = (double)adx * cdy;
+	double ab0 = (double)adx * bdy;
+	double ab1 = (double)bdx * ady;
+	double det = alift * (bc0 - bc1) + blift * (ca0 - ca1) + clift * (ab0 - ab1);
+	double permanent = alift * (fabs(bc0) + fabs(bc1)) + blift * (fabs(ca0) + fabs(ca1)) + clift * (fabs(ab0) + fabs(ab1));
+	double err = permanent * 1e-14;
+	if(det > err) {
+		return true;
+	}
+	if(det < -err) {
+		return false;
+	}
+
+	Delaunay2DInt128 r = delaunay2d_mul(adx * adx + ady * ady, bdx * cdy - cdx * bdy);
+	r = delaunay2d_add(r, delaunay2d_mul(bdx * bdx + bdy * bdy, cdx * ady - adx * cdy));
+	r = delaunay2d_add(r, delaunay2d_mul(cdx * cdx + cdy * cdy, adx * bdy - bdx * ady));
+	return (int64_t)r.hi > 0 || (r.hi == 0 && r.lo != 0);
+}
+
+} // roxlu
@@ -0,0 +1,129 @@
+#ifndef ROXLU_DELAUNAY2DH
+#define ROXLU_DELAUNAY2DH
+
+#include <vector>
+#include <stdint.h>
+#include "Vec2.h"
+
+using std::vector;
+
+/**
+ * Incremental 2D Delaunay triangulation without external dependencies.
+ *
+ * Points must lie inside the bounds you pass to the constructor. They
+ * are snapped to a 2^24 x 2^24 integer grid inside these bounds and all
+ * orientation/incircle tests are done exactly on the grid coordinates,
+ * so the triangulation never breaks on (nearly) collinear or cocircular
+ * points. Points that snap to the same grid position are merged; insert()
+ * returns the index of the existing vertex in that case.
+ *
+ * The point location walks from the last created triangle, so inserting
+ * points which are close to each other is fast. The bulk insert() sorts
+ * the points along a Hilbert curve in randomized rounds (BRIO) which
+ * keeps the walks short for any input order.
+ *
+ * Like Wm5::IncrementalDelaunay2 we start with a big triangle around the
+ * bounds; triangles which use one of its vertices are not part of the
+ * result.
+ *
+ * getIndices() returns 3 indices for every triangle slot. The buffer is
+ * always valid and updated in place: triangles that touch the outer
+ * triangle are stored as degenerate triangles (0,0,0). getDirtyRange()
+ * tells you which triangle slots changed since the last call of
+ * resetDirtyRange(), so you only have to upload that part. Use
+ * getTriangles() when you want a compact list.
+ *
+ *		roxlu::Delaunay2D del(0, 0, w, h);
+ *		del.insert(&xy[0], xy.size() / 2);
+ *		glDrawElements(GL_TRIANGLES, del.getNumTriangleSlots() * 3, GL_UNSIGNED_INT, &del.getIndices()[0]);
+ *
+ */
+namespace roxlu {
+
+struct Delaunay2DTriangle {
+	int v[3]; // counter clockwise
+	int n[3]; // neighbor triangle opposite v[i], -1 = none
+};
+
+class Delaunay2D {
+public:
+	Delaunay2D(float xmin, float ymin, float xmax, float ymax);
+	void clear();
+	int insert(float x, float y); // returns vertex index, -1 when outside the bounds
+	void insert(const float* xy, size_t num, int* resultIndices = NULL);
+	void reserve(size_t numPoints);
+
+	inline const vector<Vec2>& getVertices() const;
+	inline const vector<int>& getIndices() const; // 3 per triangle slot
+	inline size_t getNumTriangleSlots() const;
+	void getTriangles(vector<int>& result) const; // compact, only the real triangles
+	inline bool getDirtyRange(size_t& first, size_t& last) const; // triangle slots [first, last], false when nothing changed
+	inline void resetDirtyRange();
+
+private:
+	struct Point {
+		int32_t x;
+		int32_t y;
+	};
+
+	bool snap(float x, float y, Point& p);
+	int insertPoint(float x, float y, const Point& p);
+	int locate(const Point& p, int& edge, int& vertex);
+	void splitTriangle(int t, int v);
+	void splitEdge(int t, int edge, int v);
+	void legalize();
+	int newTriangle();
+	void setTriangle(int t, int v0, int v1, int v2, int n0, int n1, int n2);
+	void replaceNeighbor(int t, int from, int to);
+	inline int64_t orient(int a, int b, const Point& c) const;
+	bool inCircle(int a, int b, int c, int d) const;
+
+	float min_x;
+	float min_y;
+	float scale;
+	vector<Point> points; // grid positions, the first 3 are the outer triangle
+	vector<Vec2> vertices; // user positions
+	vector<Delaunay2DTriangle> triangles;
+	vector<int> indices;
+	vector<int> flip_stack; // (triangle, edge) pairs
+	int last_triangle;
+	uint32_t walk_counter;
+	size_t dirty_first;
+	size_t dirty_last;
+};
+
+inline const vector<Vec2>& Delaunay2D::getVertices() const {
+	return vertices;
+}
+
+inline const vector<int>& Delaunay2D::getIndices() const {
+	return indices;
+}
+
+inline size_t Delaunay2D::getNumTriangleSlots() const {
+	return triangles.size();
+}
+
+inline bool Delaunay2D::getDirtyRange(size_t& first, size_t& last) const {
+	if(dirty_first > dirty_last) {
+		return false;
+	}
+	first = dirty_first;
+	last = dirty_last;
+	return true;
+}
+
+inline void Delaunay2D::resetDirtyRange() {
+	dirty_first = 1;
+	dirty_last = 0;
+}
+
+inline int64_t Delaunay2D::orient(int a, int b, const Point& c) const {
+	const Point& pa = points[a];
+	const Point& pb = points[b];
+	return (int64_t)(pb.x - pa.x) * (c.y - pa.y) - (int64_t)(pb.y - pa.y) * (c.x - pa.x);
+}
+
+} // roxlu
+
+#endif
@@ -2,7 +2,9 @@
 #define ROXLU_GEOMETRYH
 
 #include "ConvexHull3D.h"
+#include "Delaunay2D.h"
 #include "IncrementalDelaunay2D.h"
+#include "QuickHull3D.h"
 
 // testing... geometry tools defines it's own static pi/two_pi etc..
 
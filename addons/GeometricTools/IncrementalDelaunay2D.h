@@ -1,16 +1,20 @@
 #ifndef ROXLU_DELAUNAYH
 #define ROXLU_DELAUNAYH
 
-#include "Wm5Core.h"
-#include "Wm5Mathematics.h"
-#include "Wm5Images.h"
-#include "Wm5Imagics.h"
+#include "Delaunay2D.h"
 
 #include <vector>
 using std::vector;
 
 namespace roxlu {
 
+/**
+ * Keeps the interface of the old Wm5::IncrementalDelaunay2 wrapper; the 
+ * triangulation is done by Delaunay2D. Call create() to get a compact
+ * list of indices, or use getDelaunay() for the incrementally updated
+ * index buffer and the bulk insert.
+ *
+ */
 class IncrementalDelaunay2D {	
 
 public:
@@ -22,32 +26,38 @@ public:
 	int insert(float x, float y);
 	const int* getIndices();
 	int getNumTriangles();
-	const vector<Wm5::Vector2f>& getVertices() const;
+	const vector<Vec2>& getVertices() const;
+	Delaunay2D& getDelaunay();
 	
-	Wm5::IncrementalDelaunay2f* del;
+	Delaunay2D del;
+	vector<int> indices;
 };
 
 
 inline int IncrementalDelaunay2D::getNumTriangles() {
-	return del->GetNumTriangles();
+	return indices.size() / 3;
 }
 
 inline const int* IncrementalDelaunay2D::getIndices() {
-	return del->GetIndices();
+	return indices.empty() ? NULL : &indices[0];
 }
 
 inline int IncrementalDelaunay2D::insert(float x, float y) {
-	return del->Insert(Wm5::Vector2f(x,y));
+	return del.insert(x, y);
 }
 
-inline const vector<Wm5::Vector2f>& IncrementalDelaunay2D::getVertices() const {
-	return del->GetVertices();
+inline const vector<Vec2>& IncrementalDelaunay2D::getVertices() const {
+	return del.getVertices();
+}
+
+inline Delaunay2D& IncrementalDelaunay2D::getDelaunay() {
+	return del;
 }
 
 inline void IncrementalDelaunay2D::create() {
-	del->GenerateRepresentation();
+	del.getTriangles(indices);
 }
 
 } // roxlu
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,535 @@
+#include "QuickHull3D.h"
+#include "VertexData.h"
+#include "Parallel.h"
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <algorithm>
+
+#define QUICKHULL3D_NUM_DIRS 7
+#define QUICKHULL3D_GRID (1 << 19) // see createFace() for the limits
+
+namespace roxlu {
+
+// the directions of the Akl-Toussaint polytope, we use min and max of each.
+static const float quickhull3d_dirs[QUICKHULL3D_NUM_DIRS][3] = {
+	{1,0,0}, {0,1,0}, {0,0,1}, {1,1,1}, {1,1,-1}, {1,-1,1}, {-1,1,1}
+};
+
+// Finds the min/max points along the directions per chunk of points.
+struct QuickHull3DExtremesTask {
+	const float* points;
+	size_t num_points;
+	size_t num_chunks;
+	int* result; // QUICKHULL3D_NUM_DIRS * 2 per chunk
+
+	void operator()(size_t begin, size_t end) {
+		for(size_t c = begin; c < end; ++c) {
+			size_t first = (num_points * c) / num_chunks;
+			size_t last = (num_points * (c + 1)) / num_chunks;
+			int* dest = result + c * QUICKHULL3D_NUM_DIRS * 2;
+			float mins[QUICKHULL3D_NUM_DIRS];
+			float maxs[QUICKHULL3D_NUM_DIRS];
+			for(int d = 0; d < QUICKHULL3D_NUM_DIRS; ++d) {
+				mins[d] = FLT_MAX;
+				maxs[d] = -FLT_MAX;
+				dest[d * 2] = dest[d * 2 + 1] = first;
+			}
+			for(size_t i = first; i < last; ++i) {
+				const float* p = points + i * 3;
+				for(int d = 0; d < QUICKHULL3D_NUM_DIRS; ++d) {
+					float v = quickhull3d_dirs[d][0] * p[0] + quickhull3d_dirs[d][1] * p[1] + quickhull3d_dirs[d][2] * p[2];
+					if(v < mins[d]) {
+						mins[d] = v;
+						dest[d * 2] = i;
+					}
+					if(v > maxs[d]) {
+						maxs[d] = v;
+						dest[d * 2 + 1] = i;
+					}
+				}
+			}
+		}
+	}
+};
+
+// Snaps the points to the grid.
+struct QuickHull3DSnapTask {
+	const float* points;
+	int32_t* grid;
+	float min[3];
+	float scale;
+
+	void operator()(size_t begin, size_t end) {
+		for(size_t i = begin * 3; i < end * 3; ++i) {
+			float v = floorf((points[i] - min[i % 3]) * scale + 0.5f);
+			grid[i] = std::max<int32_t>(0, std::min<int32_t>(QUICKHULL3D_GRID, (int32_t)v));
+		}
+	}
+};
+
+// Finds the face which every point is furthest above (or -1).
+struct QuickHull3DPartitionTask {
+	QuickHull3D* hull;
+	const int64_t* planes; // nx, ny, nz, d
+	const double* inv_lens;
+	const int* face_ids;
+	int num_faces;
+
+	void operator()(size_t begin, size_t end) {
+		const int32_t* grid = &hull->grid[0];
+		for(size_t i = begin; i < end; ++i) {
+			const int32_t* p = grid + i * 3;
+			int best = -1;
+			double best_dist = 0.0;
+			for(int f = 0; f < num_faces; ++f) {
+				const int64_t* pl = planes + f * 4;
+				int64_t s = pl[0] * p[0] + pl[1] * p[1] + pl[2] * p[2] - pl[3];
+				if(s > 0 && s * inv_lens[f] > best_dist) {
+					best_dist = s * inv_lens[f];
+					best = face_ids[f];
+				}
+			}
+			hull->assignment[i] = best;
+			hull->assignment_dist[i] = best_dist;
+		}
+	}
+};
+
+QuickHull3D::QuickHull3D()
+	:points(NULL)
+	,num_points(0)
+	,stamp(0)
+{
+}
+
+bool QuickHull3D::compute(const vector<Vec3>& points, VertexData& result, int numThreads) {
+	if(points.empty()) {
+		return false;
+	}
+	return compute(&points[0].x, points.size(), result, numThreads);
+}
+
+bool QuickHull3D::compute(const float* xyz, size_t num, VertexData& result, int numThreads) {
+	if(!compute(xyz, num, numThreads)) {
+		return false;
+	}
+	getVertexData(result);
+	return true;
+}
+
+bool QuickHull3D::compute(const float* xyz, size_t num, int numThreads) {
+	points = xyz;
+	num_points = num;
+	faces.clear();
+	indices.clear();
+	if(num < 4) {
+		printf("QuickHull3D: we need at least 4 points.\n");
+		return false;
+	}
+	if(point_next.size() < num) {
+		point_next.resize(num, -1);
+	}
+	if(horizon_start.size() < num) {
+		horizon_start.resize(num, -1);
+	}
+
+	vector<int> extremes;
+	snap(extremes, numThreads);
+	if(!createSimplex(extremes)) {
+		return false;
+	}
+
+	// hull of the extreme points; then drop everything inside it.
+	for(size_t i = 0; i < extremes.size(); ++i) {
+		int p = extremes[i];
+		int best = -1;
+		double best_dist = 0.0;
+		for(size_t f = 0; f < faces.size(); ++f) {
+			int64_t s = side(faces[f], p);
+			if(s > 0 && s * faces[f].inv_len > best_dist) {
+				best_dist = s * faces[f].inv_len;
+				best = f;
+			}
+		}
+		if(best >= 0) {
+			addToOutside(best, p, best_dist);
+		}
+	}
+	expand(0);
+	partition(numThreads);
+	expand(0);
+
+	for(size_t i = 0; i < faces.size(); ++i) {
+		if(faces[i].alive) {
+			indices.push_back(faces[i].v[0]);
+			indices.push_back(faces[i].v[1]);
+			indices.push_back(faces[i].v[2]);
+		}
+	}
+	return true;
+}
+
+void QuickHull3D::getVertexData(VertexData& result) {
+	if(vertex_map.size() < num_points) {
+		vertex_map.resize(num_points, -1);
+	}
+	result.clear();
+	result.indices.resize(indices.size());
+	result.triangles.assign(indices.size() / 3, Triangle(0,0,0));
+	for(size_t i = 0; i < indices.size(); ++i) {
+		int p = indices[i];
+		if(vertex_map[p] < 0) {
+			vertex_map[p] = result.vertices.size();
+			const float* pp = points + p * 3;
+			result.vertices.push_back(Vec3(pp[0], pp[1], pp[2]));
+		}
+		result.indices[i] = vertex_map[p];
+		result.triangles[i / 3][i % 3] = vertex_map[p];
+	}
+	for(size_t i = 0; i < indices.size(); ++i) {
+		vertex_map[indices[i]] = -1;
+	}
+	result.enablePositionAttrib();
+}
+
+// Finds the extreme points and snaps all points to the grid.
+void QuickHull3D::snap(vector<int>& result, int numThreads) {
+	if(numThreads <= 0) {
+		numThreads = getNumCores();
+	}
+	QuickHull3DExtremesTask task;
+	task.points = points;
+	task.num_points = num_points;
+	task.num_chunks = std::max<size_t>(1, std::min<size_t>(numThreads, num_points / 16384));
+	vector<int> chunk_result(task.num_chunks * QUICKHULL3D_NUM_DIRS * 2);
+	task.result = &chunk_result[0];
+	parallelFor(task.num_chunks, task, numThreads, 1);
+
+	// combine the chunks
+	result.clear();
+	for(int d = 0; d < QUICKHULL3D_NUM_DIRS; ++d) {
+		for(int side = 0; side < 2; ++side) {
+			int best = chunk_result[d * 2 + side];
+			for(size_t c = 1; c < task.num_chunks; ++c) {
+				int p = chunk_result[c * QUICKHULL3D_NUM_DIRS * 2 + d * 2 + side];
+				const float* a = points + p * 3;
+				const float* b = points + best * 3;
+				float va = quickhull3d_dirs[d][0] * a[0] + quickhull3d_dirs[d][1] * a[1] + quickhull3d_dirs[d][2] * a[2];
+				float vb = quickhull3d_dirs[d][0] * b[0] + quickhull3d_dirs[d][1] * b[1] + quickhull3d_dirs[d][2] * b[2];
+				if((side == 0 && va < vb) || (side == 1 && va > vb)) {
+					best = p;
+				}
+			}
+			result.push_back(best);
+		}
+	}
+
+	// the first 3 directions are the axes, so we have the bounds.
+	QuickHull3DSnapTask snap_task;
+	float max_size = 0.0f;
+	for(int d = 0; d < 3; ++d) {
+		snap_task.min[d] = points[result[d * 2] * 3 + d];
+		max_size = std::max<float>(max_size, points[result[d * 2 + 1] * 3 + d] - snap_task.min[d]);
+	}
+	grid.resize(num_points * 3);
+	snap_task.points = points;
+	snap_task.grid = &grid[0];
+	snap_task.scale = (max_size > 0.0f) ? QUICKHULL3D_GRID / max_size : 1.0f;
+	parallelFor(num_points, snap_task, numThreads, 16384);
+
+	std::sort(result.begin(), result.end());
+	result.erase(std::unique(result.begin(), result.end()), result.end());
+}
+
+bool QuickHull3D::createSimplex(const vector<int>& candidates) {
+	// two points furthest apart.
+	int i0 = -1;
+	int i1 = -1;
+	int64_t max_dist = 0;
+	for(size_t i = 0; i < candidates.size(); ++i) {
+		const int32_t* a = &grid[candidates[i] * 3];
+		for(size_t j = i + 1; j < candidates.size(); ++j) {
+			const int32_t* b = &grid[candidates[j] * 3];
+			int64_t dx = b[0] - a[0];
+			int64_t dy = b[1] - a[1];
+			int64_t dz = b[2] - a[2];
+			int64_t dist = dx * dx + dy * dy + dz * dz;
+			if(dist > max_dist) {
+				max_dist = dist;
+				i0 = candidates[i];
+				i1 = candidates[j];
+			}
+		}
+	}
+	if(i0 < 0) {
+		printf("QuickHull3D: all points are the same.\n");
+		return false;
+	}
+
+	// furthest from the line; try the extremes first, then all points.
+	const int32_t* p0 = &grid[i0 * 3];
+	const int32_t* p1 = &grid[i1 * 3];
+	int64_t ux = p1[0] - p0[0];
+	int64_t uy = p1[1] - p0[1];
+	int64_t uz = p1[2] - p0[2];
+	int i2 = -1;
+	double max_area = 0.0;
+	for(int pass = 0; pass < 2 && i2 < 0; ++pass) {
+		size_t num = (pass == 0) ? candidates.size() : num_points;
+		for(size_t i = 0; i < num; ++i) {
+			int p = (pass == 0) ? candidates[i] : i;
+			const int32_t* pp = &grid[p * 3];
+			int64_t dx = pp[0] - p0[0];
+			int64_t dy = pp[1] - p0[1];
+			int64_t dz = pp[2] - p0[2];
+			double cx = double(dy * uz - dz * uy);
+			double cy = double(dz * ux - dx * uz);
+			double cz = double(dx * uy - dy * ux);
+			double area = cx * cx + cy * cy + cz * cz;
+			if(area > max_area) {
+				max_area = area;
+				i2 = p;
+			}
+		}
+	}
+	if(i2 < 0) {
+		printf("QuickHull3D: all points are collinear.\n");
+		return false;
+	}
+
+	// furthest from the plane.
+	int base = createFace(i0, i1, i2);
+	int i3 = -1;
+	int64_t max_side = 0;
+	for(int pass = 0; pass < 2 && i3 < 0; ++pass) {
+		size_t num = (pass == 0) ? candidates.size() : num_points;
+		for(size_t i = 0; i < num; ++i) {
+			int p = (pass == 0) ? candidates[i] : i;
+			int64_t s = side(faces[base], p);
+			if(s < 0) {
+				s = -s;
+			}
+			if(s > max_side) {
+				max_side = s;
+				i3 = p;
+			}
+		}
+	}
+	bool flip = (i3 >= 0 && side(faces[base], i3) > 0);
+	faces.clear();
+	if(i3 < 0) {
+		printf("QuickHull3D: all points are coplanar.\n");
+		return false;
+	}
+
+	// the base must face away from the 4th point.
+	if(flip) {
+		std::swap(i1, i2);
+	}
+	createFace(i0, i1, i2);
+	createFace(i0, i2, i3);
+	createFace(i0, i3, i1);
+	createFace(i1, i3, i2);
+	linkFaces(0, 4);
+	return true;
+}
+
+// The normal and offset are exact: the grid coordinates are at most 
+// 2^19, so the normal is below 2^40 and side() below 2^61.
+int QuickHull3D::createFace(int a, int b, int c) {
+	const int32_t* pa = &grid[a * 3];
+	const int32_t* pb = &grid[b * 3];
+	const int32_t* pc = &grid[c * 3];
+	int64_t abx = pb[0] - pa[0];
+	int64_t aby = pb[1] - pa[1];
+	int64_t abz = pb[2] - pa[2];
+	int64_t acx = pc[0] - pa[0];
+	int64_t acy = pc[1] - pa[1];
+	int64_t acz = pc[2] - pa[2];
+
+	QuickHull3DFace f;
+	f.v[0] = a;
+	f.v[1] = b;
+	f.v[2] = c;
+	f.n[0] = f.n[1] = f.n[2] = -1;
+	f.nx = aby * acz - abz * acy;
+	f.ny = abz * acx - abx * acz;
+	f.nz = abx * acy - aby * acx;
+	f.d = f.nx * pa[0] + f.ny * pa[1] + f.nz * pa[2];
+	double len = sqrt(double(f.nx) * f.nx + double(f.ny) * f.ny + double(f.nz) * f.nz);
+	f.inv_len = (len > 0.0) ? 1.0 / len : 0.0;
+	f.first_point = -1;
+	f.far_point = -1;
+	f.far_dist = 0.0;
+	f.visible = 0;
+	f.alive = true;
+	faces.push_back(f);
+	return faces.size() - 1;
+}
+
+// connect the faces [first, last) which share an edge
+void QuickHull3D::linkFaces(int first, int last) {
+	for(int i = first; i < last; ++i) {
+		QuickHull3DFace& f = faces[i];
+		for(int e = 0; e < 3; ++e) {
+			int a = f.v[e];
+			int b = f.v[(e + 1) % 3];
+			for(int j = first; j < last && f.n[e] < 0; ++j) {
+				QuickHull3DFace& g = faces[j];
+				for(int k = 0; k < 3; ++k) {
+					if(g.v[k] == b && g.v[(k + 1) % 3] == a) {
+						f.n[e] = j;
+						break;
+					}
+				}
+			}
+		}
+	}
+}
+
+void QuickHull3D::addToOutside(int face, int p, double dist) {
+	QuickHull3DFace& f = faces[face];
+	point_next[p] = f.first_point;
+	f.first_point = p;
+	if(f.far_point < 0 || dist > f.far_dist) {
+		f.far_point = p;
+		f.far_dist = dist;
+	}
+}
+
+// Adds the furthest point of every face with an outside set; new faces
+// are appended so they are handled in the same loop.
+void QuickHull3D::expand(size_t firstFace) {
+	for(size_t i = firstFace; i < faces.size(); ++i) {
+		if(faces[i].alive && faces[i].first_point >= 0) {
+			addPoint(faces[i].far_point, i);
+		}
+	}
+}
+
+void QuickHull3D::addPoint(int eye, int face) {
+	++stamp;
+	visible_faces.clear();
+	horizon_faces.clear();
+	horizon_edges.clear();
+	new_faces.clear();
+
+	// all faces that see the eye point and the edges around them. The
+	// test is exact, so the visible faces always form a disk.
+	faces[face].visible = stamp;
+	visible_faces.push_back(face);
+	for(size_t k = 0; k < visible_faces.size(); ++k) {
+		int f = visible_faces[k];
+		for(int e = 0; e < 3; ++e) {
+			int nb = faces[f].n[e];
+			if(nb < 0 || faces[nb].visible == stamp) {
+				continue;
+			}
+			if(side(faces[nb], eye) > 0) {
+				faces[nb].visible = stamp;
+				visible_faces.push_back(nb);
+			}
+			else {
+				horizon_faces.push_back(f);
+				horizon_edges.push_back(e);
+			}
+		}
+	}
+
+	// a cone of new faces from the horizon to the eye.
+	for(size_t h = 0; h < horizon_faces.size(); ++h) {
+		int f = horizon_faces[h];
+		int e = horizon_edges[h];
+		int a = faces[f].v[e];
+		int b = faces[f].v[(e + 1) % 3];
+		int outer = faces[f].n[e];
+		int nf = createFace(a, b, eye);
+		faces[nf].n[0] = outer;
+		QuickHull3DFace& of = faces[outer];
+		for(int k = 0; k < 3; ++k) {
+			if(of.v[k] == b && of.v[(k + 1) % 3] == a) {
+				of.n[k] = nf;
+				break;
+			}
+		}
+		horizon_start[a] = nf;
+		new_faces.push_back(nf);
+	}
+	for(size_t i = 0; i < new_faces.size(); ++i) {
+		int nf = new_faces[i];
+		int next = horizon_start[faces[nf].v[1]];
+		faces[nf].n[1] = next;
+		if(next >= 0) {
+			faces[next].n[2] = nf;
+		}
+	}
+	for(size_t i = 0; i < new_faces.size(); ++i) {
+		horizon_start[faces[new_faces[i]].v[0]] = -1;
+	}
+
+	// move the outside points of the visible faces to the new faces.
+	for(size_t k = 0; k < visible_faces.size(); ++k) {
+		int f = visible_faces[k];
+		int p = faces[f].first_point;
+		while(p >= 0) {
+			int next = point_next[p];
+			if(p != eye) {
+				int best = -1;
+				double best_dist = 0.0;
+				for(size_t i = 0; i < new_faces.size(); ++i) {
+					const QuickHull3DFace& nf = faces[new_faces[i]];
+					int64_t s = side(nf, p);
+					if(s > 0 && s * nf.inv_len > best_dist) {
+						best_dist = s * nf.inv_len;
+						best = new_faces[i];
+					}
+				}
+				if(best >= 0) {
+					addToOutside(best, p, best_dist);
+				}
+			}
+			p = next;
+		}
+		faces[f].first_point = -1;
+		faces[f].alive = false;
+	}
+}
+
+// Test all points against the current hull in parallel; the points
+// inside are dropped.
+void QuickHull3D::partition(int numThreads) {
+	vector<int64_t> planes;
+	vector<double> inv_lens;
+	vector<int> face_ids;
+	for(size_t i = 0; i < faces.size(); ++i) {
+		const QuickHull3DFace& f = faces[i];
+		if(!f.alive) {
+			continue;
+		}
+		planes.push_back(f.nx);
+		planes.push_back(f.ny);
+		planes.push_back(f.nz);
+		planes.push_back(f.d);
+		inv_lens.push_back(f.inv_len);
+		face_ids.push_back(i);
+	}
+	assignment.resize(num_points);
+	assignment_dist.resize(num_points);
+
+	QuickHull3DPartitionTask task;
+	task.hull = this;
+	task.planes = &planes[0];
+	task.inv_lens = &inv_lens[0];
+	task.face_ids = &face_ids[0];
+	task.num_faces = face_ids.size();
+	parallelFor(num_points, task, numThreads, 16384);
+
+	for(size_t i = 0; i < num_points; ++i) {
+		if(assignment[i] >= 0) {
+			addToOutside(assignment[i], i, assignment_dist[i]);
+		}
+	}
+}
+
+} // roxlu
@@ -0,0 +1,107 @@
+#ifndef ROXLU_QUICKHULL3DH
+#define ROXLU_QUICKHULL3DH
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+#include "Vec3.h"
+
+using std::vector;
+
+/**
+ * QuickHull for large 3D point clouds, without GeometricTools.
+ *
+ * We first take the extreme points along 14 directions (the axes and
+ * the diagonals) and build their hull (Akl-Toussaint); every point is
+ * then tested against the faces of this small hull in parallel. Points
+ * which are inside are dropped right away, which for dense clouds is
+ * nearly all of them. The remaining points are added with the usual
+ * QuickHull steps.
+ *
+ * The points are snapped to a 2^19 grid inside their bounding box and
+ * all above/below tests are done exactly with integers on this grid,
+ * so (nearly) coplanar points can't break the hull. The result refers
+ * to the original points. It is a triangle mesh; coplanar faces are not
+ * merged.
+ *
+ * All buffers are kept between calls to compute(), so when you compute
+ * a hull for every frame of a depth camera nothing is reallocated once
+ * the sizes settle.
+ *
+ *		roxlu::QuickHull3D hull;
+ *		roxlu::VertexData vd;
+ *		if(hull.compute(&points[0].x, points.size(), vd)) {
+ *			vd.debugDraw();
+ *		}
+ *
+ */
+namespace roxlu {
+
+class VertexData;
+
+struct QuickHull3DFace {
+	int v[3]; // counter clockwise seen from outside
+	int n[3]; // neighbor over the edge v[i] -> v[(i + 1) % 3]
+	int64_t nx; // not normalized
+	int64_t ny;
+	int64_t nz;
+	int64_t d;
+	double inv_len;
+	int first_point; // outside set, linked through QuickHull3D::point_next
+	int far_point;
+	double far_dist;
+	unsigned int visible; // stamp
+	bool alive;
+};
+
+class QuickHull3D {
+public:
+	QuickHull3D();
+	bool compute(const float* xyz, size_t num, int numThreads = 0); // xyz: 3 floats per point
+	bool compute(const float* xyz, size_t num, VertexData& result, int numThreads = 0);
+	bool compute(const vector<Vec3>& points, VertexData& result, int numThreads = 0);
+	void getVertexData(VertexData& result);
+	inline const vector<int>& getIndices() const; // 3 per triangle, index in the input points
+
+private:
+	inline int64_t side(const QuickHull3DFace& f, int p) const; // > 0 when p is above f
+	bool createSimplex(const vector<int>& candidates);
+	int createFace(int a, int b, int c);
+	void linkFaces(int first, int last);
+	void addToOutside(int face, int p, double dist);
+	void expand(size_t firstFace);
+	void addPoint(int eye, int face);
+	void partition(int numThreads);
+	void snap(vector<int>& extremes, int numThreads);
+
+	const float* points;
+	size_t num_points;
+	vector<int32_t> grid; // snapped points
+	unsigned int stamp;
+	vector<QuickHull3DFace> faces;
+	vector<int> point_next;
+	vector<int> horizon_start; // by vertex, new face with this vertex as start of the horizon edge
+	vector<int> visible_faces;
+	vector<int> horizon_faces;
+	vector<int> horizon_edges;
+	vector<int> new_faces;
+	vector<int> assignment; // by point, face index or -1
+	vector<double> assignment_dist;
+	vector<int> vertex_map; // by point, index in the result
+	vector<int> indices;
+
+	friend struct QuickHull3DPartitionTask;
+};
+
+inline const vector<int>& QuickHull3D::getIndices() const {
+	return indices;
+}
+
+inline int64_t QuickHull3D::side(const QuickHull3DFace& f, int p) const {
+	const int32_t* pp = &grid[p * 3];
+	return f.nx * pp[0] + f.ny * pp[1] + f.nz * pp[2] - f.d;
+}
+
+} // roxlu
+
+#endif
@@ -45,18 +45,81 @@ Retrieved from: http://en.literateprograms.org/Floyd-Steinberg_dithering_(C)?old
 */
 
 #include <vector>
+#include <algorithm>
+#include "MedianCut.h"
 
-#define plus_truncate_uchar(a, b) \
-    if (((int)(a)) + (b) < 0) \
-        (a) = 0; \
-    else if (((int)(a)) + (b) > 255) \
-        (a) = 255; \
-    else \
-        (a) += (b);
+// Nearest palette color using a 32x32x32 lookup table; every cell stores
+// the palette entry which is nearest to the center of the cell. The small 
+// error this gives is spread by the dithering like any other error.
+// -----------------------------------------------------------------------------
+class PaletteLookup {
+public:
+	PaletteLookup();
+	void setup(const std::vector<MCPoint>& palette);
+	inline unsigned char findNearestColor(int r, int g, int b) const;
+	inline const MCPoint& getColor(unsigned char index) const;
+	inline const std::vector<MCPoint>& getPalette() const;
+	inline size_t size() const;
+
+private:
+	std::vector<MCPoint> palette;
+	std::vector<unsigned char> table;
+};
+
+inline PaletteLookup::PaletteLookup()
+	:table(32 * 32 * 32, 0)
+{
+}
 
-#define DXD(i,j,w) ( ((j)*(w)*3) + ((i)*3)  )
+inline void PaletteLookup::setup(const std::vector<MCPoint>& colors) {
+	palette = colors;
+	if(!palette.size()) {
+		std::fill(table.begin(), table.end(), 0);
+		return;
+	}
+	unsigned char* dest = &table[0];
+	for(int r = 4; r < 256; r += 8) {
+		for(int g = 4; g < 256; g += 8) {
+			for(int b = 4; b < 256; b += 8) {
+				int min_dist_sq = 255*255 + 255*255 + 255*255 + 1;
+				int best_index = 0;
+				for(size_t i = 0; i < palette.size(); ++i) {
+					const MCPoint& pt = palette[i];
+					int rd = r - pt.x[0];
+					int gd = g - pt.x[1];
+					int bd = b - pt.x[2];
+					int dist_sq = (rd*rd) + (gd*gd) + (bd*bd);
+					if(dist_sq < min_dist_sq) {
+						min_dist_sq = dist_sq;
+						best_index = i;
+					}
+				}
+				*dest++ = best_index;
+			}
+		}
+	}
+}
 
+inline unsigned char PaletteLookup::findNearestColor(int r, int g, int b) const {
+	return table[((r >> 3) << 10) | ((g >> 3) << 5) | (b >> 3)];
+}
 
+inline const MCPoint& PaletteLookup::getColor(unsigned char index) const {
+	return palette[index];
+}
+
+inline const std::vector<MCPoint>& PaletteLookup::getPalette() const {
+	return palette;
+}
+
+inline size_t PaletteLookup::size() const {
+	return palette.size();
+}
+
+// Floyd–Steinberg dithering, see http://en.wikipedia.org/wiki/Floyd%E2%80%93Steinberg_dithering
+// The errors are kept in two rows (* 16) so the input is not changed and 
+// one Dither can be used per thread.
+// -----------------------------------------------------------------------------
 class Dither {
 
 public:
@@ -69,106 +132,84 @@ public:
 			,std::vector<MCPoint>& palette
 	);
 
-private:
-
-	unsigned int findNearestColor(unsigned char* pix, std::vector<MCPoint>& palette);
-
-	void disperse(
-			 unsigned int i
-			,unsigned int j
-			,unsigned int w
+	void dither(
+			 unsigned int w
 			,unsigned int h
-			,unsigned char* input
-			,MCPoint& pallete
-			,unsigned int channel
+			,const unsigned char* input
+			,unsigned char* output  // w * h  (not: w * h * 3), this is the indexed result
+			,const PaletteLookup& lookup
+			,unsigned int stride = 0 // pixels per input row, when you dither a part of an image
 	);
-};
-
-
-// Simple color distance.
-// -----------------------------------------------------------------------------
-inline unsigned int Dither::findNearestColor(unsigned char* pix, std::vector<MCPoint>& palette) {
-	std::vector<MCPoint>::iterator it = palette.begin();
-	int dist_sq = 0;
-	int min_dist_sq = 255*255 + 255*255 + 255*255 + 1;
-	int rd, gd, bd = 0;
-	int dx = 0;
-	int best_index = 0;
-	while(it != palette.end()) {
-		MCPoint& pt = *it;
-		rd = ((int)pix[0]) - pt.x[0];
-		gd = ((int)pix[1]) - pt.x[1];
-		bd = ((int)pix[2]) - pt.x[2];
-		dist_sq = (rd*rd) + (gd*gd) + (bd*bd);
-		if(dist_sq < min_dist_sq) {
-			min_dist_sq = dist_sq;
-			best_index = dx;
-		}
-		++dx;
-		++it;
-	}
-	return best_index;
-}
 
+private:
+	PaletteLookup lookup; // used by the palette version of dither()
+	std::vector<int> errors;
+};
 
-// Floyd–Steinberg dithering
-// -----------------------------------------------------------------------------
-inline void Dither::disperse(
-			 unsigned int i
-			,unsigned int j
-			,unsigned int w
-			,unsigned int h
-			,unsigned char* input
-			,MCPoint& palette
-			,unsigned int channel
-)
+inline void Dither::dither(
+		 unsigned int w
+		,unsigned int h
+		,unsigned char* input
+		,unsigned char* output
+		,std::vector<MCPoint>& palette
+) 
 {
-	int error = ((int)input[DXD(i,j,w)+channel]) - palette.x[channel];
-	if(i + 1 < w) {
-		plus_truncate_uchar(input[DXD(i+1,j,w)+channel], (error*7) >> 4);
-	}
-	if(j + 1 < h) {
-		if(i - 1 > 0) {
-			plus_truncate_uchar(input[DXD(i-1,j+1,w)+channel], (error*3) >> 4);
-		}
-		plus_truncate_uchar(input[DXD(i,j+1,w)+channel], (error*5) >> 4);
-		if(i + 1 < w) {
-			plus_truncate_uchar(input[DXD(i+1,j+1,w)+channel], (error*1) >> 4);
-		}
-	}
+	lookup.setup(palette);
+	dither(w, h, input, output, lookup);
 }
 
 inline void Dither::dither(
 		 unsigned int w
 		,unsigned int h
-		,unsigned char* input
-		,unsigned char* output  // w * h  (not: w * h * 3), this is the indexed result
-		,std::vector<MCPoint>& palette
+		,const unsigned char* input
+		,unsigned char* output
+		,const PaletteLookup& lookup
+		,unsigned int stride
 ) 
 {
-	unsigned char* curr_pix;
-	int error = 0;
-	int dx = 0;
-	MCPoint palette_pix;
-
-	unsigned char new_index = 0;
-	for(int i = 0; i < w; ++i) {
-		for(int j = 0; j < h; ++j) {
-		
+	if(!lookup.size()) {
+		return;
+	}
+	if(!stride) {
+		stride = w;
+	}
+
+	// two rows with one extra pixel at both ends so we don't need to test the borders.
+	size_t row_size = (w + 2) * 3;
+	errors.assign(row_size * 2, 0);
+	int* curr_err = &errors[0];
+	int* next_err = &errors[row_size];
+
+	for(unsigned int j = 0; j < h; ++j) {
+		const unsigned char* curr_pix = input + j * stride * 3;
+		unsigned char* curr_out = output + j * w;
+		for(unsigned int i = 0; i < w; ++i) {
+			int* err = curr_err + (i + 1) * 3;
+			int* next = next_err + (i + 1) * 3;
+			int v[3];
+			for(int c = 0; c < 3; ++c) {
+				v[c] = curr_pix[c] + ((err[c] + 8) >> 4);
+				v[c] = (v[c] < 0) ? 0 : (v[c] > 255) ? 255 : v[c];
+			}
+
 			// find best palette color.
-			int dx = (j * w * 3) + i * 3;
-			curr_pix = input+dx;
-			new_index = findNearestColor(curr_pix, palette);
-			output[j*w+i] = new_index;
-			palette_pix = palette[new_index];
-
-			// and disperpse a la http://en.wikipedia.org/wiki/Floyd%E2%80%93Steinberg_dithering
-			disperse(i,j,w,h,input,palette_pix, 0);
-			disperse(i,j,w,h,input,palette_pix, 1);
-			disperse(i,j,w,h,input,palette_pix, 2);
+			unsigned char new_index = lookup.findNearestColor(v[0], v[1], v[2]);
+			curr_out[i] = new_index;
+			const MCPoint& palette_pix = lookup.getColor(new_index);
+
+			// and disperse
+			for(int c = 0; c < 3; ++c) {
+				int error = v[c] - palette_pix.x[c];
+				err[c + 3] += error * 7;
+				next[c - 3] += error * 3;
+				next[c] += error * 5;
+				next[c + 3] += error;
+			}
+			curr_pix += 3;
 		}
+		std::swap(curr_err, next_err);
+		std::fill(next_err, next_err + row_size, 0);
 	}
 }
-		
 
-#endif
\ No newline at end of file
+#endif
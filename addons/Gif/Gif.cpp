@@ -1,29 +1,117 @@
 #include "Gif.h"
+#include <stdint.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 namespace roxlu {
 
+// The LZW encoder in GifIO uses global state.
+static pthread_mutex_t gif_encode_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Number of equal bytes at the start of a and b.
+static size_t gif_equal_length(const unsigned char* a, const unsigned char* b, size_t n) {
+	size_t i = 0;
+#if defined(__SSE2__)
+	for(; i + 16 <= n; i += 16) {
+		__m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+		__m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+		int eq = _mm_movemask_epi8(_mm_cmpeq_epi8(va, vb));
+		if(eq != 0xFFFF) {
+			return i + __builtin_ctz(~eq);
+		}
+	}
+#endif
+	for(; i < n; ++i) {
+		if(a[i] != b[i]) {
+			return i;
+		}
+	}
+	return n;
+}
+
+// Number of bytes up to and including the last different byte, 0 when equal.
+static size_t gif_diff_length(const unsigned char* a, const unsigned char* b, size_t n) {
+	size_t i = n;
+#if defined(__SSE2__)
+	for(; i >= 16; i -= 16) {
+		__m128i va = _mm_loadu_si128((const __m128i*)(a + i - 16));
+		__m128i vb = _mm_loadu_si128((const __m128i*)(b + i - 16));
+		int diff = ~_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) & 0xFFFF;
+		if(diff) {
+			return i - 16 + (32 - __builtin_clz(diff));
+		}
+	}
+#endif
+	for(; i > 0; --i) {
+		if(a[i - 1] != b[i - 1]) {
+			return i;
+		}
+	}
+	return 0;
+}
+
+void GifFrameTask::run() {
+	gif->quantizeFrame(*frame);
+	if(gif->fp) {
+		gif->frameDone(frame);
+	}
+}
+
 Gif::Gif(int width, int height, int numColorsInPalette, int loop)
 	:width(width)
 	,height(height)
 	,palette_size(numColorsInPalette)
-	,palette_created(false)
 	,num_loops(loop)
+	,max_palette_samples(65536)
+	,use_delta_frames(true)
+	,use_local_palettes(false)
+	,local_palette_error(200.0f)
 	,is_setup(true)
+	,palette_created(false)
+	,bits_per_pixel(8)
+	,fp(NULL)
+	,header_written(false)
+	,is_writing(false)
+	,num_added(0)
+	,num_written(0)
 {
-
+	pthread_mutex_init(&mutex, NULL);
+	pthread_cond_init(&free_cond, NULL);
 }
 
-Gif::Gif() 
+Gif::Gif()
 	:width(0)
 	,height(0)
 	,palette_size(32)
-	,palette_created(false)
 	,num_loops(0)
+	,max_palette_samples(65536)
+	,use_delta_frames(true)
+	,use_local_palettes(false)
+	,local_palette_error(200.0f)
 	,is_setup(false)
+	,palette_created(false)
+	,bits_per_pixel(8)
+	,fp(NULL)
+	,header_written(false)
+	,is_writing(false)
+	,num_added(0)
+	,num_written(0)
 {
+	pthread_mutex_init(&mutex, NULL);
+	pthread_cond_init(&free_cond, NULL);
 }
 
 Gif::~Gif() {
+	if(fp) {
+		close();
+	}
+	for(size_t i = 0; i < frames.size(); ++i) {
+		deleteFrame(frames[i]);
+	}
+	frames.clear();
+	pthread_cond_destroy(&free_cond);
+	pthread_mutex_destroy(&mutex);
 }
 
 void Gif::addColor(unsigned char r, unsigned char g, unsigned char b) {
@@ -40,18 +128,76 @@ void Gif::setup(int w, int h) {
 	is_setup = true;
 }
 
+GifFrame* Gif::createFrame() {
+	GifFrame* frame = new GifFrame();
+	frame->pixels = new unsigned char[width*height*3];
+	frame->data = new unsigned char[width*height];
+	frame->mask = new unsigned char[width*height];
+	frame->delay = 0;
+	frame->index = 0;
+	frame->x = 0;
+	frame->y = 0;
+	frame->w = width;
+	frame->h = height;
+	frame->use_mask = false;
+	frame->transparent = -1;
+	frame->bits_per_pixel = 8;
+	frame->has_local_palette = false;
+	frame->task.gif = this;
+	frame->task.frame = frame;
+	return frame;
+}
+
+void Gif::deleteFrame(GifFrame* frame) {
+	delete[] frame->pixels;
+	delete[] frame->data;
+	delete[] frame->mask;
+	delete frame;
+}
+
 void Gif::addFrame(unsigned char* pixels, int delay, bool useForPalette) {
 	if(!is_setup) {
 		return;
 	}
-	
+
+	if(fp) {
+		// the palette is part of the header so we can only set it once.
+		if(!header_written) {
+			if(!palette.size()) {
+				createPalette(pixels);
+			}
+			lookup.setup(palette);
+			writeHeader(fp);
+			header_written = true;
+		}
+
+		pthread_mutex_lock(&mutex);
+		while(!free_frames.size()) {
+			pthread_cond_wait(&free_cond, &mutex);
+		}
+		GifFrame* frame = free_frames.back();
+		free_frames.pop_back();
+		frame->index = num_added++;
+		pthread_mutex_unlock(&mutex);
+
+		memcpy(frame->pixels, pixels, width*height*3 * sizeof(unsigned char));
+		frame->delay = delay;
+		if(use_delta_frames) {
+			computeDelta(*frame, (frame->index > 0) ? &prev_pixels[0] : NULL);
+			memcpy(&prev_pixels[0], pixels, width*height*3 * sizeof(unsigned char));
+		}
+		else {
+			computeDelta(*frame, NULL);
+		}
+		pool.add(&frame->task);
+		return;
+	}
+
 	// add a new frame to the queue.
-	GifFrame* frame = new GifFrame();
-	frame->pixels = new unsigned char[width*height*3];
-	frame->data = new unsigned char[width*height]; 
-	memcpy(frame->pixels, pixels, width*height*3 * sizeof(unsigned char));	
+	GifFrame* frame = createFrame();
+	memcpy(frame->pixels, pixels, width*height*3 * sizeof(unsigned char));
 	frame->delay = delay;
-	
+
 	// create palette when not yet created and when asked to do.
 	if(useForPalette) {
 		createPalette(pixels);
@@ -60,47 +206,312 @@ void Gif::addFrame(unsigned char* pixels, int delay, bool useForPalette) {
 	frames.push_back(frame);
 }
 
+// We use a sample of the pixels: one random pixel from every block of
+// width * height / max_palette_samples pixels.
 void Gif::createPalette(unsigned char* pixels) {
-	unsigned char* copy = new unsigned char[width*height*3];
-	memcpy(copy, pixels, width*height*3 * sizeof(unsigned char));	
-	palette = medianCut((MCPoint*)copy, width*height, palette_size);
-	delete[] copy;
+	size_t num_pixels = width * height;
+	size_t num_samples = std::min<size_t>(num_pixels, max_palette_samples);
+	if(!num_samples) {
+		return;
+	}
+	samples.resize(num_samples * 3);
+	uint32_t seed = 0x12345678;
+	for(size_t i = 0; i < num_samples; ++i) {
+		size_t first = (i * num_pixels) / num_samples;
+		size_t last = ((i + 1) * num_pixels) / num_samples;
+		seed = seed * 1664525 + 1013904223;
+		size_t dx = (first + (seed >> 8) % (last - first)) * 3;
+		samples[i * 3 + 0] = pixels[dx + 0];
+		samples[i * 3 + 1] = pixels[dx + 1];
+		samples[i * 3 + 2] = pixels[dx + 2];
+	}
+	// keep one entry free for the transparent color of the delta frames
+	int num_colors = (use_delta_frames) ? std::min<int>(palette_size, 255) : palette_size;
+	palette = medianCut((MCPoint*)&samples[0], num_samples, num_colors);
 	palette_created = true;
 }
 
-bool Gif::save(const char* filepath) {
+bool Gif::save(const char* filepath, int numThreads) {
 	if(!frames.size()) {
 		return false;
 	}
-	
+	if(fp) {
+		printf("Gif: cannot save() while streaming, use close().\n");
+		return false;
+	}
+
 	if(!palette_created) {
 		createPalette(frames[0]->pixels);
 	}
-	
-	
-	FILE* fp;
-	fp = fopen(filepath,"wb");
-	GIFEncodeHeader(fp, 1, width, height, 0, 8,(unsigned char*)palette[0].x);
+	lookup.setup(palette);
+
+	FILE* save_fp = fopen(filepath,"wb");
+	if(!save_fp) {
+		printf("Gif: cannot open %s\n", filepath);
+		return false;
+	}
+	writeHeader(save_fp);
+
+	// dither all frames in parallel, then write them in order.
+	ThreadPool save_pool;
+	save_pool.start(numThreads);
+	for(size_t i = 0; i < frames.size(); ++i) {
+		computeDelta(*frames[i], (i > 0) ? frames[i - 1]->pixels : NULL);
+		save_pool.add(&frames[i]->task);
+	}
+	save_pool.wait();
+
+	for(size_t i = 0; i < frames.size(); ++i) {
+		writeFrame(save_fp, *frames[i]);
+	}
+
+	GIFEncodeClose(save_fp); // closes the file
+	return true;
+}
+
+bool Gif::open(const char* filepath, int numThreads, int maxFramesInMemory) {
+	if(!is_setup) {
+		printf("Gif: call setup() before open().\n");
+		return false;
+	}
+	if(fp) {
+		close();
+	}
+	fp = fopen(filepath, "wb");
+	if(!fp) {
+		printf("Gif: cannot open %s\n", filepath);
+		return false;
+	}
+	pool.start(numThreads);
+	if(maxFramesInMemory <= 0) {
+		maxFramesInMemory = std::max<int>(2, pool.getNumThreads() * 2);
+	}
+	for(int i = 0; i < maxFramesInMemory; ++i) {
+		free_frames.push_back(createFrame());
+	}
+	done_frames.assign(maxFramesInMemory, NULL);
+	if(use_delta_frames) {
+		prev_pixels.resize(width * height * 3);
+	}
+	header_written = false;
+	is_writing = false;
+	num_added = 0;
+	num_written = 0;
+	return true;
+}
+
+bool Gif::close() {
+	if(!fp) {
+		return false;
+	}
+	pool.wait();
+	pool.stop();
+	bool result = header_written;
+	if(header_written) {
+		GIFEncodeClose(fp); // closes the file
+	}
+	else {
+		printf("Gif: no frames added, file is not valid.\n");
+		fclose(fp);
+	}
+	fp = NULL;
+	for(size_t i = 0; i < free_frames.size(); ++i) {
+		deleteFrame(free_frames[i]);
+	}
+	free_frames.clear();
+	done_frames.clear();
+	return result;
+}
+
+// Frames can finish in any order; the thread which finishes the next frame
+// in line writes it, together with the frames after it which are ready.
+void Gif::frameDone(GifFrame* frame) {
+	pthread_mutex_lock(&mutex);
+	done_frames[frame->index % done_frames.size()] = frame;
+	if(is_writing) {
+		pthread_mutex_unlock(&mutex);
+		return;
+	}
+	is_writing = true;
+	while(true) {
+		GifFrame*& next = done_frames[num_written % done_frames.size()];
+		if(!next || next->index != num_written) {
+			break;
+		}
+		GifFrame* f = next;
+		next = NULL;
+		pthread_mutex_unlock(&mutex);
+
+		writeFrame(fp, *f);
+
+		pthread_mutex_lock(&mutex);
+		++num_written;
+		free_frames.push_back(f);
+		pthread_cond_signal(&free_cond);
+	}
+	is_writing = false;
+	pthread_mutex_unlock(&mutex);
+}
+
+// Finds the rectangle which changed and which pixels in it changed. When 
+// nothing changed we write one transparent pixel.
+void Gif::computeDelta(GifFrame& frame, const unsigned char* prevPixels) {
+	frame.x = 0;
+	frame.y = 0;
+	frame.w = width;
+	frame.h = height;
+	frame.use_mask = false;
+	if(!use_delta_frames || !prevPixels) {
+		return;
+	}
+
+	size_t row_size = width * 3;
+	const unsigned char* curr = frame.pixels;
+	int top = 0;
+	while(top < height && gif_equal_length(curr + top * row_size, prevPixels + top * row_size, row_size) == row_size) {
+		++top;
+	}
+	if(top == height) {
+		frame.w = frame.h = 1;
+		frame.use_mask = true;
+		frame.mask[0] = 0;
+		return;
+	}
+	int bottom = height - 1;
+	while(bottom > top && gif_equal_length(curr + bottom * row_size, prevPixels + bottom * row_size, row_size) == row_size) {
+		--bottom;
+	}
+
+	// we only have to test the bytes outside the columns we found so far.
+	size_t left = row_size;
+	size_t right = 0;
+	for(int j = top; j <= bottom; ++j) {
+		const unsigned char* a = curr + j * row_size;
+		const unsigned char* b = prevPixels + j * row_size;
+		left = gif_equal_length(a, b, left);
+		right += gif_diff_length(a + right, b + right, row_size - right);
+	}
+	frame.x = left / 3;
+	frame.y = top;
+	frame.w = (right + 2) / 3 - frame.x;
+	frame.h = bottom - top + 1;
+
+	frame.use_mask = true;
+	unsigned char* mask = frame.mask;
+	for(int j = 0; j < frame.h; ++j) {
+		size_t dx = ((frame.y + j) * width + frame.x) * 3;
+		const unsigned char* a = curr + dx;
+		const unsigned char* b = prevPixels + dx;
+		for(int i = 0; i < frame.w; ++i, a += 3, b += 3) {
+			*mask++ = (a[0] != b[0]) | (a[1] != b[1]) | (a[2] != b[2]);
+		}
+	}
+}
+
+// Mean squared distance to the nearest palette color for a sample of 
+// the pixels in the rectangle of the frame.
+float Gif::getPaletteError(GifFrame& frame, const PaletteLookup& lut) {
+	size_t num_pixels = frame.w * frame.h;
+	size_t step = std::max<size_t>(1, num_pixels / 1024);
+	size_t num = 0;
+	float error = 0.0f;
+	for(size_t i = 0; i < num_pixels; i += step) {
+		if(frame.use_mask && !frame.mask[i]) {
+			continue;
+		}
+		const unsigned char* p = frame.pixels + ((frame.y + i / frame.w) * width + frame.x + i % frame.w) * 3;
+		const MCPoint& c = lut.getColor(lut.findNearestColor(p[0], p[1], p[2]));
+		int rd = p[0] - c.x[0];
+		int gd = p[1] - c.x[1];
+		int bd = p[2] - c.x[2];
+		error += rd * rd + gd * gd + bd * bd;
+		++num;
+	}
+	return (num) ? error / num : 0.0f;
+}
+
+// Runs on the thread pool.
+void Gif::quantizeFrame(GifFrame& frame) {
+	const PaletteLookup* lut = &lookup;
+	frame.has_local_palette = false;
+	if(use_local_palettes && getPaletteError(frame, lookup) > local_palette_error) {
+		size_t num_pixels = frame.w * frame.h;
+		size_t num_samples = std::min<size_t>(num_pixels, max_palette_samples);
+		size_t step = std::max<size_t>(1, num_pixels / num_samples);
+		frame.samples.clear();
+		for(size_t i = 0; i < num_pixels; i += step) {
+			if(frame.use_mask && !frame.mask[i]) {
+				continue;
+			}
+			const unsigned char* p = frame.pixels + ((frame.y + i / frame.w) * width + frame.x + i % frame.w) * 3;
+			frame.samples.insert(frame.samples.end(), p, p + 3);
+		}
+		if(frame.samples.size()) {
+			frame.local_lookup.setup(medianCut((MCPoint*)&frame.samples[0], frame.samples.size() / 3, std::min<int>(palette_size, 255)));
+			lut = &frame.local_lookup;
+			frame.has_local_palette = true;
+		}
+	}
+
+	const unsigned char* pixels = frame.pixels + (frame.y * width + frame.x) * 3;
+	frame.dither.dither(frame.w, frame.h, pixels, frame.data, *lut, width);
+
+	frame.transparent = -1;
+	if(frame.use_mask && lut->size() < 256) {
+		frame.transparent = lut->size();
+		for(int i = 0; i < frame.w * frame.h; ++i) {
+			if(!frame.mask[i]) {
+				frame.data[i] = frame.transparent;
+			}
+		}
+	}
+
+	frame.bits_per_pixel = 1;
+	while((1 << frame.bits_per_pixel) < (int)lut->size() + 1 && frame.bits_per_pixel < 8) {
+		++frame.bits_per_pixel;
+	}
+}
+
+void Gif::writeHeader(FILE* fp) {
+	// smallest color table which fits the palette (and the transparent color)
+	int num_colors = palette.size() + ((use_delta_frames) ? 1 : 0);
+	bits_per_pixel = 1;
+	while((1 << bits_per_pixel) < num_colors && bits_per_pixel < 8) {
+		++bits_per_pixel;
+	}
+	unsigned char cmap[256 * 3];
+	memset(cmap, 0, sizeof(cmap));
+	for(size_t i = 0; i < palette.size() && i < 256; ++i) {
+		cmap[i * 3 + 0] = palette[i].x[0];
+		cmap[i * 3 + 1] = palette[i].x[1];
+		cmap[i * 3 + 2] = palette[i].x[2];
+	}
+	GIFEncodeHeader(fp, 1, width, height, 0, bits_per_pixel, cmap);
+	GIFEncodeLoopExt(fp, num_loops); // must be before the first image
 	GIFEncodeCommentExt(fp,(char*) "Roxlu lib");
-	
-	// write frames.
-	Dither dither;
+}
+
+void Gif::writeFrame(FILE* fp, GifFrame& f) {
 	int disposal = DISPOSE_COMBINE;
 	//typedef enum GIFDisposeType {DISPOSE_UNSPECIFIED, DISPOSE_COMBINE, DISPOSE_REPLACE } GIFDisposeType;
-	vector<GifFrame*>::iterator it = frames.begin();
-	while(it != frames.end()) {
-		GifFrame& f = *(*it);
-		dither.dither(width, height, f.pixels, f.data, palette);
-		GIFEncodeGraphicControlExt(fp, (GIFDisposeType)disposal,f.delay, (f.delay) > 0 ? 1 : 0,-1);
-		GIFEncodeImageData (fp, width, height, 8, 0, 0, f.data);
-		++it;
+	int animation = (f.delay > 0 || f.transparent >= 0) ? 1 : 0;
+	pthread_mutex_lock(&gif_encode_mutex);
+	GIFEncodeGraphicControlExt(fp, (GIFDisposeType)disposal,f.delay, animation, f.transparent);
+	if(f.has_local_palette) {
+		unsigned char cmap[256 * 3];
+		memset(cmap, 0, sizeof(cmap));
+		const vector<MCPoint>& colors = f.local_lookup.getPalette();
+		for(size_t i = 0; i < colors.size(); ++i) {
+			cmap[i * 3 + 0] = colors[i].x[0];
+			cmap[i * 3 + 1] = colors[i].x[1];
+			cmap[i * 3 + 2] = colors[i].x[2];
+		}
+		GIFEncodeImageDataCmap(fp, f.w, f.h, f.bits_per_pixel, f.x, f.y, f.data, cmap);
 	}
-	
-	GIFEncodeLoopExt(fp, num_loops);
-	GIFEncodeClose(fp);
-
-	fclose(fp);
+	else {
+		GIFEncodeImageData (fp, f.w, f.h, bits_per_pixel, f.x, f.y, f.data);
+	}
+	pthread_mutex_unlock(&gif_encode_mutex);
 }
- 
 
-}
\ No newline at end of file
+} // roxlu
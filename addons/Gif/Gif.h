@@ -4,11 +4,13 @@
 #include "GifIO.h"
 #include "MedianCut.h"
 #include "Dither.h"
+#include "ThreadPool.h"
+#include <pthread.h>
 #include <vector>
 
 /*
 
- 
+
 How to use:
 -----------
 
@@ -17,16 +19,63 @@ unsigned char* rgb_pixels = ... // works only with rgb
 g->addFrame(pixels, 100);
 g->save("filename.gif");
 
+
+Streaming:
+----------
+When you record for a long time, open() the file first. Every frame you
+add is then dithered on a thread pool and written as soon as it's ready,
+so only a couple of frames are in memory (addFrame() waits when all are
+in use). The palette is created from the first frame (unless you added
+colors with addColor()) and is used for all frames.
+
+roxlu::Gif g(width, height, 64);
+g.open("recording.gif");
+g.addFrame(pixels, 40); // every frame
+g.close();
+
+
+Delta frames:
+-------------
+By default we only write the rectangle which changed since the previous
+frame; the pixels in it which didn't change are transparent. For mostly
+static captures this makes the files a lot smaller and faster to encode.
+One palette entry is used for transparency. Set use_local_palettes when
+the colors change a lot over time: frames for which the global palette
+gives a mean squared error above local_palette_error get their own.
+
 */
 
 using std::vector;
 
 namespace roxlu {
 
+class Gif;
+struct GifFrame;
+
+struct GifFrameTask : public ThreadTask {
+	void run();
+	Gif* gif;
+	GifFrame* frame;
+};
+
 struct GifFrame {
 	unsigned char* pixels;
 	unsigned char* data;
 	int delay;
+	size_t index; // frame number, used when streaming
+	int x; // rectangle which changed since the previous frame
+	int y;
+	int w;
+	int h;
+	unsigned char* mask; // w * h, 0 when the pixel didn't change
+	bool use_mask;
+	int transparent; // index, -1 = none
+	int bits_per_pixel;
+	bool has_local_palette;
+	PaletteLookup local_lookup;
+	vector<unsigned char> samples;
+	Dither dither;
+	GifFrameTask task;
 };
 
 class Gif {
@@ -34,27 +83,62 @@ public:
 	Gif(int width, int height, int numColorsInPalette = 32, int numLoop = 0);
 	Gif();
 	~Gif();
-	
+
 	void setup(int width, int height);
 	void addColor(unsigned char r, unsigned char g, unsigned char b);
-	void addFrame(unsigned char* pixels, int delay = 0, bool useForPalette = true);
-	bool save(const char* filepath);
+	void addFrame(unsigned char* pixels, int delay = 0, bool useForPalette = true); // useForPalette is ignored when streaming
+	bool save(const char* filepath, int numThreads = 0);
 	void createPalette(unsigned char* pixels);
-	
+
+	// streaming
+	bool open(const char* filepath, int numThreads = 0, int maxFramesInMemory = 0); // 0 = 2 per thread
+	bool close();
+
 	int width;
 	int height;
 	int palette_size;
 	int num_loops; // 0 for infite
 	const char* filepath;
-	
+	size_t max_palette_samples; // createPalette() uses at most this number of pixels
+	bool use_delta_frames; // only write the pixels which changed, default true
+	bool use_local_palettes; // default false
+	float local_palette_error; // mean squared color distance above which a frame gets its own palette
+
 	std::vector<MCPoint> palette;
-	
+
 private:
+	GifFrame* createFrame();
+	void deleteFrame(GifFrame* frame);
+	void writeHeader(FILE* fp);
+	void writeFrame(FILE* fp, GifFrame& frame);
+	void computeDelta(GifFrame& frame, const unsigned char* prevPixels);
+	void quantizeFrame(GifFrame& frame);
+	float getPaletteError(GifFrame& frame, const PaletteLookup& lookup);
+	void frameDone(GifFrame* frame); // called by the thread pool when streaming
+
 	bool is_setup;
 	vector<GifFrame*> frames;
 	bool palette_created;
+	int bits_per_pixel;
+	PaletteLookup lookup;
+	vector<unsigned char> samples;
+	vector<unsigned char> prev_pixels; // last frame added while streaming
+
+	// streaming
+	FILE* fp;
+	bool header_written;
+	bool is_writing;
+	size_t num_added;
+	size_t num_written;
+	vector<GifFrame*> free_frames;
+	vector<GifFrame*> done_frames; // by index % size
+	ThreadPool pool;
+	pthread_mutex_t mutex;
+	pthread_cond_t free_cond;
+
+	friend struct GifFrameTask;
 };
 
 } // roxlu
 
-#endif
\ No newline at end of file
+#endif
@@ -163,6 +163,11 @@ void GIFEncodeGraphicControlExt (FILE *fp, GIFDisposeType  Disposal, int Delay,
 }
 
 void GIFEncodeImageData (FILE *fp, int Width, int Height, int BitsPerPixel, int offset_x, int offset_y, unsigned char *data) {
+	GIFEncodeImageDataCmap (fp, Width, Height, BitsPerPixel, offset_x, offset_y, data, NULL);
+}
+
+/* Same as GIFEncodeImageData, but with a local colour map (when cmap != NULL) */
+void GIFEncodeImageDataCmap (FILE *fp, int Width, int Height, int BitsPerPixel, int offset_x, int offset_y, unsigned char *data, unsigned char *cmap) {
 	int Resolution;
 	int ColorMapSize;
 	int InitCodeSize;
@@ -189,8 +194,15 @@ void GIFEncodeImageData (FILE *fp, int Width, int Height, int BitsPerPixel, int
 	Putword (Width, fp);
 	Putword (Height, fp);
 
-	/* no interlacing */
-	fputc (0x0, fp);
+	/* no interlacing, local colour map when given */
+	if (cmap) {
+		int i;
+		fputc (0x80 | (BitsPerPixel - 1), fp);
+		for (i = 0; i < 3 * ColorMapSize; i++)	fputc (cmap[i], fp);
+	}
+	else {
+		fputc (0x0, fp);
+	}
 
 	/* Write out the initial code size */
 	fputc (InitCodeSize, fp);
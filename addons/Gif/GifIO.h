@@ -72,6 +72,7 @@ typedef enum GIFRecordType {IMAGE, GRAPHIC_CONTROL_EXTENSION, COMMENT_EXTENSION,
 void GIFEncodeHeader            (FILE *fp, int gif89, int Width, int Height, int Background, int BitsPerPixel, unsigned char *cmap);
 void GIFEncodeGraphicControlExt (FILE *fp, GIFDisposeType Disposal, int Delay, int Animation, int Transparent);
 void GIFEncodeImageData         (FILE *fp, int Width, int Height, int BitsPerPixel, int offset_x, int offset_y, unsigned char *data);
+void GIFEncodeImageDataCmap     (FILE *fp, int Width, int Height, int BitsPerPixel, int offset_x, int offset_y, unsigned char *data, unsigned char *cmap);
 void GIFEncodeClose             (FILE *fp);
 void GIFEncodeCommentExt        (FILE *fp, char *comment);
 void GIFEncodeLoopExt           (FILE *fp, int num_loops);
@@ -92,10 +92,8 @@ bool HEC_FromFaceList::create(HE_Mesh& mesh)  {
 		int i = 0; 
 		while(vec_it != vertices.end()) {	
 			printf("create he_vertice: %d\n", i);
-			HE_Vertex* vert = new HE_Vertex(*vec_it);
+			HE_Vertex* vert = mesh.createVertex(*vec_it);
 			vert->setLabel(i);
-
-			mesh.addVertex(vert);
 			created_vertices.push_back(vert);
 			++vec_it;
 			++i;
@@ -117,10 +115,10 @@ bool HEC_FromFaceList::create(HE_Mesh& mesh)  {
 		}
 		
 		// create a new face and it's edges.
-		HE_Face* f = new HE_Face();
+		HE_Face* f = mesh.createFace();
 		vector<HE_HalfEdge*> face_half_edges;
 		for(int i = 0; i < num_indices; ++i) {
-			HE_HalfEdge* he = new HE_HalfEdge();
+			HE_HalfEdge* he = mesh.createHalfEdge();
 			he->setVertex(created_vertices.at(indices.at(i)));
 			he->getVertex()->setHalfEdge(he);
 			
@@ -133,8 +131,6 @@ bool HEC_FromFaceList::create(HE_Mesh& mesh)  {
 		}
 		
 		// set next/prev on created half edges.
-		mesh.addFace(f);
-		mesh.addHalfEdges(face_half_edges);
 		HE_Mesh::cycleHalfEdges(face_half_edges); // link half edges
 		++face_it;
 	}
@@ -1,7 +1,7 @@
 #include "HEM_Noise.h"
 #include "HE_Mesh.h"
 #include "HE_Headers.h"
-//#include "simplexnoise1234.h"
+#include "Noise.h"
 
 namespace roxlu {
 
@@ -15,18 +15,36 @@ HEM_Noise::HEM_Noise()
 
 bool HEM_Noise::modify(HE_Mesh& m) {
 	const vector<HE_Vertex*>& verts = m.getVerticesRef();
-	vector<HE_Vertex*>::const_iterator it = verts.begin();
-	float c = 0;
-	while(it != verts.end()) {
-		HE_Vertex& v = *(*it);
-		Vec3& pos = v.getPositionRef();
-		
-		printf("@todo not yet included simplexnoise in roxlu lib\n");
-//		pos.x += (snoise3(pos.x * x_scale, pos.y * x_scale, pos.z * x_scale)) * displacement;
-//		pos.y += (snoise3(pos.x * y_scale, pos.y * y_scale, pos.z * y_scale)) * displacement;
-//		pos.z += (snoise3(pos.x * z_scale, pos.y * z_scale, pos.z * z_scale)) * displacement;
-		++it;
+	size_t num = verts.size();
+	if(num == 0) {
+		return true;
 	}
+	
+	// evaluate the noise for all vertices at once.
+	vector<float> px(num), py(num), pz(num), dx(num), dy(num), dz(num);
+	for(size_t i = 0; i < num; ++i) {
+		Vec3& pos = verts[i]->getPositionRef();
+		px[i] = pos.x;
+		py[i] = pos.y;
+		pz[i] = pos.z;
+	}
+	
+	NoiseSettings settings;
+	settings.amplitude = displacement;
+	settings.frequency = x_scale;
+	noiseArray3(&px[0], &py[0], &pz[0], &dx[0], num, settings);
+	settings.frequency = y_scale;
+	noiseArray3(&px[0], &py[0], &pz[0], &dy[0], num, settings);
+	settings.frequency = z_scale;
+	noiseArray3(&px[0], &py[0], &pz[0], &dz[0], num, settings);
+	
+	for(size_t i = 0; i < num; ++i) {
+		Vec3& pos = verts[i]->getPositionRef();
+		pos.x += dx[i];
+		pos.y += dy[i];
+		pos.z += dz[i];
+	}
+	return true;
 }
 
-}; // roxlu
\ No newline at end of file
+}; // roxlu
@@ -40,6 +40,7 @@ inline HEM_Noise& HEM_Noise::setScaleZ(float zs) {
 
 inline HEM_Noise& HEM_Noise::setDisplacement(float disp) {
 	displacement = disp;
+	return *this;
 }
 
 }; // roxlu
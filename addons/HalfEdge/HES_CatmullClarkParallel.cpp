@@ -0,0 +1,429 @@
+#include "HES_CatmullClarkParallel.h"
+#include "HE_Mesh.h"
+#include "Parallel.h"
+#include "Constants.h"
+#include <math.h>
+#include <algorithm>
+#include <map>
+
+namespace roxlu {
+
+#define CC_NONE 0xFFFFFFFF
+
+static inline uint64_t cc_edge_key(uint32_t a, uint32_t b) {
+	return (a < b) ? (((uint64_t)a << 32) | b) : (((uint64_t)b << 32) | a);
+}
+
+struct CC_EdgeKey {
+	uint64_t key;
+	uint32_t corner;
+	bool operator<(const CC_EdgeKey& other) const {
+		return key < other.key;
+	}
+};
+
+// Face points (and normals when we detect creases)
+// -----------------------------------------------------------------------------
+struct CC_FacePointTask {
+	const Vec3* positions;
+	const uint32_t* face_offsets;
+	const uint32_t* face_indices;
+	uint32_t* corner_face;
+	Vec3* face_points;
+	Vec3* face_normals; // can be NULL
+
+	void operator()(size_t begin, size_t end) {
+		for(size_t f = begin; f < end; ++f) {
+			uint32_t start = face_offsets[f];
+			uint32_t stop = face_offsets[f+1];
+			Vec3 center;
+			Vec3 normal;
+			for(uint32_t c = start; c < stop; ++c) {
+				const Vec3& p0 = positions[face_indices[c]];
+				center += p0;
+				corner_face[c] = f;
+				if(face_normals != NULL) {
+					const Vec3& p1 = positions[face_indices[(c + 1 < stop) ? c + 1 : start]];
+					normal.x += (p0.y - p1.y) * (p0.z + p1.z);
+					normal.y += (p0.z - p1.z) * (p0.x + p1.x);
+					normal.z += (p0.x - p1.x) * (p0.y + p1.y);
+				}
+			}
+			face_points[f] = center / float(stop - start);
+			if(face_normals != NULL) {
+				float len = normal.length();
+				face_normals[f] = (len > 0.0f) ? normal / len : normal;
+			}
+		}
+	}
+};
+
+// Edge points
+// -----------------------------------------------------------------------------
+struct CC_EdgePointTask {
+	const Vec3* positions;
+	const Vec3* face_points;
+	const uint32_t* edge_vertices;
+	const uint32_t* edge_faces;
+	const uint8_t* edge_sharp;
+	Vec3* edge_points;
+
+	void operator()(size_t begin, size_t end) {
+		for(size_t e = begin; e < end; ++e) {
+			const Vec3& a = positions[edge_vertices[2*e]];
+			const Vec3& b = positions[edge_vertices[2*e+1]];
+			if(edge_sharp[e]) {
+				edge_points[e] = (a + b) * 0.5f;
+			}
+			else {
+				edge_points[e] = (a + b + face_points[edge_faces[2*e]] + face_points[edge_faces[2*e+1]]) * 0.25f;
+			}
+		}
+	}
+};
+
+// Vertex points
+// -----------------------------------------------------------------------------
+struct CC_VertexPointTask {
+	const Vec3* positions;
+	const Vec3* face_points;
+	const uint32_t* edge_vertices;
+	const uint32_t* edge_num_faces;
+	const uint8_t* edge_sharp;
+	const uint32_t* corner_face;
+	const uint32_t* vertex_edge_offsets;
+	const uint32_t* vertex_edges;
+	const uint32_t* vertex_corner_offsets;
+	const uint32_t* vertex_corners;
+	bool keep_boundary;
+	Vec3* vertex_points;
+
+	void operator()(size_t begin, size_t end) {
+		for(size_t v = begin; v < end; ++v) {
+			const Vec3& p = positions[v];
+			uint32_t e_start = vertex_edge_offsets[v];
+			uint32_t e_end = vertex_edge_offsets[v+1];
+			int n = e_end - e_start;
+			if(n == 0) {
+				vertex_points[v] = p;
+				continue;
+			}
+
+			int num_sharp = 0;
+			bool boundary = false;
+			Vec3 sharp_sum;
+			Vec3 mid_sum;
+			for(uint32_t i = e_start; i < e_end; ++i) {
+				uint32_t e = vertex_edges[i];
+				uint32_t other = (edge_vertices[2*e] == v) ? edge_vertices[2*e+1] : edge_vertices[2*e];
+				const Vec3& op = positions[other];
+				mid_sum += (p + op) * 0.5f;
+				if(edge_sharp[e]) {
+					++num_sharp;
+					sharp_sum += op;
+				}
+				if(edge_num_faces[e] == 1) {
+					boundary = true;
+				}
+			}
+
+			if((boundary && keep_boundary) || num_sharp > 2) {
+				vertex_points[v] = p; // corner
+			}
+			else if(num_sharp == 2) {
+				vertex_points[v] = (sharp_sum + p * 6.0f) * 0.125f; // crease
+			}
+			else {
+				uint32_t c_start = vertex_corner_offsets[v];
+				uint32_t c_end = vertex_corner_offsets[v+1];
+				Vec3 q;
+				for(uint32_t i = c_start; i < c_end; ++i) {
+					q += face_points[corner_face[vertex_corners[i]]];
+				}
+				if(c_end > c_start) {
+					q /= float(c_end - c_start);
+				}
+				Vec3 r = mid_sum / float(n);
+				vertex_points[v] = (q + r * 2.0f + p * float(n - 3)) / float(n);
+			}
+		}
+	}
+};
+
+// New topology: every corner of a face becomes a quad.
+// -----------------------------------------------------------------------------
+struct CC_TopologyTask {
+	const uint32_t* face_offsets;
+	const uint32_t* face_indices;
+	const uint32_t* corner_edge;
+	uint32_t num_vertices;
+	uint32_t num_edges;
+	uint32_t* out_indices;
+
+	void operator()(size_t begin, size_t end) {
+		for(size_t f = begin; f < end; ++f) {
+			uint32_t start = face_offsets[f];
+			uint32_t stop = face_offsets[f+1];
+			uint32_t face_point = num_vertices + num_edges + f;
+			for(uint32_t c = start; c < stop; ++c) {
+				uint32_t prev = (c == start) ? stop - 1 : c - 1;
+				uint32_t* quad = out_indices + (c * 4);
+				quad[0] = face_indices[c];
+				quad[1] = num_vertices + corner_edge[c];
+				quad[2] = face_point;
+				quad[3] = num_vertices + corner_edge[prev];
+			}
+		}
+	}
+};
+
+// HES_CatmullClarkParallel
+// -----------------------------------------------------------------------------
+HES_CatmullClarkParallel::HES_CatmullClarkParallel()
+	:HES_Subdividor()
+	,levels(1)
+	,num_threads(0)
+	,keep_boundary(true)
+	,crease_angle(-1.0f)
+	,min_edge_length(0.0f)
+{
+}
+
+bool HES_CatmullClarkParallel::apply(HE_Mesh& mesh) {
+	FlatMesh meshes[2];
+	copyFromMesh(mesh, meshes[0]);
+	if(meshes[0].face_indices.empty()) {
+		return false;
+	}
+
+	int current = 0;
+	for(int i = 0; i < levels; ++i) {
+		if(!subdivide(meshes[current], meshes[1 - current])) {
+			break;
+		}
+		current = 1 - current;
+	}
+
+	mesh.reset();
+	mesh.createFromFaces(meshes[current].positions, meshes[current].face_offsets, meshes[current].face_indices);
+	return true;
+}
+
+void HES_CatmullClarkParallel::copyFromMesh(HE_Mesh& mesh, FlatMesh& result) {
+	const vector<HE_Vertex*>& verts = mesh.getVerticesRef();
+	const vector<HE_Face*>& faces = mesh.getFacesRef();
+
+	// vertex -> index in result.positions; on id, or on address for the
+	// vertices which were added by hand. The labels of the mesh are left alone.
+	uint32_t max_id = 0;
+	for(size_t i = 0; i < verts.size(); ++i) {
+		if(verts[i]->id != HE_INVALID_ID) {
+			max_id = std::max<uint32_t>(max_id, verts[i]->id + 1);
+		}
+	}
+	vector<uint32_t> index_by_id(max_id, CC_NONE);
+	std::map<HE_Vertex*, uint32_t> index_by_vertex;
+	result.positions.resize(verts.size());
+	for(size_t i = 0; i < verts.size(); ++i) {
+		if(verts[i]->id != HE_INVALID_ID) {
+			index_by_id[verts[i]->id] = i;
+		}
+		else {
+			index_by_vertex[verts[i]] = i;
+		}
+		result.positions[i] = verts[i]->getPositionRef();
+	}
+
+	result.face_offsets.clear();
+	result.face_indices.clear();
+	result.sharp_edges.clear();
+	result.face_offsets.reserve(faces.size() + 1);
+	result.face_indices.reserve(faces.size() * 4);
+	result.face_offsets.push_back(0);
+	for(size_t i = 0; i < faces.size(); ++i) {
+		HE_HalfEdge* start = faces[i]->getHalfEdge();
+		if(start == NULL) {
+			continue;
+		}
+		HE_HalfEdge* he = start;
+		do {
+			HE_Vertex* v = he->getVertex();
+			if(v->id != HE_INVALID_ID) {
+				result.face_indices.push_back(index_by_id[v->id]);
+			}
+			else {
+				result.face_indices.push_back(index_by_vertex[v]);
+			}
+			he = he->getNext();
+		} while(he != start);
+		result.face_offsets.push_back(result.face_indices.size());
+	}
+}
+
+bool HES_CatmullClarkParallel::subdivide(FlatMesh& in, FlatMesh& out) {
+	if(in.face_offsets.size() < 2) {
+		return false;
+	}
+	uint32_t nv = in.positions.size();
+	uint32_t nf = in.face_offsets.size() - 1;
+	uint32_t nc = in.face_indices.size();
+	const uint32_t* offsets = &in.face_offsets[0];
+	const uint32_t* indices = &in.face_indices[0];
+
+	// face points
+	vector<uint32_t> corner_face(nc);
+	vector<Vec3> face_points(nf);
+	vector<Vec3> face_normals((crease_angle >= 0.0f) ? nf : 0);
+	CC_FacePointTask face_task;
+	face_task.positions = &in.positions[0];
+	face_task.face_offsets = offsets;
+	face_task.face_indices = indices;
+	face_task.corner_face = &corner_face[0];
+	face_task.face_points = &face_points[0];
+	face_task.face_normals = face_normals.empty() ? NULL : &face_normals[0];
+	parallelFor(nf, face_task, num_threads);
+
+	// find unique edges; sorting the corners on their vertex pair
+	vector<CC_EdgeKey> keys(nc);
+	for(uint32_t f = 0; f < nf; ++f) {
+		for(uint32_t c = offsets[f]; c < offsets[f+1]; ++c) {
+			uint32_t next = (c + 1 < offsets[f+1]) ? c + 1 : offsets[f];
+			keys[c].key = cc_edge_key(indices[c], indices[next]);
+			keys[c].corner = c;
+		}
+	}
+	std::sort(keys.begin(), keys.end());
+
+	vector<uint32_t> corner_edge(nc);
+	vector<uint32_t> edge_vertices;
+	vector<uint32_t> edge_faces;
+	vector<uint32_t> edge_num_faces;
+	edge_vertices.reserve(nc);
+	edge_faces.reserve(nc);
+	edge_num_faces.reserve(nc / 2 + 1);
+	for(uint32_t i = 0; i < nc; ) {
+		uint32_t j = i + 1;
+		while(j < nc && keys[j].key == keys[i].key) {
+			++j;
+		}
+		uint32_t e = edge_num_faces.size();
+		edge_vertices.push_back(keys[i].key >> 32);
+		edge_vertices.push_back(keys[i].key & 0xFFFFFFFF);
+		edge_faces.push_back(corner_face[keys[i].corner]);
+		edge_faces.push_back((j - i > 1) ? corner_face[keys[i+1].corner] : CC_NONE);
+		edge_num_faces.push_back(j - i);
+		for(uint32_t k = i; k < j; ++k) {
+			corner_edge[keys[k].corner] = e;
+		}
+		i = j;
+	}
+	uint32_t ne = edge_num_faces.size();
+
+	// adaptive: stop when all edges are small enough
+	if(min_edge_length > 0.0f) {
+		float max_len_sq = 0.0f;
+		for(uint32_t e = 0; e < ne; ++e) {
+			float len_sq = in.positions[edge_vertices[2*e]].lengthSquared(in.positions[edge_vertices[2*e+1]]);
+			max_len_sq = std::max<float>(max_len_sq, len_sq);
+		}
+		if(max_len_sq < (min_edge_length * min_edge_length)) {
+			return false;
+		}
+	}
+
+	// sharp edges: boundary, non-manifold, creases and children of sharp edges.
+	float crease_cos = cos(crease_angle * DEG_TO_RAD);
+	vector<uint8_t> edge_sharp(ne, 0);
+	for(uint32_t e = 0; e < ne; ++e) {
+		if(edge_num_faces[e] != 2) {
+			edge_sharp[e] = 1;
+		}
+		else if(!face_normals.empty() && dot(face_normals[edge_faces[2*e]], face_normals[edge_faces[2*e+1]]) < crease_cos) {
+			edge_sharp[e] = 1;
+		}
+		else if(!in.sharp_edges.empty()) {
+			uint64_t key = ((uint64_t)edge_vertices[2*e] << 32) | edge_vertices[2*e+1];
+			edge_sharp[e] = std::binary_search(in.sharp_edges.begin(), in.sharp_edges.end(), key) ? 1 : 0;
+		}
+	}
+
+	// vertex -> edges and vertex -> corners (counting sort)
+	vector<uint32_t> vertex_edge_offsets(nv + 1, 0);
+	vector<uint32_t> vertex_corner_offsets(nv + 1, 0);
+	for(uint32_t i = 0; i < ne * 2; ++i) {
+		vertex_edge_offsets[edge_vertices[i] + 1]++;
+	}
+	for(uint32_t c = 0; c < nc; ++c) {
+		vertex_corner_offsets[indices[c] + 1]++;
+	}
+	for(uint32_t v = 0; v < nv; ++v) {
+		vertex_edge_offsets[v + 1] += vertex_edge_offsets[v];
+		vertex_corner_offsets[v + 1] += vertex_corner_offsets[v];
+	}
+	vector<uint32_t> vertex_edges(ne * 2);
+	vector<uint32_t> vertex_corners(nc);
+	vector<uint32_t> fill(vertex_edge_offsets.begin(), vertex_edge_offsets.end() - 1);
+	for(uint32_t i = 0; i < ne * 2; ++i) {
+		vertex_edges[fill[edge_vertices[i]]++] = i / 2;
+	}
+	fill.assign(vertex_corner_offsets.begin(), vertex_corner_offsets.end() - 1);
+	for(uint32_t c = 0; c < nc; ++c) {
+		vertex_corners[fill[indices[c]]++] = c;
+	}
+
+	// new positions: [vertex points, edge points, face points]
+	out.positions.resize(nv + ne + nf);
+	std::copy(face_points.begin(), face_points.end(), out.positions.begin() + nv + ne);
+
+	CC_EdgePointTask edge_task;
+	edge_task.positions = &in.positions[0];
+	edge_task.face_points = &face_points[0];
+	edge_task.edge_vertices = &edge_vertices[0];
+	edge_task.edge_faces = &edge_faces[0];
+	edge_task.edge_sharp = &edge_sharp[0];
+	edge_task.edge_points = &out.positions[nv];
+	parallelFor(ne, edge_task, num_threads);
+
+	CC_VertexPointTask vertex_task;
+	vertex_task.positions = &in.positions[0];
+	vertex_task.face_points = &face_points[0];
+	vertex_task.edge_vertices = &edge_vertices[0];
+	vertex_task.edge_num_faces = &edge_num_faces[0];
+	vertex_task.edge_sharp = &edge_sharp[0];
+	vertex_task.corner_face = &corner_face[0];
+	vertex_task.vertex_edge_offsets = &vertex_edge_offsets[0];
+	vertex_task.vertex_edges = &vertex_edges[0];
+	vertex_task.vertex_corner_offsets = &vertex_corner_offsets[0];
+	vertex_task.vertex_corners = &vertex_corners[0];
+	vertex_task.keep_boundary = keep_boundary;
+	vertex_task.vertex_points = &out.positions[0];
+	parallelFor(nv, vertex_task, num_threads);
+
+	// new topology; all quads.
+	out.face_offsets.resize(nc + 1);
+	for(uint32_t c = 0; c <= nc; ++c) {
+		out.face_offsets[c] = c * 4;
+	}
+	out.face_indices.resize(nc * 4);
+	CC_TopologyTask topo_task;
+	topo_task.face_offsets = offsets;
+	topo_task.face_indices = indices;
+	topo_task.corner_edge = &corner_edge[0];
+	topo_task.num_vertices = nv;
+	topo_task.num_edges = ne;
+	topo_task.out_indices = &out.face_indices[0];
+	parallelFor(nf, topo_task, num_threads);
+
+	// sharp edges are split in two sharp edges.
+	out.sharp_edges.clear();
+	for(uint32_t e = 0; e < ne; ++e) {
+		if(edge_sharp[e] && edge_num_faces[e] == 2) {
+			out.sharp_edges.push_back(cc_edge_key(edge_vertices[2*e], nv + e));
+			out.sharp_edges.push_back(cc_edge_key(edge_vertices[2*e+1], nv + e));
+		}
+	}
+	std::sort(out.sharp_edges.begin(), out.sharp_edges.end());
+	return true;
+}
+
+}; // roxlu
@@ -0,0 +1,86 @@
+#ifndef HES_CATMULLCLARKPARALLELH
+#define HES_CATMULLCLARKPARALLELH
+
+#include "HES_Subdividor.h"
+#include "HE_Headers.h"
+#include "Vec3.h"
+
+/**
+ * Catmull-Clark subdivision on flat arrays.
+ *
+ * Instead of splitting the half edge structure in place (like
+ * HES_CatmullClark) we copy the mesh into flat position / face index
+ * arrays, compute the face, edge and vertex points for each level in
+ * parallel (see parallelFor) and rebuild the half edge mesh once at
+ * the end. Set the number of levels with setLevels(); HE_Mesh::subdivide()
+ * with num > 1 will apply all levels num times.
+ *
+ * Feature edges: boundary edges, non-manifold edges and edges where
+ * the angle between the face normals is bigger than the crease angle
+ * are kept sharp (crease rules); their children stay sharp on the next
+ * levels.
+ *
+ * Adaptive: when a minimum edge length is set we stop refining as soon
+ * as the longest edge of the mesh is shorter than this length.
+ *
+ */
+namespace roxlu {
+
+class HE_Mesh;
+
+class HES_CatmullClarkParallel : public HES_Subdividor {
+public:
+	HES_CatmullClarkParallel();
+	bool apply(HE_Mesh& m);
+	inline HES_CatmullClarkParallel& setLevels(int num);
+	inline HES_CatmullClarkParallel& setKeepBoundary(bool keep);
+	inline HES_CatmullClarkParallel& setCreaseAngle(float degrees); // < 0 disables crease detection
+	inline HES_CatmullClarkParallel& setMinEdgeLength(float len); // <= 0 disables
+	inline HES_CatmullClarkParallel& setNumThreads(int num); // 0 = number of cores
+
+	// the flat representation, public so it can be used directly.
+	struct FlatMesh {
+		vector<Vec3> positions;
+		vector<uint32_t> face_offsets; // num faces + 1
+		vector<uint32_t> face_indices;
+		vector<uint64_t> sharp_edges; // sorted (min << 32 | max) vertex pairs
+	};
+
+	void copyFromMesh(HE_Mesh& m, FlatMesh& result);
+	bool subdivide(FlatMesh& in, FlatMesh& out); // returns false when refinement stopped (min edge length)
+
+private:
+	int levels;
+	int num_threads;
+	bool keep_boundary;
+	float crease_angle;
+	float min_edge_length;
+};
+
+inline HES_CatmullClarkParallel& HES_CatmullClarkParallel::setLevels(int num) {
+	levels = num;
+	return *this;
+}
+
+inline HES_CatmullClarkParallel& HES_CatmullClarkParallel::setKeepBoundary(bool keep) {
+	keep_boundary = keep;
+	return *this;
+}
+
+inline HES_CatmullClarkParallel& HES_CatmullClarkParallel::setCreaseAngle(float degrees) {
+	crease_angle = degrees;
+	return *this;
+}
+
+inline HES_CatmullClarkParallel& HES_CatmullClarkParallel::setMinEdgeLength(float len) {
+	min_edge_length = len;
+	return *this;
+}
+
+inline HES_CatmullClarkParallel& HES_CatmullClarkParallel::setNumThreads(int num) {
+	num_threads = num;
+	return *this;
+}
+
+}; // roxlu
+#endif
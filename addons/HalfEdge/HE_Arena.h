@@ -0,0 +1,84 @@
+#ifndef HE_ARENAH
+#define HE_ARENAH
+
+#include <stdlib.h>
+#include <new>
+#include "HE_Headers.h"
+
+namespace roxlu {
+
+/**
+ * Chunked storage for half edge elements. Elements are constructed
+ * in place in chunks of HE_ARENA_CHUNK_SIZE elements, so pointers stay
+ * valid while the arena grows and neighbouring elements share cache
+ * lines. Every element gets a 32 bit "id" which is its index in the
+ * arena; use operator[] to get an element back by id.
+ *
+ * T must have a public "uint32_t id" member.
+ *
+ */
+template<class T>
+class HE_Arena {
+public:
+	HE_Arena();
+	~HE_Arena();
+	inline T* allocate();
+	inline T* operator[](uint32_t id);
+	inline uint32_t size();
+	void clear();
+
+private:
+	HE_Arena(const HE_Arena& other); // no copies
+	HE_Arena& operator=(const HE_Arena& other);
+
+	vector<T*> chunks;
+	uint32_t count;
+};
+
+template<class T>
+HE_Arena<T>::HE_Arena()
+	:count(0)
+{
+}
+
+template<class T>
+HE_Arena<T>::~HE_Arena() {
+	clear();
+}
+
+template<class T>
+inline T* HE_Arena<T>::allocate() {
+	uint32_t chunk_dx = count >> HE_ARENA_CHUNK_BITS;
+	if(chunk_dx == chunks.size()) {
+		chunks.push_back((T*)malloc(sizeof(T) * HE_ARENA_CHUNK_SIZE));
+	}
+	T* el = new (chunks[chunk_dx] + (count & HE_ARENA_CHUNK_MASK)) T();
+	el->id = count++;
+	return el;
+}
+
+template<class T>
+inline T* HE_Arena<T>::operator[](uint32_t id) {
+	return chunks[id >> HE_ARENA_CHUNK_BITS] + (id & HE_ARENA_CHUNK_MASK);
+}
+
+template<class T>
+inline uint32_t HE_Arena<T>::size() {
+	return count;
+}
+
+template<class T>
+void HE_Arena<T>::clear() {
+	for(uint32_t i = 0; i < count; ++i) {
+		(*this)[i]->~T();
+	}
+	for(size_t i = 0; i < chunks.size(); ++i) {
+		free(chunks[i]);
+	}
+	chunks.clear();
+	count = 0;
+}
+
+}; // roxlu
+
+#endif
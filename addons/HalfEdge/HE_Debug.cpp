@@ -48,8 +48,8 @@ HE_Debug::HE_Debug() {
 void HE_Debug::drawPaired(HE_Mesh& m) {
 	glColor3f(0.255,0.803,0.27);
 	glBegin(GL_LINES);
-		vector<HE_HalfEdge*> edges = m.getHalfEdges();
-		vector<HE_HalfEdge*>::iterator it = edges.begin();
+		const vector<HE_HalfEdge*>& edges = m.getHalfEdges();
+		vector<HE_HalfEdge*>::const_iterator it = edges.begin();
 		while(it != edges.end()) {
 			HE_HalfEdge& he = *(*it);
 			if(he.getPair() != NULL) {
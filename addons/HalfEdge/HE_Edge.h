@@ -10,8 +10,8 @@ class HE_Face;
 
 class HE_Edge {
 public:
-	inline HE_Edge(HE_HalfEdge* he):half_edge(he) { }
-	inline HE_Edge():half_edge(NULL){}
+	inline HE_Edge(HE_HalfEdge* he):id(HE_INVALID_ID),half_edge(he) { }
+	inline HE_Edge():id(HE_INVALID_ID),half_edge(NULL){}
 	
 	inline HE_HalfEdge* getHalfEdge();
 	inline void 		setHalfEdge(HE_HalfEdge*);
@@ -21,6 +21,8 @@ public:
 	inline HE_Face* 	getFirstFace();
 	inline HE_Face* 	getSecondFace();
 	
+	uint32_t id; // index in the HE_Mesh arena
+	
 private:
 	HE_HalfEdge* half_edge;
 };
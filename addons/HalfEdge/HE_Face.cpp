@@ -9,13 +9,15 @@
 namespace roxlu {
 
 HE_Face::HE_Face()
-	:half_edge(NULL)
+	:id(HE_INVALID_ID)
+	,half_edge(NULL)
 	,is_sorted(false)
 {
 }
 
 HE_Face::HE_Face(HE_HalfEdge* he)
-	:half_edge(he)
+	:id(HE_INVALID_ID)
+	,half_edge(he)
 	,is_sorted(false)
 {
 }
@@ -31,6 +31,8 @@ public:
 	const set<HE_HalfEdge*> getHalfEdges();
 	void sort();
 	
+	uint32_t id; // index in the HE_Mesh arena
+	
 private:
 	HE_HalfEdge* half_edge;
 	bool is_sorted;
@@ -8,9 +8,9 @@ HE_HalfEdge::HE_HalfEdge()
 	,next(NULL)
 	,prev(NULL)
 	,pair(NULL)
-	,face(NULL)
 	,edge(NULL)
-	
+	,face(NULL)
+	,id(HE_INVALID_ID)
 {
 }
 
@@ -19,8 +19,9 @@ HE_HalfEdge::HE_HalfEdge(HE_Vertex* v)
 	,next(NULL)
 	,prev(NULL)
 	,pair(NULL)
-	,face(NULL)
 	,edge(NULL)
+	,face(NULL)
+	,id(HE_INVALID_ID)
 {
 }
 
@@ -1,6 +1,8 @@
 #ifndef HE_HALFEDGEH
 #define HE_HALFEDGEH
 
+#include "HE_Headers.h"
+
 namespace roxlu {
 
 class HE_Vertex;
@@ -33,6 +35,7 @@ public:
 	HE_HalfEdge* pair;
 	HE_Edge* edge;
 	HE_Face* face;
+	uint32_t id; // index in the HE_Mesh arena
 };
 
 
@@ -49,6 +52,7 @@ inline HE_HalfEdge& HE_HalfEdge::setPrev(HE_HalfEdge* e) {
 inline HE_HalfEdge& HE_HalfEdge::setPair(HE_HalfEdge* e) {
 	e->pair = this;
 	pair = e;
+	return *this;
 }
 
 inline HE_HalfEdge& HE_HalfEdge::setFace(HE_Face* f) {
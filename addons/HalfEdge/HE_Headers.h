@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <vector>
 #include <iomanip>
+#include <stdint.h>
 
 using std::vector;
 using std::cout;
@@ -15,6 +16,12 @@ using std::setw;
 
 #define HDX(i,j,w) ( ((j)*(w))+(i) )
 
+// Elements which are not allocated by a HE_Mesh arena have this id.
+#define HE_INVALID_ID 0xFFFFFFFF
+#define HE_ARENA_CHUNK_BITS 10
+#define HE_ARENA_CHUNK_SIZE (1 << HE_ARENA_CHUNK_BITS)
+#define HE_ARENA_CHUNK_MASK (HE_ARENA_CHUNK_SIZE - 1)
+
 #endif
 
 
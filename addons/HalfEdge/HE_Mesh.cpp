@@ -1,4 +1,6 @@
 #include "HE_Mesh.h"
+#include <algorithm>
+#include <functional>
 namespace roxlu {
 
 HE_Mesh::HE_Mesh() 	
@@ -7,35 +9,133 @@ HE_Mesh::HE_Mesh()
 }
 
 
-// @todo: test if we cleanup memory correctly!!
 HE_Mesh::~HE_Mesh() {
+	reset();
+}
+
+// Elements created with createVertex() etc. are freed by the arenas, 
+// we only delete the ones which were new'd and added by hand.
+void HE_Mesh::reset() {
 	// delete faces.
 	vector<HE_Face*>::iterator face_it = faces.begin();
 	while(face_it != faces.end()) {
-		delete *face_it;
+		if((*face_it)->id == HE_INVALID_ID) {
+			delete *face_it;
+		}
 		++face_it;
 	}
 	
 	// delete edges
 	vector<HE_Edge*>::iterator edge_it = edges.begin();
 	while(edge_it != edges.end()) {
-		delete *edge_it;
+		if((*edge_it)->id == HE_INVALID_ID) {
+			delete *edge_it;
+		}
 		++edge_it;
 	}
 	
 	// delete half edges
 	vector<HE_HalfEdge*>::iterator hedge_it = half_edges.begin();
 	while(hedge_it != half_edges.end()) {
-		delete *hedge_it;
+		if((*hedge_it)->id == HE_INVALID_ID) {
+			delete *hedge_it;
+		}
 		++hedge_it;
 	}
 	
 	// delete vertices
 	vector<HE_Vertex*>::iterator v_it = vertices.begin();
 	while(v_it != vertices.end()) {
-		delete *v_it;
+		if((*v_it)->id == HE_INVALID_ID) {
+			delete *v_it;
+		}
 		++v_it;
 	}
+	
+	clear();
+	face_arena.clear();
+	edge_arena.clear();
+	half_edge_arena.clear();
+	vertex_arena.clear();
+}
+
+void HE_Mesh::createFromFaces(
+	 const vector<Vec3>& positions
+	,const vector<uint32_t>& faceOffsets
+	,const vector<uint32_t>& faceIndices
+)
+{
+	if(faceOffsets.size() < 2) {
+		return;
+	}
+	size_t num_faces = faceOffsets.size() - 1;
+	vertices.reserve(vertices.size() + positions.size());
+	faces.reserve(faces.size() + num_faces);
+	half_edges.reserve(half_edges.size() + faceIndices.size() + (faceIndices.size() / 8));
+	edges.reserve(edges.size() + (faceIndices.size() / 2) + (faceIndices.size() / 8));
+	
+	vector<HE_Vertex*> created_vertices(positions.size());
+	for(size_t i = 0; i < positions.size(); ++i) {
+		created_vertices[i] = createVertex(positions[i]);
+	}
+	
+	for(size_t i = 0; i < num_faces; ++i) {
+		uint32_t start = faceOffsets[i];
+		uint32_t end = faceOffsets[i+1];
+		if(end - start < 3) {
+			continue;
+		}
+		
+		HE_Face* f = createFace();
+		HE_HalfEdge* first = NULL;
+		HE_HalfEdge* prev = NULL;
+		for(uint32_t j = start; j < end; ++j) {
+			HE_HalfEdge* he = createHalfEdge();
+			HE_Vertex* v = created_vertices[faceIndices[j]];
+			he->setVertex(v);
+			he->setFace(f);
+			v->setHalfEdge(he);
+			if(prev != NULL) {
+				prev->setNext(he);
+				he->setPrev(prev);
+			}
+			else {
+				first = he;
+			}
+			prev = he;
+		}
+		prev->setNext(first);
+		first->setPrev(prev);
+		f->setHalfEdge(first);
+	}
+	
+	pairHalfEdges();
+	capHalfEdges();
+}
+
+HE_Vertex* HE_Mesh::createVertex(const Vec3& position) {
+	HE_Vertex* v = vertex_arena.allocate();
+	v->getPositionRef() = position;
+	addVertex(v);
+	return v;
+}
+
+HE_HalfEdge* HE_Mesh::createHalfEdge() {
+	HE_HalfEdge* he = half_edge_arena.allocate();
+	addHalfEdge(he);
+	return he;
+}
+
+HE_Edge* HE_Mesh::createEdge() {
+	HE_Edge* e = edge_arena.allocate();
+	addEdge(e);
+	return e;
+}
+
+HE_Face* HE_Mesh::createFace() {
+	HE_Face* f = face_arena.allocate();
+	addFace(f);
+	return f;
 }
 
 void HE_Mesh::drawHalfEdges() {
@@ -61,44 +161,93 @@ vector<HE_HalfEdge*> HE_Mesh::getUnpairedHalfEdges() {
 	return result;
 }
 
-void HE_Mesh::pairHalfEdges() {
-	vector<HE_HalfEdge*> unpaired = getUnpairedHalfEdges();
-	vector<HE_HalfEdge*>::iterator it = unpaired.begin();
-	vector<HE_HalfEdge*>::iterator other_it;
-	
-	try {
-		while(it != unpaired.end()) {
-			HE_HalfEdge& he_a = *(*it);
-			if(he_a.getPair() == NULL) {
-				other_it =(it+1);
+// Unpaired half edge keyed on its (sorted) start and end vertex.
+// Orders vertices on their id, so the result doesn't depend on where
+// the allocator put them; vertices without an id go last, on address.
+static bool HE_VertexLess(HE_Vertex* a, HE_Vertex* b) {
+	if(a->id != HE_INVALID_ID && b->id != HE_INVALID_ID) {
+		return a->id < b->id;
+	}
+	if(a->id != b->id) {
+		return a->id != HE_INVALID_ID;
+	}
+	return std::less<HE_Vertex*>()(a, b);
+}
 
-				while(other_it != unpaired.end()) {
-					HE_HalfEdge& he_b = *(*other_it);
+struct HE_PairKey {
+	HE_Vertex* a;
+	HE_Vertex* b;
+	HE_HalfEdge* he;
+	bool operator<(const HE_PairKey& other) const {
+		if(a != other.a) {
+			return HE_VertexLess(a, other.a);
+		}
+		return HE_VertexLess(b, other.b);
+	}
+};
 
-					// some trickery to check if the other is a pair.
-					if(	(he_b.getPair() == NULL) 
-						&& (he_a.getVertex() == he_b.getNext()->getVertex()) 
-						&& (he_b.getVertex() == he_a.getNext()->getVertex()) 
-					)
-					{
-						he_a.setPair(&he_b);
+/**
+ * Pairs all unpaired half edges. Instead of testing every half edge
+ * against every other one we sort them on their (sorted) vertex pair,
+ * so two half edges which describe the same edge end up next to each 
+ * other. This makes pairing O(n log n) instead of O(n^2). 
+ *
+ */
+void HE_Mesh::pairHalfEdges() {
+	vector<HE_PairKey> keys;
+	keys.reserve(half_edges.size());
+	
+	vector<HE_HalfEdge*>::iterator it = half_edges.begin();
+	while(it != half_edges.end()) {
+		HE_HalfEdge* he = *it;
+		if(he->getPair() == NULL && he->getNext() != NULL) {
+			HE_PairKey k;
+			HE_Vertex* from = he->getVertex();
+			HE_Vertex* to = he->getNext()->getVertex();
+			bool from_first = HE_VertexLess(from, to);
+			k.a = from_first ? from : to;
+			k.b = from_first ? to : from;
+			k.he = he;
+			keys.push_back(k);
+		}
+		++it;
+	}
+	std::stable_sort(keys.begin(), keys.end()); // runs keep the order of half_edges
+	
+	size_t i = 0;
+	size_t n = keys.size();
+	while(i < n) {
+		// find the run of half edges which share the same vertices.
+		size_t j = i + 1;
+		while(j < n && keys[j].a == keys[i].a && keys[j].b == keys[i].b) {
+			++j;
+		}
+		
+		// a manifold mesh has only 2 half edges per run; pair opposite directions.
+		for(size_t k = i; k < j; ++k) {
+			HE_HalfEdge& he_a = *keys[k].he;
+			if(he_a.getPair() != NULL) {
+				continue;
+			}
+			for(size_t l = k + 1; l < j; ++l) {
+				HE_HalfEdge& he_b = *keys[l].he;
+				if(	(he_b.getPair() == NULL) 
+					&& (he_a.getVertex() == he_b.getNext()->getVertex()) 
+					&& (he_b.getVertex() == he_a.getNext()->getVertex()) 
+				)
+				{
+					he_a.setPair(&he_b);
 						
-						// create a new edge for both half edges
-						HE_Edge* e = new HE_Edge();
-						e->setHalfEdge(&he_a);
-						he_a.setEdge(e);
-						he_b.setEdge(e);
-						addEdge(e);
-					}
-					
-					++other_it;
+					// create a new edge for both half edges
+					HE_Edge* e = createEdge();
+					e->setHalfEdge(&he_a);
+					he_a.setEdge(e);
+					he_b.setEdge(e);
+					break;
 				}
 			}
-			++it;
 		}
-	}
-	catch(...) {
-		cout << "Oops something went wrong when pairing half edges." << endl;
+		i = j;
 	}
 }
 
@@ -110,16 +259,14 @@ void HE_Mesh::capHalfEdges() {
 	for(int i = 0; i < unpaired_half_edges.size(); ++i) {
 		// create a new half edge for the unpaired one.
 		HE_HalfEdge* he0 = unpaired_half_edges.at(i);
-		HE_HalfEdge* he1 = new HE_HalfEdge();
-		addHalfEdge(he1);
+		HE_HalfEdge* he1 = createHalfEdge();
 		
 		// set the vertex for the new half edge.
 		he1->setVertex(he0->getNext()->getVertex());
 		he0->setPair(he1);
 		
 		// create a new edge for both half edge
-		HE_Edge* e = new HE_Edge();
-		addEdge(e);
+		HE_Edge* e = createEdge();
 		e->setHalfEdge(he0);
 		he0->setEdge(e);
 		he1->setEdge(e);
@@ -176,9 +323,8 @@ HE_Selection HE_Mesh::quadSplitFaces() {
 	vector<HE_Face*> faces_copy = getFaces();
 	for(int i = 0; i < face_centers.size(); ++i) {
 		// create new vertex in the center of the faces.
-		HE_Vertex* vi = new HE_Vertex(face_centers[i]);
+		HE_Vertex* vi = createVertex(face_centers[i]);
 		vi->setLabel(2);
-		addVertex(vi);
 		sel_out.addVertex(vi);
 				
 		HE_Face* f = faces_copy[i];
@@ -205,8 +351,7 @@ HE_Selection HE_Mesh::quadSplitFaces() {
 				fc = f;
 			}
 			else {
-				fc = new HE_Face();
-				addFace(fc);
+				fc = createFace();
 			}
 			
 			he0[c] = he;
@@ -214,11 +359,8 @@ HE_Selection HE_Mesh::quadSplitFaces() {
 			fc->setHalfEdge(he);
 			
 			he1[c] = he->getNext();
-			he2[c] = new HE_HalfEdge();
-			he3[c] = new HE_HalfEdge();
-			
-			addHalfEdge(he2[c]);
-			addHalfEdge(he3[c]);
+			he2[c] = createHalfEdge();
+			he3[c] = createHalfEdge();
 			
 			he2[c]->setVertex(he->getNext()->getNext()->getVertex());
 			he3[c]->setVertex(vi);
@@ -273,9 +415,9 @@ HE_Selection HE_Mesh::splitEdge(HE_Edge* e, Vec3 p) {
 	HE_HalfEdge* he1 = he0->getPair();
 	
 	// create new vertex and half edge.
-	HE_Vertex* v = new HE_Vertex(p);
-	HE_HalfEdge* he0_new = new HE_HalfEdge();
-	HE_HalfEdge* he1_new = new HE_HalfEdge();
+	HE_Vertex* v = createVertex(p);
+	HE_HalfEdge* he0_new = createHalfEdge();
+	HE_HalfEdge* he1_new = createHalfEdge();
 	
 	// new half edges get same new vertex as start point.
 	he0_new->setVertex(v);
@@ -293,7 +435,7 @@ HE_Selection HE_Mesh::splitEdge(HE_Edge* e, Vec3 p) {
 	he0_new->setPair(he1);
 
 	// create new edge and reset old edge
-	HE_Edge* edge_new = new HE_Edge();
+	HE_Edge* edge_new = createEdge();
 	edge_new->setHalfEdge(he0_new);
 	he1_new->setEdge(e);
 	he1->setEdge(edge_new);
@@ -307,12 +449,7 @@ HE_Selection HE_Mesh::splitEdge(HE_Edge* e, Vec3 p) {
 		he1_new->setFace(he1->getFace());
 	}
 
-	// add newly created vertex, hafl edges and edge.	
 	v->setLabel(1);
-	addVertex(v);
-	addHalfEdge(he0_new);
-	addHalfEdge(he1_new);
-	addEdge(edge_new);
 	
 	// set new vertex and edge to selection.
 	sel_out.addVertex(v);
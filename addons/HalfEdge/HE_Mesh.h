@@ -8,6 +8,8 @@
 #include "HE_Face.h"
 #include "HE_Debug.h"
 #include "HE_Selection.h"
+#include "HE_Arena.h"
+#include "HE_ToVertexData.h"
 
 
 #include "HEC_Creator.h"
@@ -20,6 +22,7 @@
 
 #include "HES_Subdividor.h"
 #include "HES_CatmullClark.h"
+#include "HES_CatmullClarkParallel.h"
 
 #include "Vec3.h"
 #include "Ray.h"
@@ -30,6 +33,25 @@ class HE_Mesh : public HE_Structure {
 public:
 	HE_Mesh();
 	~HE_Mesh(); 
+	
+	// create elements in the mesh arenas; these are added to the mesh too.
+	HE_Vertex* createVertex(const Vec3& position);
+	HE_HalfEdge* createHalfEdge();
+	HE_Edge* createEdge();
+	HE_Face* createFace();
+	
+	// remove and free all elements
+	void reset();
+	
+	// build the mesh from a flat face list: face i uses faceIndices[faceOffsets[i]] .. faceIndices[faceOffsets[i+1]]
+	void createFromFaces(const vector<Vec3>& positions, const vector<uint32_t>& faceOffsets, const vector<uint32_t>& faceIndices);
+	
+	// get elements by id (see HE_Arena)
+	inline HE_Vertex* getVertexById(uint32_t id);
+	inline HE_HalfEdge* getHalfEdgeById(uint32_t id);
+	inline HE_Edge* getEdgeById(uint32_t id);
+	inline HE_Face* getFaceById(uint32_t id);
+	
 	void drawHalfEdges();
 	void drawFaces();
 	void drawVertices();
@@ -48,8 +70,33 @@ public:
 	
 	inline HE_Mesh& subdivide(HES_Subdividor& subdiv, int num = 1);
 	inline void resetVertexLabels();
+	
+private:
+	HE_Mesh(const HE_Mesh& other); // the arenas own the elements; no copies
+	HE_Mesh& operator=(const HE_Mesh& other);
+	
+	HE_Arena<HE_Vertex> vertex_arena;
+	HE_Arena<HE_HalfEdge> half_edge_arena;
+	HE_Arena<HE_Edge> edge_arena;
+	HE_Arena<HE_Face> face_arena;
 };
 
+inline HE_Vertex* HE_Mesh::getVertexById(uint32_t id) {
+	return vertex_arena[id];
+}
+
+inline HE_HalfEdge* HE_Mesh::getHalfEdgeById(uint32_t id) {
+	return half_edge_arena[id];
+}
+
+inline HE_Edge* HE_Mesh::getEdgeById(uint32_t id) {
+	return edge_arena[id];
+}
+
+inline HE_Face* HE_Mesh::getFaceById(uint32_t id) {
+	return face_arena[id];
+}
+
 /**
  * Use this method only to set the "next" half edges for the given 
  * vector. Note that this are just the half edges of a face. So the 
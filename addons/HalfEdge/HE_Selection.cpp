@@ -44,7 +44,11 @@ void HE_Selection::collectVertices() {
 	}
 	
 	// now copy all unique vertices
-	copy(unique_vertices.begin(), unique_vertices.end(), back_inserter(vertices));
+	set<HE_Vertex*>::iterator uit = unique_vertices.begin();
+	while(uit != unique_vertices.end()) {
+		addVertex(*uit);
+		++uit;
+	}
 	//cout << "Added vertices:" << vertices.size() << endl;
 			
 	/* validate 
@@ -95,7 +99,11 @@ void HE_Selection::collectEdges() {
 		copy(edges.begin(), edges.end(), inserter(unique_edges, unique_edges.begin()));
 		++face_it;
 	}
-	copy(unique_edges.begin(), unique_edges.end(), back_inserter(edges));
+	set<HE_Edge*>::iterator uit = unique_edges.begin();
+	while(uit != unique_edges.end()) {
+		addEdge(*uit);
+		++uit;
+	}
 }
 
 void HE_Selection::collectHalfEdges() {
@@ -2,14 +2,22 @@
 #define HE_STRUCTUREH
 
 #include "HE_Headers.h"
+#include "HE_Vertex.h"
+#include "HE_HalfEdge.h"
+#include "HE_Edge.h"
+#include "HE_Face.h"
 
 namespace roxlu {
 
-class HE_Vertex;
-class HE_HalfEdge;
-class HE_Edge;
-class HE_Face;
-
+/**
+ * A collection of vertices, half edges, edges and faces. Membership 
+ * of elements which are allocated by a HE_Mesh (i.e. have a valid id)
+ * is tracked with a bitset indexed by that id, so the contains*() 
+ * functions are O(1). Elements without an id fall back to a linear 
+ * search. The get*() functions return a const view on the containers;
+ * copy the result when you change the structure while iterating.
+ *
+ */
 class HE_Structure {
 public:
 	HE_Structure();
@@ -24,10 +32,10 @@ public:
 	inline void addFaces(const vector<HE_Face*>& fac);
 	inline void addEdges(const vector<HE_Edge*>& e);
 	
-	inline vector<HE_Vertex*> getVertices();
-	inline vector<HE_HalfEdge*> getHalfEdges();
-	inline vector<HE_Face*> getFaces();
-	inline vector<HE_Edge*> getEdges();
+	inline const vector<HE_Vertex*>& getVertices() const;
+	inline const vector<HE_HalfEdge*>& getHalfEdges() const;
+	inline const vector<HE_Face*>& getFaces() const;
+	inline const vector<HE_Edge*>& getEdges() const;
 	
 	inline const vector<HE_Face*>& getFacesRef() const;
 	inline const vector<HE_Vertex*>& getVerticesRef() const;
@@ -51,10 +59,19 @@ public:
 	
 	inline void clear();
 protected:
+	inline static void setFlag(vector<bool>& flags, uint32_t id);
+	inline static bool hasFlag(const vector<bool>& flags, uint32_t id);
+	
 	vector<HE_Vertex*> vertices;
 	vector<HE_HalfEdge*> half_edges;
 	vector<HE_Edge*> edges;
 	vector<HE_Face*> faces;
+	
+	// membership, indexed by element id
+	vector<bool> vertex_flags;
+	vector<bool> half_edge_flags;
+	vector<bool> edge_flags;
+	vector<bool> face_flags;
 };
 
 
@@ -62,53 +79,69 @@ protected:
 // -----------------------------------------------------------------------------
 inline void HE_Structure::addVertex(HE_Vertex* v) {
 	vertices.push_back(v);
+	setFlag(vertex_flags, v->id);
 }
 
 inline void HE_Structure::addFace(HE_Face* f) {
 	faces.push_back(f);
+	setFlag(face_flags, f->id);
 }
 
 inline void HE_Structure::addEdge(HE_Edge* e) {
 	edges.push_back(e);
+	setFlag(edge_flags, e->id);
 }
 
 inline void HE_Structure::addHalfEdge(HE_HalfEdge* he) {
 	half_edges.push_back(he);
+	setFlag(half_edge_flags, he->id);
 }
 
 // Add multiple elements at a time
 // -----------------------------------------------------------------------------
 inline void HE_Structure::addVertices(const vector<HE_Vertex*>& verts) {
-	copy(verts.begin(), verts.end(), back_inserter(vertices));
+	vertices.reserve(vertices.size() + verts.size());
+	for(vector<HE_Vertex*>::const_iterator it = verts.begin(); it != verts.end(); ++it) {
+		addVertex(*it);
+	}
 }
 
 inline void HE_Structure::addHalfEdges(const vector<HE_HalfEdge*>& edges) {
-	copy(edges.begin(), edges.end(), back_inserter(half_edges));
+	half_edges.reserve(half_edges.size() + edges.size());
+	for(vector<HE_HalfEdge*>::const_iterator it = edges.begin(); it != edges.end(); ++it) {
+		addHalfEdge(*it);
+	}
 }
 
 inline void HE_Structure::addEdges(const vector<HE_Edge*>& es) {
-	copy(es.begin(), es.end(), back_inserter(edges));
+	edges.reserve(edges.size() + es.size());
+	for(vector<HE_Edge*>::const_iterator it = es.begin(); it != es.end(); ++it) {
+		addEdge(*it);
+	}
 }
 
 inline void HE_Structure::addFaces(const vector<HE_Face*>& fac) {
-	copy(fac.begin(), fac.end(), back_inserter(faces));
+	faces.reserve(faces.size() + fac.size());
+	for(vector<HE_Face*>::const_iterator it = fac.begin(); it != fac.end(); ++it) {
+		addFace(*it);
+	}
 }
 
 // Retrieving elements
 // -----------------------------------------------------------------------------
-inline vector<HE_Vertex*> HE_Structure::getVertices() {
+inline const vector<HE_Vertex*>& HE_Structure::getVertices() const {
 	return vertices;
 }
 
-inline vector<HE_HalfEdge*> HE_Structure::getHalfEdges() {
+inline const vector<HE_HalfEdge*>& HE_Structure::getHalfEdges() const {
 	return half_edges;
 }
 
-inline vector<HE_Face*> HE_Structure::getFaces() {
+inline const vector<HE_Face*>& HE_Structure::getFaces() const {
 	return faces;
 }
 
-inline vector<HE_Edge*> HE_Structure::getEdges() {
+inline const vector<HE_Edge*>& HE_Structure::getEdges() const {
 	return edges;
 }
 
@@ -169,18 +202,30 @@ inline const vector<HE_Edge*>& HE_Structure::getEdgesRef() const {
 // Search for elements
 // -----------------------------------------------------------------------------
 inline bool HE_Structure::containsVertex(HE_Vertex* v) {
+	if(v->id != HE_INVALID_ID) {
+		return hasFlag(vertex_flags, v->id);
+	}
 	return find(vertices.begin(), vertices.end(), v) != vertices.end();
 }
 
 inline bool HE_Structure::containsEdge(HE_Edge* e) {
+	if(e->id != HE_INVALID_ID) {
+		return hasFlag(edge_flags, e->id);
+	}
 	return find(edges.begin(), edges.end(), e) != edges.end();
 }
 
 inline bool HE_Structure::containsHalfEdge(HE_HalfEdge* he) {
+	if(he->id != HE_INVALID_ID) {
+		return hasFlag(half_edge_flags, he->id);
+	}
 	return find(half_edges.begin(), half_edges.end(), he) != half_edges.end();
 }
 
 inline bool HE_Structure::containsFace(HE_Face* f) {
+	if(f->id != HE_INVALID_ID) {
+		return hasFlag(face_flags, f->id);
+	}
 	return find(faces.begin(), faces.end(), f) != faces.end();
 }
 
@@ -192,6 +237,24 @@ inline void HE_Structure::clear() {
 	half_edges.clear();
 	edges.clear();
 	faces.clear();
+	vertex_flags.clear();
+	half_edge_flags.clear();
+	edge_flags.clear();
+	face_flags.clear();
+}
+
+inline void HE_Structure::setFlag(vector<bool>& flags, uint32_t id) {
+	if(id == HE_INVALID_ID) {
+		return;
+	}
+	if(id >= flags.size()) {
+		flags.resize(std::max<size_t>(id + 1, flags.size() * 2), false);
+	}
+	flags[id] = true;
+}
+
+inline bool HE_Structure::hasFlag(const vector<bool>& flags, uint32_t id) {
+	return id < flags.size() && flags[id];
 }
 
 }; // roxlu
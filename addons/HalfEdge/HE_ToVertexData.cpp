@@ -0,0 +1,308 @@
+#include "HE_ToVertexData.h"
+#include "HE_Mesh.h"
+#include "VertexData.h"
+
+namespace roxlu {
+
+HE_ToVertexData::HE_ToVertexData()
+	:all_hard(false)
+	,stamp(0)
+	,dirty_first(1)
+	,dirty_last(0)
+{
+}
+
+void HE_ToVertexData::setHardFaces(HE_Selection& sel) {
+	const vector<HE_Face*>& faces = sel.getFacesRef();
+	for(vector<HE_Face*>::const_iterator it = faces.begin(); it != faces.end(); ++it) {
+		uint32_t id = (*it)->id;
+		if(id == HE_INVALID_ID) {
+			continue;
+		}
+		if(id >= hard_faces.size()) {
+			hard_faces.resize(id + 1, false);
+		}
+		hard_faces[id] = true;
+	}
+}
+
+bool HE_ToVertexData::create(HE_Mesh& mesh, VertexData& vd) {
+	const vector<HE_Vertex*>& verts = mesh.getVerticesRef();
+	const vector<HE_Face*>& faces = mesh.getFacesRef();
+
+	// vertex slots; shared vertices go first.
+	uint32_t max_id = 0;
+	for(vector<HE_Vertex*>::const_iterator it = verts.begin(); it != verts.end(); ++it) {
+		if((*it)->id != HE_INVALID_ID) {
+			max_id = std::max<uint32_t>(max_id, (*it)->id + 1);
+		}
+	}
+	vertex_slots.assign(max_id, HE_INVALID_ID);
+	stamps.assign(max_id, 0);
+	stamp = 0;
+	uint32_t num_slots = 0;
+	for(vector<HE_Vertex*>::const_iterator it = verts.begin(); it != verts.end(); ++it) {
+		if((*it)->id != HE_INVALID_ID) {
+			vertex_slots[(*it)->id] = num_slots++;
+		}
+	}
+	uint32_t num_shared = num_slots;
+
+	// count triangles and the corners of hard faces.
+	max_id = 0;
+	uint32_t num_triangles = 0;
+	for(vector<HE_Face*>::const_iterator it = faces.begin(); it != faces.end(); ++it) {
+		HE_Face* f = *it;
+		if(f->id == HE_INVALID_ID || f->getHalfEdge() == NULL) {
+			continue;
+		}
+		int n = f->getNumVertices();
+		if(n < 3) {
+			continue;
+		}
+		max_id = std::max<uint32_t>(max_id, f->id + 1);
+		num_triangles += n - 2;
+		if(isHard(f)) {
+			num_slots += n;
+		}
+	}
+	face_slots.assign(max_id, HE_INVALID_ID);
+
+	vd.clear();
+	vd.vertices.resize(num_slots);
+	vd.normals.assign(num_slots, Vec3());
+	vd.indices.resize(num_triangles * 3);
+	vd.triangles.assign(num_triangles, Triangle(0,0,0));
+	vd.enablePositionAttrib();
+	vd.enableNormalAttrib();
+
+	for(vector<HE_Vertex*>::const_iterator it = verts.begin(); it != verts.end(); ++it) {
+		if((*it)->id != HE_INVALID_ID) {
+			vd.vertices[vertex_slots[(*it)->id]] = (*it)->getPositionRef();
+		}
+	}
+
+	// walk all faces once: emit corners, fan triangles and accumulate normals.
+	vector<uint32_t> corners;
+	uint32_t hard_slot = num_shared;
+	uint32_t tri = 0;
+	for(vector<HE_Face*>::const_iterator it = faces.begin(); it != faces.end(); ++it) {
+		HE_Face* f = *it;
+		if(f->id >= face_slots.size() || f->getHalfEdge() == NULL) {
+			continue;
+		}
+		if(f->getNumVertices() < 3) {
+			continue; // not counted above, so it has no slots
+		}
+
+		Vec3 face_normal = getFaceNormal(f);
+		bool hard = isHard(f);
+		if(hard) {
+			face_slots[f->id] = hard_slot;
+			float len = face_normal.length();
+			if(len > 0.0f) {
+				face_normal /= len;
+			}
+		}
+
+		corners.clear();
+		HE_HalfEdge* start = f->getHalfEdge();
+		HE_HalfEdge* he = start;
+		do {
+			HE_Vertex* v = he->getVertex();
+			uint32_t slot = 0;
+			if(hard) {
+				slot = hard_slot++;
+				vd.vertices[slot] = v->getPositionRef();
+				vd.normals[slot] = face_normal;
+			}
+			else {
+				slot = vertex_slots[v->id];
+				vd.normals[slot] += face_normal; // area weighted
+			}
+			corners.push_back(slot);
+			he = he->getNext();
+		} while(he != start);
+
+		for(size_t k = 1; k + 1 < corners.size(); ++k, ++tri) {
+			vd.triangles[tri].set(corners[0], corners[k], corners[k+1]);
+			vd.indices[tri * 3 + 0] = corners[0];
+			vd.indices[tri * 3 + 1] = corners[k];
+			vd.indices[tri * 3 + 2] = corners[k+1];
+		}
+	}
+
+	for(uint32_t i = 0; i < num_shared; ++i) {
+		float len = vd.normals[i].length();
+		if(len > 0.0f) {
+			vd.normals[i] /= len;
+		}
+	}
+
+	if(num_slots) {
+		dirty_first = 0;
+		dirty_last = num_slots - 1;
+	}
+	else {
+		dirty_first = 1; // empty range
+		dirty_last = 0;
+	}
+	return true;
+}
+
+bool HE_ToVertexData::update(HE_Mesh& mesh, VertexData& vd, HE_Selection& changed) {
+	dirty_first = 1;
+	dirty_last = 0;
+	if(vertex_slots.empty()) {
+		return create(mesh, vd);
+	}
+
+	// two stamps per update: "position written" and "normal written"
+	if(stamp >= 0xFFFFFFF0) {
+		stamps.assign(stamps.size(), 0);
+		stamp = 0;
+	}
+	uint32_t stamp_pos = ++stamp;
+	uint32_t stamp_normal = ++stamp;
+
+	// collect the changed vertices; from the selected vertices and faces.
+	vector<HE_Vertex*> touched;
+	const vector<HE_Vertex*>& sel_verts = changed.getVerticesRef();
+	touched.reserve(sel_verts.size());
+	for(vector<HE_Vertex*>::const_iterator it = sel_verts.begin(); it != sel_verts.end(); ++it) {
+		touched.push_back(*it);
+	}
+	const vector<HE_Face*>& sel_faces = changed.getFacesRef();
+	for(vector<HE_Face*>::const_iterator it = sel_faces.begin(); it != sel_faces.end(); ++it) {
+		HE_HalfEdge* start = (*it)->getHalfEdge();
+		HE_HalfEdge* he = start;
+		while(he != NULL) {
+			touched.push_back(he->getVertex());
+			he = he->getNext();
+			if(he == start) {
+				break;
+			}
+		}
+	}
+
+	// write positions and find the faces around them.
+	vector<HE_Face*> faces;
+	for(vector<HE_Vertex*>::iterator it = touched.begin(); it != touched.end(); ++it) {
+		HE_Vertex* v = *it;
+		if(v->id >= vertex_slots.size() || stamps[v->id] == stamp_pos) {
+			continue;
+		}
+		stamps[v->id] = stamp_pos;
+		uint32_t slot = vertex_slots[v->id];
+		vd.vertices[slot] = v->getPositionRef();
+		markDirty(slot);
+
+		HE_HalfEdge* start = v->getHalfEdge();
+		HE_HalfEdge* he = start;
+		while(he != NULL) {
+			if(he->getFace() != NULL) {
+				faces.push_back(he->getFace());
+			}
+			he = he->getNextInVertex();
+			if(he == start) {
+				break;
+			}
+		}
+	}
+	std::sort(faces.begin(), faces.end());
+	faces.erase(std::unique(faces.begin(), faces.end()), faces.end());
+
+	// re-emit the faces: hard faces get new corners, shared vertices new normals.
+	for(vector<HE_Face*>::iterator it = faces.begin(); it != faces.end(); ++it) {
+		HE_Face* f = *it;
+		if(f->id >= face_slots.size()) {
+			continue;
+		}
+		bool hard = (face_slots[f->id] != HE_INVALID_ID);
+		Vec3 face_normal;
+		uint32_t slot = face_slots[f->id];
+		if(hard) {
+			face_normal = getFaceNormal(f);
+			float len = face_normal.length();
+			if(len > 0.0f) {
+				face_normal /= len;
+			}
+		}
+
+		HE_HalfEdge* start = f->getHalfEdge();
+		HE_HalfEdge* he = start;
+		do {
+			HE_Vertex* v = he->getVertex();
+			if(hard) {
+				vd.vertices[slot] = v->getPositionRef();
+				vd.normals[slot] = face_normal;
+				markDirty(slot);
+				++slot;
+			}
+			else if(v->id < vertex_slots.size() && stamps[v->id] != stamp_normal) {
+				stamps[v->id] = stamp_normal;
+				updateVertexNormal(v, vd);
+			}
+			he = he->getNext();
+		} while(he != start);
+	}
+	return true;
+}
+
+// Recalculate the normal of a shared vertex from all its smooth faces.
+void HE_ToVertexData::updateVertexNormal(HE_Vertex* v, VertexData& vd) {
+	Vec3 normal;
+	HE_HalfEdge* start = v->getHalfEdge();
+	HE_HalfEdge* he = start;
+	while(he != NULL) {
+		HE_Face* f = he->getFace();
+		if(f != NULL && !(f->id < face_slots.size() && face_slots[f->id] != HE_INVALID_ID)) {
+			normal += getFaceNormal(f);
+		}
+		he = he->getNextInVertex();
+		if(he == start) {
+			break;
+		}
+	}
+	float len = normal.length();
+	if(len > 0.0f) {
+		normal /= len;
+	}
+	uint32_t slot = vertex_slots[v->id];
+	vd.normals[slot] = normal;
+	markDirty(slot);
+}
+
+// Newell's method; the length of the normal is twice the area of the face.
+Vec3 HE_ToVertexData::getFaceNormal(HE_Face* f) {
+	Vec3 normal;
+	HE_HalfEdge* start = f->getHalfEdge();
+	HE_HalfEdge* he = start;
+	do {
+		Vec3& p0 = he->getVertex()->getPositionRef();
+		Vec3& p1 = he->getNext()->getVertex()->getPositionRef();
+		normal.x += (p0.y - p1.y) * (p0.z + p1.z);
+		normal.y += (p0.z - p1.z) * (p0.x + p1.x);
+		normal.z += (p0.x - p1.x) * (p0.y + p1.y);
+		he = he->getNext();
+	} while(he != start);
+	return normal;
+}
+
+bool HE_ToVertexData::isHard(HE_Face* f) {
+	if(all_hard) {
+		return true;
+	}
+	return f->id < hard_faces.size() && hard_faces[f->id];
+}
+
+void HE_ToVertexData::markDirty(uint32_t slot) {
+	if(dirty_first > dirty_last) {
+		dirty_first = dirty_last = slot;
+		return;
+	}
+	dirty_first = std::min<uint32_t>(dirty_first, slot);
+	dirty_last = std::max<uint32_t>(dirty_last, slot);
+}
+
+}; // roxlu
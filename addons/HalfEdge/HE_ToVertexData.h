@@ -0,0 +1,81 @@
+#ifndef HE_TOVERTEXDATAH
+#define HE_TOVERTEXDATAH
+
+#include "HE_Headers.h"
+#include "Vec3.h"
+
+/**
+ * Converts a HE_Mesh into a triangulated, indexed VertexData with
+ * area weighted vertex normals. All faces are walked once; the buffers
+ * are sized up front from the element counts.
+ *
+ * By default vertices are shared between faces (smooth). Faces which
+ * are marked as hard (setHardFaces(), setAllHard()) get their own
+ * vertices with the face normal so you get hard edges around them.
+ *
+ * After a modifier changed some vertices you can call update() with
+ * the selection you passed to the modifier. Only the faces which touch
+ * the selected vertices/faces are re-emitted, and getDirtyRange() tells
+ * you which part of the vertex/normal buffers needs to be uploaded
+ * again. The topology of the mesh must not have changed; call create()
+ * again when it did.
+ *
+ * Only elements which were created by the HE_Mesh (i.e. have a valid
+ * id) are exported.
+ *
+ */
+namespace roxlu {
+
+class HE_Mesh;
+class HE_Selection;
+class HE_Face;
+class HE_Vertex;
+class VertexData;
+
+class HE_ToVertexData {
+public:
+	HE_ToVertexData();
+	bool create(HE_Mesh& mesh, VertexData& vd);
+	bool update(HE_Mesh& mesh, VertexData& vd, HE_Selection& changed);
+
+	void setHardFaces(HE_Selection& sel);
+	inline void setAllHard(bool hard);
+	inline void clearHardFaces();
+	inline bool getDirtyRange(uint32_t& first, uint32_t& last); // vertex slots [first, last], false when nothing changed
+
+private:
+	Vec3 getFaceNormal(HE_Face* f); // not normalized; length is 2 * area
+	bool isHard(HE_Face* f);
+	void markDirty(uint32_t slot);
+	void updateVertexNormal(HE_Vertex* v, VertexData& vd);
+
+	bool all_hard;
+	vector<bool> hard_faces; // by face id
+	vector<uint32_t> vertex_slots; // by vertex id, slot in vd
+	vector<uint32_t> face_slots; // by face id, first corner slot for hard faces
+	vector<uint32_t> stamps; // by vertex id, used by update() to visit vertices once
+	uint32_t stamp;
+	uint32_t dirty_first;
+	uint32_t dirty_last;
+};
+
+inline void HE_ToVertexData::setAllHard(bool hard) {
+	all_hard = hard;
+}
+
+inline void HE_ToVertexData::clearHardFaces() {
+	hard_faces.clear();
+	all_hard = false;
+}
+
+inline bool HE_ToVertexData::getDirtyRange(uint32_t& first, uint32_t& last) {
+	if(dirty_first > dirty_last) {
+		return false;
+	}
+	first = dirty_first;
+	last = dirty_last;
+	return true;
+}
+
+}; // roxlu
+#endif
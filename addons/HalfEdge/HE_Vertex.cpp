@@ -5,21 +5,24 @@
 namespace roxlu {
 
 HE_Vertex::HE_Vertex() 
-	:label(-1)
+	:id(HE_INVALID_ID)
 	,half_edge(NULL)
+	,label(-1)
 {
 }
 
 HE_Vertex::HE_Vertex(Vec3 pos)
-	:position(pos)
-	,label(-1)
+	:id(HE_INVALID_ID)
+	,position(pos)
 	,half_edge(NULL)
+	,label(-1)
 {
 }
 
 HE_Vertex::HE_Vertex(float nx, float ny, float nz)
-	:label(-1)
+	:id(HE_INVALID_ID)
 	,half_edge(NULL)
+	,label(-1)
 {
 	position.set(nx, ny, nz);
 }
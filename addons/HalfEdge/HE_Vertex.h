@@ -4,6 +4,7 @@
 #include <set>
 #include "Vec2.h"
 #include "Vec3.h"
+#include "HE_Headers.h"
 
 using std::set;
 
@@ -25,6 +26,8 @@ public:
 	inline void setLabel(int l);
 	inline int getLabel();
 	set<HE_Vertex*> getNeighborVertices();
+	
+	uint32_t id; // index in the HE_Mesh arena
 
 private:
 	Vec3 position; // no, we do not use pointer for this.. to much of a hassle!
@@ -4,6 +4,8 @@
 #include "OSCReceiver.h"
 #include "OSCSender.h"
 #include "OSCMessage.h"
+#include "OSCMessageQueue.h"
+#include "OSCDispatcher.h"
 #include "OSCArg.h"
 
 using namespace roxlu;
@@ -65,7 +65,7 @@ public:
 	
 	virtual OSCArgType 	getType()		{ return OSCARG_TYPE_STRING; } 
 	virtual string 		getTypeName()	{ return "string"; 			} 
-	string	 			get() const 	{ return value; 			}
+	const string&		get() const 	{ return value; 			}
 	void 				set(string v) 	{ value = v;				}			
 	
 private: 
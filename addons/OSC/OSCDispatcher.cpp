@@ -0,0 +1,337 @@
+#include "OSCDispatcher.h"
+#include "OSCReceiver.h"
+#include <string.h>
+
+namespace roxlu {
+
+bool OSCArgs::set(const osc::ReceivedMessage& m) {
+	address = m.AddressPattern();
+	num_args = 0;
+	osc::ReceivedMessage::const_iterator it = m.ArgumentsBegin();
+	while(it != m.ArgumentsEnd() && num_args < OSC_MAX_ARGS) {
+		OSCArgValue& v = args[num_args];
+		if(it->IsInt32()) {
+			v.type = OSCARG_TYPE_INT32;
+			v.i = it->AsInt32Unchecked();
+		}
+		else if(it->IsFloat()) {
+			v.type = OSCARG_TYPE_FLOAT;
+			v.f = it->AsFloatUnchecked();
+		}
+		else if(it->IsString()) {
+			v.type = OSCARG_TYPE_STRING;
+			v.s = it->AsStringUnchecked();
+		}
+		else {
+			v.type = OSCARG_TYPE_NONE;
+		}
+		++num_args;
+		++it;
+	}
+	return it == m.ArgumentsEnd();
+}
+
+bool OSCArgs::set(const OSCQueuedMessage& m) {
+	address = m.getAddress();
+	num_args = m.getNumArgs();
+	for(size_t i = 0; i < num_args; ++i) {
+		OSCArgValue& v = args[i];
+		v.type = m.getType(i);
+		switch(v.type) {
+			case OSCARG_TYPE_INT32: v.i = m.getInt32(i); break;
+			case OSCARG_TYPE_FLOAT: v.f = m.getFloat(i); break;
+			case OSCARG_TYPE_STRING: v.s = m.getString(i); break;
+			default: break;
+		}
+	}
+	return true;
+}
+
+// OSCPattern
+// -----------------------------------------------------------------------------
+
+// Compiles one part of an address (between two slashes).
+bool OSCPattern::compile(const char* start, const char* end) {
+	tokens.clear();
+	const char* c = start;
+	while(c < end) {
+		OSCPatternToken token;
+		switch(*c) {
+			case '?': {
+				token.type = OSC_TOKEN_ANY;
+				++c;
+				break;
+			}
+			case '*': {
+				token.type = OSC_TOKEN_STAR;
+				while(c < end && *c == '*') {
+					++c;
+				}
+				break;
+			}
+			case '[': {
+				token.type = OSC_TOKEN_CLASS;
+				memset(token.chars, 0, sizeof(token.chars));
+				++c;
+				bool negate = (c < end && *c == '!');
+				if(negate) {
+					++c;
+				}
+				while(c < end && *c != ']') {
+					unsigned char from = *c;
+					unsigned char to = *c;
+					if(c + 2 < end && c[1] == '-' && c[2] != ']') {
+						to = c[2];
+						c += 2;
+					}
+					for(unsigned int ch = from; ch <= to; ++ch) {
+						token.chars[ch >> 5] |= (1u << (ch & 31));
+					}
+					++c;
+				}
+				if(c == end) {
+					printf("error: osc pattern has no closing ].\n");
+					return false;
+				}
+				if(negate) {
+					for(int i = 0; i < 8; ++i) {
+						token.chars[i] = ~token.chars[i];
+					}
+				}
+				++c;
+				break;
+			}
+			case '{': {
+				token.type = OSC_TOKEN_ALTERNATIVES;
+				++c;
+				const char* alt = c;
+				while(c < end && *c != '}') {
+					if(*c == ',') {
+						token.alternatives.push_back(string(alt, c));
+						alt = c + 1;
+					}
+					++c;
+				}
+				if(c == end) {
+					printf("error: osc pattern has no closing }.\n");
+					return false;
+				}
+				token.alternatives.push_back(string(alt, c));
+				++c;
+				break;
+			}
+			default: {
+				token.type = OSC_TOKEN_LITERAL;
+				const char* lit = c;
+				while(c < end && !strchr("?*[{", *c)) {
+					++c;
+				}
+				token.literal.assign(lit, c);
+				break;
+			}
+		}
+		tokens.push_back(token);
+	}
+	return true;
+}
+
+bool OSCPattern::match(const char* start, const char* end) const {
+	return match(0, start, end);
+}
+
+bool OSCPattern::match(size_t dx, const char* start, const char* end) const {
+	if(dx == tokens.size()) {
+		return start == end;
+	}
+	const OSCPatternToken& token = tokens[dx];
+	size_t len = end - start;
+	switch(token.type) {
+		case OSC_TOKEN_LITERAL: {
+			return len >= token.literal.size() 
+				&& memcmp(start, token.literal.data(), token.literal.size()) == 0 
+				&& match(dx + 1, start + token.literal.size(), end);
+		}
+		case OSC_TOKEN_ANY: {
+			return len > 0 && match(dx + 1, start + 1, end);
+		}
+		case OSC_TOKEN_STAR: {
+			if(dx + 1 == tokens.size()) {
+				return true;
+			}
+			for(const char* c = start; c <= end; ++c) {
+				if(match(dx + 1, c, end)) {
+					return true;
+				}
+			}
+			return false;
+		}
+		case OSC_TOKEN_CLASS: {
+			unsigned char ch = *start;
+			return len > 0 && (token.chars[ch >> 5] & (1u << (ch & 31))) && match(dx + 1, start + 1, end);
+		}
+		case OSC_TOKEN_ALTERNATIVES: {
+			for(size_t i = 0; i < token.alternatives.size(); ++i) {
+				const string& alt = token.alternatives[i];
+				if(len >= alt.size() && memcmp(start, alt.data(), alt.size()) == 0 && match(dx + 1, start + alt.size(), end)) {
+					return true;
+				}
+			}
+			return false;
+		}
+		default: {
+			return false;
+		}
+	}
+}
+
+// OSCDispatcher
+// -----------------------------------------------------------------------------
+
+void OSCDispatchNode::clear() {
+	for(map<string, OSCDispatchNode*>::iterator it = children.begin(); it != children.end(); ++it) {
+		delete it->second;
+	}
+	for(size_t i = 0; i < patterns.size(); ++i) {
+		delete patterns[i].node;
+	}
+	for(size_t i = 0; i < handlers.size(); ++i) {
+		delete handlers[i];
+	}
+	children.clear();
+	patterns.clear();
+	handlers.clear();
+}
+
+OSCDispatcher::OSCDispatcher()
+	:num_unhandled(0)
+{
+}
+
+OSCDispatcher::~OSCDispatcher() {
+}
+
+void OSCDispatcher::clear() {
+	root.clear();
+}
+
+// Adds the parts of the pattern to the trie; the same parts share nodes.
+bool OSCDispatcher::add(const string& pattern, OSCHandler* handler) {
+	if(!pattern.size() || pattern[0] != '/') {
+		printf("error: an osc address must start with a /: %s\n", pattern.c_str());
+		delete handler;
+		return false;
+	}
+	OSCDispatchNode* node = &root;
+	const char* part = pattern.c_str() + 1;
+	const char* end = pattern.c_str() + pattern.size();
+	while(part <= end) {
+		const char* part_end = part;
+		while(part_end < end && *part_end != '/') {
+			++part_end;
+		}
+		string name(part, part_end);
+		if(name.find_first_of("?*[{") == string::npos) {
+			OSCDispatchNode*& child = node->children[name];
+			if(!child) {
+				child = new OSCDispatchNode();
+			}
+			node = child;
+		}
+		else {
+			OSCDispatchNode* child = NULL;
+			for(size_t i = 0; i < node->patterns.size(); ++i) {
+				if(node->patterns[i].source == name) {
+					child = node->patterns[i].node;
+					break;
+				}
+			}
+			if(!child) {
+				OSCDispatchPattern p;
+				p.source = name;
+				if(!p.pattern.compile(part, part_end)) {
+					delete handler;
+					return false;
+				}
+				p.node = child = new OSCDispatchNode();
+				node->patterns.push_back(p);
+			}
+			node = child;
+		}
+		part = part_end + 1;
+	}
+	node->handlers.push_back(handler);
+	return true;
+}
+
+bool OSCDispatcher::dispatch(const osc::ReceivedMessage& m) {
+	OSCArgs args;
+	if(!args.set(m)) {
+		++num_unhandled;
+		return false;
+	}
+	return dispatch(args);
+}
+
+bool OSCDispatcher::dispatch(const OSCQueuedMessage& m) {
+	OSCArgs args;
+	args.set(m);
+	return dispatch(args);
+}
+
+bool OSCDispatcher::dispatch(const OSCArgs& args) {
+	const char* address = args.getAddress();
+	bool handled = false;
+	if(address[0] == '/') {
+		match(&root, address + 1, args, handled);
+	}
+	if(!handled) {
+		++num_unhandled;
+	}
+	return handled;
+}
+
+size_t OSCDispatcher::dispatch(OSCReceiver& receiver) {
+	size_t num = receiver.readMessages(queued);
+	for(size_t i = 0; i < num; ++i) {
+		dispatch(*queued[i]);
+	}
+	receiver.releaseMessages();
+	return num;
+}
+
+void OSCDispatcher::match(OSCDispatchNode* node, const char* part, const OSCArgs& args, bool& handled) {
+	const char* part_end = strchr(part, '/');
+	bool last = (part_end == NULL);
+	if(last) {
+		part_end = part + strlen(part);
+	}
+	
+	map<string, OSCDispatchNode*>::iterator it = node->children.find(string(part, part_end));
+	if(it != node->children.end()) {
+		if(last) {
+			for(size_t i = 0; i < it->second->handlers.size(); ++i) {
+				handled = it->second->handlers[i]->call(args) || handled;
+			}
+		}
+		else {
+			match(it->second, part_end + 1, args, handled);
+		}
+	}
+	
+	for(size_t i = 0; i < node->patterns.size(); ++i) {
+		OSCDispatchPattern& p = node->patterns[i];
+		if(!p.pattern.match(part, part_end)) {
+			continue;
+		}
+		if(last) {
+			for(size_t j = 0; j < p.node->handlers.size(); ++j) {
+				handled = p.node->handlers[j]->call(args) || handled;
+			}
+		}
+		else {
+			match(p.node, part_end + 1, args, handled);
+		}
+	}
+}
+
+} // roxlu
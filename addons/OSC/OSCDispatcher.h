@@ -0,0 +1,362 @@
+#ifndef ROXLU_OSC_DISPATCHERH
+#define ROXLU_OSC_DISPATCHERH
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+#include "OSCArg.h"
+#include "OSCMessageQueue.h"
+#include "OscReceivedElements.h"
+
+using std::string;
+using std::vector;
+using std::map;
+
+/*
+
+Routes messages to handlers by address. Handlers are added with an OSC
+address pattern which is compiled once into a trie with one level per
+address part, so routing a message costs about the same for 10 or 10.000
+handlers. Supported in patterns: `*`, `?`, `[a-z]`, `[!0-9]` and `{foo,bar}`
+(within one part of the address).
+
+Handlers are member functions which get the arguments unpacked, for 0 to
+4 arguments of type int, float, double, bool, const char* or string; or
+a function which gets all arguments with `const OSCArgs&`. When the
+arguments of a message don't match the handler isn't called.
+
+	OSCDispatcher dispatcher;
+	dispatcher.add("/led/{1,2,3}/color", this, &App::onColor); // void onColor(float r, float g, float b)
+	dispatcher.add("/sensor/[0-9]/{x,y}", this, &App::onSensor); // void onSensor(const OSCArgs& args)
+
+	// on the main thread, all queued messages at once:
+	dispatcher.dispatch(receiver);
+
+	// or straight on the receive thread (no queue, no copies):
+	receiver.setDispatcher(&dispatcher);
+
+Add all handlers before messages are dispatched on the receive thread.
+
+*/
+namespace roxlu {
+
+class OSCReceiver;
+
+// The arguments of a received message; strings point into the message.
+struct OSCArgValue {
+	OSCArgType type;
+	union {
+		int32_t i;
+		float f;
+		const char* s;
+	};
+};
+
+class OSCArgs {
+public:
+	bool set(const osc::ReceivedMessage& m);
+	bool set(const OSCQueuedMessage& m);
+	const char* getAddress() const;
+	size_t getNumArgs() const;
+	OSCArgType getType(size_t dx) const;
+	int32_t getInt32(size_t dx) const;
+	float getFloat(size_t dx) const;
+	const char* getString(size_t dx) const;
+	bool isNumber(size_t dx) const;
+	
+private:
+	const char* address;
+	size_t num_args;
+	OSCArgValue args[OSC_MAX_ARGS];
+};
+
+// Converts an argument to a handler parameter.
+template<class A> struct OSCArgTraits {};
+
+template<> struct OSCArgTraits<int> {
+	static bool check(const OSCArgs& a, size_t dx) { return a.isNumber(dx); }
+	static int get(const OSCArgs& a, size_t dx) { return a.getInt32(dx); }
+};
+
+template<> struct OSCArgTraits<bool> {
+	static bool check(const OSCArgs& a, size_t dx) { return a.isNumber(dx); }
+	static bool get(const OSCArgs& a, size_t dx) { return a.getInt32(dx) != 0; }
+};
+
+template<> struct OSCArgTraits<float> {
+	static bool check(const OSCArgs& a, size_t dx) { return a.isNumber(dx); }
+	static float get(const OSCArgs& a, size_t dx) { return a.getFloat(dx); }
+};
+
+template<> struct OSCArgTraits<double> {
+	static bool check(const OSCArgs& a, size_t dx) { return a.isNumber(dx); }
+	static double get(const OSCArgs& a, size_t dx) { return a.getFloat(dx); }
+};
+
+template<> struct OSCArgTraits<const char*> {
+	static bool check(const OSCArgs& a, size_t dx) { return a.getType(dx) == OSCARG_TYPE_STRING; }
+	static const char* get(const OSCArgs& a, size_t dx) { return a.getString(dx); }
+};
+
+template<> struct OSCArgTraits<string> {
+	static bool check(const OSCArgs& a, size_t dx) { return a.getType(dx) == OSCARG_TYPE_STRING; }
+	static string get(const OSCArgs& a, size_t dx) { return a.getString(dx); }
+};
+
+template<> struct OSCArgTraits<const string&> : public OSCArgTraits<string> {};
+
+// -----------------------------------------------------------------------------
+
+class OSCHandler {
+public:
+	virtual ~OSCHandler() {}
+	virtual bool call(const OSCArgs& args) = 0; // false when the arguments don't match
+};
+
+template<class T>
+class OSCHandlerArgs : public OSCHandler {
+public:
+	OSCHandlerArgs(T* obj, void (T::*fn)(const OSCArgs&)):obj(obj),fn(fn) {}
+	bool call(const OSCArgs& args) { (obj->*fn)(args); return true; }
+private:
+	T* obj;
+	void (T::*fn)(const OSCArgs&);
+};
+
+template<class T>
+class OSCHandler0 : public OSCHandler {
+public:
+	OSCHandler0(T* obj, void (T::*fn)()):obj(obj),fn(fn) {}
+	bool call(const OSCArgs& args) { (obj->*fn)(); return true; }
+private:
+	T* obj;
+	void (T::*fn)();
+};
+
+template<class T, class A>
+class OSCHandler1 : public OSCHandler {
+public:
+	OSCHandler1(T* obj, void (T::*fn)(A)):obj(obj),fn(fn) {}
+	bool call(const OSCArgs& args) {
+		if(args.getNumArgs() < 1 || !OSCArgTraits<A>::check(args, 0)) {
+			return false;
+		}
+		(obj->*fn)(OSCArgTraits<A>::get(args, 0));
+		return true;
+	}
+private:
+	T* obj;
+	void (T::*fn)(A);
+};
+
+template<class T, class A, class B>
+class OSCHandler2 : public OSCHandler {
+public:
+	OSCHandler2(T* obj, void (T::*fn)(A, B)):obj(obj),fn(fn) {}
+	bool call(const OSCArgs& args) {
+		if(args.getNumArgs() < 2 || !OSCArgTraits<A>::check(args, 0) || !OSCArgTraits<B>::check(args, 1)) {
+			return false;
+		}
+		(obj->*fn)(OSCArgTraits<A>::get(args, 0), OSCArgTraits<B>::get(args, 1));
+		return true;
+	}
+private:
+	T* obj;
+	void (T::*fn)(A, B);
+};
+
+template<class T, class A, class B, class C>
+class OSCHandler3 : public OSCHandler {
+public:
+	OSCHandler3(T* obj, void (T::*fn)(A, B, C)):obj(obj),fn(fn) {}
+	bool call(const OSCArgs& args) {
+		if(args.getNumArgs() < 3 
+			|| !OSCArgTraits<A>::check(args, 0) 
+			|| !OSCArgTraits<B>::check(args, 1) 
+			|| !OSCArgTraits<C>::check(args, 2)) 
+		{
+			return false;
+		}
+		(obj->*fn)(OSCArgTraits<A>::get(args, 0), OSCArgTraits<B>::get(args, 1), OSCArgTraits<C>::get(args, 2));
+		return true;
+	}
+private:
+	T* obj;
+	void (T::*fn)(A, B, C);
+};
+
+template<class T, class A, class B, class C, class D>
+class OSCHandler4 : public OSCHandler {
+public:
+	OSCHandler4(T* obj, void (T::*fn)(A, B, C, D)):obj(obj),fn(fn) {}
+	bool call(const OSCArgs& args) {
+		if(args.getNumArgs() < 4 
+			|| !OSCArgTraits<A>::check(args, 0) 
+			|| !OSCArgTraits<B>::check(args, 1) 
+			|| !OSCArgTraits<C>::check(args, 2) 
+			|| !OSCArgTraits<D>::check(args, 3)) 
+		{
+			return false;
+		}
+		(obj->*fn)(OSCArgTraits<A>::get(args, 0), OSCArgTraits<B>::get(args, 1), OSCArgTraits<C>::get(args, 2), OSCArgTraits<D>::get(args, 3));
+		return true;
+	}
+private:
+	T* obj;
+	void (T::*fn)(A, B, C, D);
+};
+
+// -----------------------------------------------------------------------------
+
+// One compiled part of an address pattern.
+enum OSCPatternTokenTypes {
+	 OSC_TOKEN_LITERAL
+	,OSC_TOKEN_ANY // ?
+	,OSC_TOKEN_STAR // *
+	,OSC_TOKEN_CLASS // [...]
+	,OSC_TOKEN_ALTERNATIVES // {...}
+};
+
+struct OSCPatternToken {
+	int type;
+	string literal;
+	vector<string> alternatives;
+	uint32_t chars[8]; // bitset for OSC_TOKEN_CLASS
+};
+
+class OSCPattern {
+public:
+	bool compile(const char* start, const char* end);
+	bool match(const char* start, const char* end) const;
+	
+private:
+	bool match(size_t token, const char* start, const char* end) const;
+	vector<OSCPatternToken> tokens;
+};
+
+struct OSCDispatchNode;
+
+struct OSCDispatchPattern {
+	string source;
+	OSCPattern pattern;
+	OSCDispatchNode* node;
+};
+
+struct OSCDispatchNode {
+	~OSCDispatchNode() { clear(); }
+	void clear();
+	map<string, OSCDispatchNode*> children; // literal parts
+	vector<OSCDispatchPattern> patterns; // parts with wildcards
+	vector<OSCHandler*> handlers;
+};
+
+class OSCDispatcher {
+public:
+	OSCDispatcher();
+	~OSCDispatcher();
+	
+	template<class T> bool add(const string& pattern, T* obj, void (T::*fn)(const OSCArgs&));
+	template<class T> bool add(const string& pattern, T* obj, void (T::*fn)());
+	template<class T, class A> bool add(const string& pattern, T* obj, void (T::*fn)(A));
+	template<class T, class A, class B> bool add(const string& pattern, T* obj, void (T::*fn)(A, B));
+	template<class T, class A, class B, class C> bool add(const string& pattern, T* obj, void (T::*fn)(A, B, C));
+	template<class T, class A, class B, class C, class D> bool add(const string& pattern, T* obj, void (T::*fn)(A, B, C, D));
+	bool add(const string& pattern, OSCHandler* handler); // takes ownership
+	void clear();
+	
+	bool dispatch(const osc::ReceivedMessage& m);
+	bool dispatch(const OSCQueuedMessage& m);
+	bool dispatch(const OSCArgs& args); // returns false when no handler was called
+	size_t dispatch(OSCReceiver& receiver); // all queued messages
+	
+	uint64_t getNumUnhandled(); // no matching address or arguments
+	
+private:
+	void match(OSCDispatchNode* node, const char* part, const OSCArgs& args, bool& handled);
+	
+	OSCDispatchNode root;
+	vector<OSCQueuedMessage*> queued;
+	uint64_t num_unhandled;
+};
+
+inline const char* OSCArgs::getAddress() const {
+	return address;
+}
+
+inline size_t OSCArgs::getNumArgs() const {
+	return num_args;
+}
+
+inline OSCArgType OSCArgs::getType(size_t dx) const {
+	return (dx < num_args) ? args[dx].type : OSCARG_TYPE_OUTOFBOUND;
+}
+
+inline bool OSCArgs::isNumber(size_t dx) const {
+	OSCArgType type = getType(dx);
+	return type == OSCARG_TYPE_INT32 || type == OSCARG_TYPE_FLOAT;
+}
+
+inline int32_t OSCArgs::getInt32(size_t dx) const {
+	OSCArgType type = getType(dx);
+	if(type == OSCARG_TYPE_INT32) {
+		return args[dx].i;
+	}
+	if(type == OSCARG_TYPE_FLOAT) {
+		return args[dx].f;
+	}
+	return 0;
+}
+
+inline float OSCArgs::getFloat(size_t dx) const {
+	OSCArgType type = getType(dx);
+	if(type == OSCARG_TYPE_FLOAT) {
+		return args[dx].f;
+	}
+	if(type == OSCARG_TYPE_INT32) {
+		return args[dx].i;
+	}
+	return 0.0f;
+}
+
+inline const char* OSCArgs::getString(size_t dx) const {
+	return (getType(dx) == OSCARG_TYPE_STRING) ? args[dx].s : "";
+}
+
+template<class T>
+inline bool OSCDispatcher::add(const string& pattern, T* obj, void (T::*fn)(const OSCArgs&)) {
+	return add(pattern, new OSCHandlerArgs<T>(obj, fn));
+}
+
+template<class T>
+inline bool OSCDispatcher::add(const string& pattern, T* obj, void (T::*fn)()) {
+	return add(pattern, new OSCHandler0<T>(obj, fn));
+}
+
+template<class T, class A>
+inline bool OSCDispatcher::add(const string& pattern, T* obj, void (T::*fn)(A)) {
+	return add(pattern, new OSCHandler1<T, A>(obj, fn));
+}
+
+template<class T, class A, class B>
+inline bool OSCDispatcher::add(const string& pattern, T* obj, void (T::*fn)(A, B)) {
+	return add(pattern, new OSCHandler2<T, A, B>(obj, fn));
+}
+
+template<class T, class A, class B, class C>
+inline bool OSCDispatcher::add(const string& pattern, T* obj, void (T::*fn)(A, B, C)) {
+	return add(pattern, new OSCHandler3<T, A, B, C>(obj, fn));
+}
+
+template<class T, class A, class B, class C, class D>
+inline bool OSCDispatcher::add(const string& pattern, T* obj, void (T::*fn)(A, B, C, D)) {
+	return add(pattern, new OSCHandler4<T, A, B, C, D>(obj, fn));
+}
+
+inline uint64_t OSCDispatcher::getNumUnhandled() {
+	return num_unhandled;
+}
+
+} // roxlu
+
+#endif
@@ -0,0 +1,99 @@
+#include "OSCMessageQueue.h"
+#include "IpEndpointName.h"
+
+namespace roxlu {
+
+// Returns false when the message doesn't fit. Unhandled argument types are
+// skipped, like OSCReceiver always did.
+bool OSCQueuedMessage::set(const osc::ReceivedMessage& m, unsigned long remoteAddress, int remotePort) {
+	const char* addr = m.AddressPattern();
+	size_t len = strlen(addr);
+	if(len >= OSC_MAX_ADDRESS_LENGTH) {
+		return false;
+	}
+	memcpy(address, addr, len + 1);
+	remote_address = remoteAddress;
+	remote_port = remotePort;
+	num_args = 0;
+	
+	uint32_t strings_used = 0;
+	osc::ReceivedMessage::const_iterator it = m.ArgumentsBegin();
+	while(it != m.ArgumentsEnd()) {
+		if(num_args == OSC_MAX_ARGS) {
+			return false;
+		}
+		if(it->IsInt32()) {
+			types[num_args] = OSCARG_TYPE_INT32;
+			args[num_args].i = it->AsInt32Unchecked();
+		}
+		else if(it->IsFloat()) {
+			types[num_args] = OSCARG_TYPE_FLOAT;
+			args[num_args].f = it->AsFloatUnchecked();
+		}
+		else if(it->IsString()) {
+			const char* str = it->AsStringUnchecked();
+			size_t str_len = strlen(str);
+			if(strings_used + str_len + 1 > OSC_MAX_STRING_DATA) {
+				return false;
+			}
+			types[num_args] = OSCARG_TYPE_STRING;
+			args[num_args].offset = strings_used;
+			memcpy(strings + strings_used, str, str_len + 1);
+			strings_used += str_len + 1;
+		}
+		else {
+			++it;
+			continue;
+		}
+		++num_args;
+		++it;
+	}
+	return true;
+}
+
+void OSCQueuedMessage::toMessage(OSCMessage& result) const {
+	result.clear();
+	result.setAddress(address);
+	char host[IpEndpointName::ADDRESS_STRING_LENGTH];
+	getRemoteHost(host);
+	result.setRemoteEndpoint(host, remote_port);
+	for(int i = 0; i < num_args; ++i) {
+		switch(types[i]) {
+			case OSCARG_TYPE_INT32: result.addInt32(args[i].i); break;
+			case OSCARG_TYPE_FLOAT: result.addFloat(args[i].f); break;
+			case OSCARG_TYPE_STRING: result.addString(strings + args[i].offset); break;
+			default: break;
+		}
+	}
+}
+
+void OSCQueuedMessage::getRemoteHost(char* host) const {
+	IpEndpointName(remote_address, remote_port).AddressAsString(host);
+}
+
+// -----------------------------------------------------------------------------
+
+OSCMessageQueue::OSCMessageQueue(size_t capacity)
+	:mask(0)
+	,head(0)
+	,tail(0)
+{
+	size_t n = 2;
+	while(n < capacity) {
+		n <<= 1;
+	}
+	messages.resize(n);
+	mask = n - 1;
+}
+
+// Returns the messages which are not released yet, oldest first.
+size_t OSCMessageQueue::read(vector<OSCQueuedMessage*>& result) {
+	size_t end = head;
+	__sync_synchronize();
+	for(size_t i = tail; i != end; ++i) {
+		result.push_back(&messages[i & mask]);
+	}
+	return end - tail;
+}
+
+} // roxlu
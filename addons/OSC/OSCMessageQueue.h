@@ -0,0 +1,172 @@
+#ifndef ROXLU_OSC_MESSAGEQUEUEH
+#define ROXLU_OSC_MESSAGEQUEUEH
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include "OSCArg.h"
+#include "OSCMessage.h"
+#include "OscReceivedElements.h"
+
+using std::vector;
+
+#define OSC_MAX_ADDRESS_LENGTH 128
+#define OSC_MAX_ARGS 16
+#define OSC_MAX_STRING_DATA 512 // all string arguments of one message
+
+namespace roxlu {
+
+/*
+
+A received message with a fixed capacity so it can be reused without any
+allocations. Messages with a longer address, more arguments or more
+string data don't fit and are dropped by the receiver.
+
+The strings returned by getAddress() and getString() are valid as long
+as the message isn't released.
+
+*/
+struct OSCQueuedMessage {
+	bool set(const osc::ReceivedMessage& m, unsigned long remoteAddress, int remotePort);
+	void toMessage(OSCMessage& result) const;
+	const char* getAddress() const;
+	size_t getNumArgs() const;
+	OSCArgType getType(int dx) const;
+	int32_t getInt32(int dx) const;
+	float getFloat(int dx) const;
+	const char* getString(int dx) const;
+	unsigned long getRemoteAddress() const; // host byte order
+	int getRemotePort() const;
+	void getRemoteHost(char* host) const; // IpEndpointName::ADDRESS_STRING_LENGTH
+	
+	char address[OSC_MAX_ADDRESS_LENGTH];
+	uint8_t num_args;
+	uint8_t types[OSC_MAX_ARGS]; // OSCArgType
+	union {
+		int32_t i;
+		float f;
+		uint32_t offset; // into strings
+	} args[OSC_MAX_ARGS];
+	char strings[OSC_MAX_STRING_DATA];
+	unsigned long remote_address;
+	int remote_port;
+};
+
+/*
+
+Bounded single producer, single consumer ring of preallocated messages.
+The producer (receive thread) fills the next free message in place and
+publishes it; the consumer reads and releases messages in batches. No
+locks and no allocations after construction.
+
+*/
+class OSCMessageQueue {
+public:
+	OSCMessageQueue(size_t capacity); // rounded up to a power of two
+	
+	// producer
+	OSCQueuedMessage* beginWrite(); // NULL when full
+	void endWrite();
+	
+	// consumer
+	bool isEmpty() const;
+	size_t read(vector<OSCQueuedMessage*>& result); // appends the messages which are not released, returns the number
+	OSCQueuedMessage* front(); // NULL when empty
+	void release(size_t num); // the oldest num messages can be reused
+	size_t size() const;
+	size_t capacity() const;
+	
+private:
+	vector<OSCQueuedMessage> messages;
+	size_t mask;
+	volatile size_t head; // written by the producer
+	volatile size_t tail; // written by the consumer
+};
+
+inline const char* OSCQueuedMessage::getAddress() const {
+	return address;
+}
+
+inline size_t OSCQueuedMessage::getNumArgs() const {
+	return num_args;
+}
+
+inline OSCArgType OSCQueuedMessage::getType(int dx) const {
+	return (dx < num_args) ? (OSCArgType)types[dx] : OSCARG_TYPE_OUTOFBOUND;
+}
+
+inline int32_t OSCQueuedMessage::getInt32(int dx) const {
+	OSCArgType type = getType(dx);
+	if(type == OSCARG_TYPE_INT32) {
+		return args[dx].i;
+	}
+	if(type == OSCARG_TYPE_FLOAT) {
+		return args[dx].f;
+	}
+	return 0;
+}
+
+inline float OSCQueuedMessage::getFloat(int dx) const {
+	OSCArgType type = getType(dx);
+	if(type == OSCARG_TYPE_FLOAT) {
+		return args[dx].f;
+	}
+	if(type == OSCARG_TYPE_INT32) {
+		return args[dx].i;
+	}
+	return 0.0f;
+}
+
+inline const char* OSCQueuedMessage::getString(int dx) const {
+	return (getType(dx) == OSCARG_TYPE_STRING) ? strings + args[dx].offset : "";
+}
+
+inline unsigned long OSCQueuedMessage::getRemoteAddress() const {
+	return remote_address;
+}
+
+inline int OSCQueuedMessage::getRemotePort() const {
+	return remote_port;
+}
+
+inline size_t OSCMessageQueue::capacity() const {
+	return messages.size();
+}
+
+inline size_t OSCMessageQueue::size() const {
+	return head - tail;
+}
+
+inline bool OSCMessageQueue::isEmpty() const {
+	return head == tail;
+}
+
+inline OSCQueuedMessage* OSCMessageQueue::beginWrite() {
+	if(head - tail >= messages.size()) {
+		return NULL;
+	}
+	return &messages[head & mask];
+}
+
+// Publishes the message from beginWrite().
+inline void OSCMessageQueue::endWrite() {
+	__sync_synchronize();
+	head = head + 1;
+}
+
+inline OSCQueuedMessage* OSCMessageQueue::front() {
+	if(head == tail) {
+		return NULL;
+	}
+	__sync_synchronize();
+	return &messages[tail & mask];
+}
+
+inline void OSCMessageQueue::release(size_t num) {
+	__sync_synchronize();
+	tail = tail + num;
+}
+
+} // roxlu
+
+#endif
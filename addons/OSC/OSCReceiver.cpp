@@ -1,15 +1,15 @@
 #include "OSCReceiver.h"
+#include "OSCDispatcher.h"
 namespace roxlu {
 
-OSCReceiver::OSCReceiver(int port)
+OSCReceiver::OSCReceiver(int port, size_t queueSize)
 	:port(port)
 	,listen_socket(NULL)
+	,queue(queueSize)
+	,dispatcher(NULL)
+	,num_read(0)
+	,num_dropped(0)
 {
-	#ifdef TARGET_WIN32
-	#else
-		pthread_mutex_init(&mutex, NULL);
-	#endif
-	
 	has_shutdown = false;
 	listen_socket = new UdpListeningReceiveSocket(
 							IpEndpointName(
@@ -26,29 +26,27 @@ OSCReceiver::~OSCReceiver() {
 	shutdown();
 }
 
-bool OSCReceiver::hasMessages() {	
-	grabMutex();
-	size_t len = messages.size();
-	releaseMutex();
-	return len > 0;
-}
-
 bool OSCReceiver::getNextMessage(OSCMessage* m) {
-	grabMutex();
-	if(messages.size() == 0) {
-		releaseMutex();
+	OSCQueuedMessage* msg = queue.front();
+	if(!msg) {
 		return false;
 	}
-	OSCMessage* msg = messages.front();
-	m->copy(*msg);
-
-	delete msg;
-	messages.pop_front();
-	releaseMutex();
-	
+	msg->toMessage(*m);
+	queue.release(1);
 	return true;
 }
 
+size_t OSCReceiver::readMessages(vector<OSCQueuedMessage*>& result) {
+	result.clear();
+	num_read = queue.read(result);
+	return num_read;
+}
+
+void OSCReceiver::releaseMessages() {
+	queue.release(num_read);
+	num_read = 0;
+}
+
 void OSCReceiver::shutdown() {
 	if(!listen_socket) {
 		return;
@@ -62,12 +60,6 @@ void OSCReceiver::shutdown() {
 		#endif
 	}
 	
-	#ifdef TARGET_WIN32 
-		ReleaseMutex(mutex);
-	#else
-		pthread_mutex_destroy(&mutex);
-	#endif
-	
 	delete listen_socket;
 	listen_socket = NULL;
 }
@@ -84,51 +76,18 @@ void OSCReceiver::ProcessMessage(
 	,const IpEndpointName& endpoint 
 )
 {
-
-	OSCMessage* oscm = new OSCMessage();
-	oscm->setAddress(m.AddressPattern());
-	
-	char endpoint_host[IpEndpointName::ADDRESS_STRING_LENGTH];
-	endpoint.AddressAsString(endpoint_host);
-	oscm->setRemoteEndpoint(endpoint_host, endpoint.port);
-		
-	osc::ReceivedMessage::const_iterator it = m.ArgumentsBegin();
-	while(it != m.ArgumentsEnd()) {
-		if(it->IsInt32()) {
-			oscm->addInt32(it->AsInt32Unchecked());
-		}
-		else if(it->IsFloat()) {
-			oscm->addFloat(it->AsFloatUnchecked());
-		}
-		else if(it->IsString()) {
-			oscm->addString(it->AsStringUnchecked());
-		}
-		else {
-			printf("warning: unhandled received type.\n");
-		}
-		++it;
-	}
-		
-	grabMutex();
-		messages.push_back(oscm);
-	releaseMutex();
-}
-
-#ifdef TARGET_WIN32
-	void OSCReceiver::grabMutex() {
-	}
-
-	void OSCReceiver::releaseMutex() {
-	}
-#else 
-
-	void OSCReceiver::grabMutex() {
-		pthread_mutex_lock(&mutex);
+	OSCDispatcher* d = dispatcher;
+	if(d) {
+		d->dispatch(m);
+		return;
 	}
 
-	void OSCReceiver::releaseMutex() {
-		pthread_mutex_unlock(&mutex);
+	OSCQueuedMessage* msg = queue.beginWrite();
+	if(!msg || !msg->set(m, endpoint.address, endpoint.port)) {
+		__sync_fetch_and_add(&num_dropped, 1);
+		return;
 	}
+	queue.endWrite();
+}
 
-#endif
 } // roxlu
\ No newline at end of file
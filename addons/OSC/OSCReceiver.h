@@ -2,45 +2,88 @@
 #define ROXLU_OSCH
 
 #include "OSCMessage.h"
+#include "OSCMessageQueue.h"
 #include "OscTypes.h"
 #include "OscPacketListener.h"
 #include "UdpSocket.h"
 #include "pthread.h"
-#include <deque>
+#include <vector>
 
-using std::deque;
+using std::vector;
 
+/*
+
+Receives messages on a separate thread. The receive thread writes the
+messages into a lock-free ring of preallocated messages, see 
+OSCMessageQueue. When the ring is full new messages are dropped (see
+getNumDropped()); make it big enough for the messages you get between two
+reads.
+
+Reading all pending messages at once (no copies, no allocations):
+
+	vector<OSCQueuedMessage*> messages; // keep this around
+	receiver.readMessages(messages);
+	for(size_t i = 0; i < messages.size(); ++i) {
+		printf("%s %f\n", messages[i]->getAddress(), messages[i]->getFloat(0));
+	}
+	receiver.releaseMessages();
+
+getNextMessage() still works but copies into an OSCMessage; don't mix it
+with readMessages()/releaseMessages().
+
+With setDispatcher() the messages are not queued but dispatched right
+away on the receive thread, see OSCDispatcher.
+
+*/
 namespace roxlu {
 
+class OSCDispatcher;
+
 class OSCReceiver : public osc::OscPacketListener {
 public:
 
-	OSCReceiver(int port);
+	OSCReceiver(int port, size_t queueSize = 4096);
 	~OSCReceiver();
 	bool hasMessages();
 	bool getNextMessage(OSCMessage* m);
+	size_t readMessages(vector<OSCQueuedMessage*>& result); // valid until releaseMessages()
+	void releaseMessages(); // the messages of the last readMessages() call
+	uint64_t getNumDropped();
+	void setDispatcher(OSCDispatcher* dispatcher); // call before messages arrive, NULL to queue again
 	void ProcessMessage(const osc::ReceivedMessage &m, const IpEndpointName& endpoint);
 	
 private:
 	static void* startThread(void* receiverInstance);
 	void shutdown();
-	void grabMutex();
-	void releaseMutex();
 
 	UdpListeningReceiveSocket* listen_socket;
-	deque<OSCMessage*> messages;
+	OSCMessageQueue queue;
+	OSCDispatcher* volatile dispatcher;
+	size_t num_read;
+	volatile uint64_t num_dropped;
 	int port;
-	bool has_shutdown;
+	volatile bool has_shutdown;
 		
 	#ifdef TARGET_WIN32
 	#else
 		pthread_t thread;
-		pthread_mutex_t mutex;
 	#endif
 	
 
 };
 
+inline bool OSCReceiver::hasMessages() {
+	return !queue.isEmpty();
+}
+
+inline uint64_t OSCReceiver::getNumDropped() {
+	return num_dropped;
+}
+
+inline void OSCReceiver::setDispatcher(OSCDispatcher* d) {
+	dispatcher = d;
+}
+
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -1,62 +1,243 @@
 #include "OSCSender.h"
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <string.h>
+#include <algorithm>
+
+#define OSC_BUNDLE_HEADER_SIZE 16 // "#bundle\0" + time tag
+#define OSC_MAX_UDP_SIZE 65507
+#define OSC_MAX_PENDING_PACKETS 64
 
 namespace roxlu {
 
-OSCSender::OSCSender(const string& hostname, int port) {
+static inline size_t osc_pad4(size_t n) {
+	return (n + 3) & ~3;
+}
+
+OSCSender::OSCSender(const string& hostname, int port) 
+	:num_packets(0)
+	,max_packet_size(1472)
+	,max_pending_packets(OSC_MAX_PENDING_PACKETS)
+	,flush_millis(5)
+	,first_queued(0)
+	,use_sendmmsg(false)
+	,num_sent_packets(0)
+	,num_sent_bytes(0)
+	,num_dropped(0)
+{
 	socket = new UdpTransmitSocket(IpEndpointName( hostname.c_str(), port ) );
+	createStreams();
 }
 
 OSCSender::~OSCSender() {
 	if(socket) {
 		shutdown();
 	}
+	deleteStreams();
 }
 
 void OSCSender::shutdown() {
 	if(!socket) {
 		return;
 	}
+	flush();
 	delete socket;
 	socket = NULL;
 }
 
+void OSCSender::createStreams() {
+	packet_data.resize(max_packet_size * max_pending_packets);
+	for(size_t i = 0; i < max_pending_packets; ++i) {
+		packets.push_back(new osc::OutboundPacketStream(&packet_data[i * max_packet_size], max_packet_size));
+	}
+}
+
+void OSCSender::deleteStreams() {
+	for(size_t i = 0; i < packets.size(); ++i) {
+		delete packets[i];
+	}
+	packets.clear();
+}
+
+void OSCSender::setMaxPacketSize(size_t bytes) {
+	flush();
+	deleteStreams();
+	max_packet_size = std::max<size_t>(bytes, 64);
+	createStreams();
+}
+
+void OSCSender::setUseSendmmsg(bool flag) {
+#if defined(__linux__)
+	flush();
+	use_sendmmsg = flag;
+#else
+	printf("warning: sendmmsg is only available on linux.\n");
+#endif
+}
+
+uint64_t OSCSender::now() {
+	timeval time;
+	gettimeofday(&time, NULL);
+	return uint64_t(time.tv_sec) * 1000 + time.tv_usec / 1000;
+}
+
+// -----------------------------------------------------------------------------
+
 void OSCSender::sendMessage(OSCMessage& msg) {
-	static const int OUTPUT_BUFFER_SIZE = 16384;
-	char buffer[OUTPUT_BUFFER_SIZE];
-	osc::OutboundPacketStream p(buffer, OUTPUT_BUFFER_SIZE);
+	size_t size = OSC_BUNDLE_HEADER_SIZE + getMessageSize(msg);
+	if(size > OSC_MAX_UDP_SIZE) {
+		printf("error: osc message is too big for one packet: %zu\n", size);
+		++num_dropped;
+		return;
+	}
+	if(buffer.size() < size) {
+		buffer.resize(size);
+	}
+	osc::OutboundPacketStream p(&buffer[0], buffer.size());
 	
 	p << osc::BeginBundleImmediate;
 		appendMessage(msg, p);
 	p << osc::EndBundle;
 	
-	socket->Send(p.Data(), p.Size());
+	sendPacket(p.Data(), p.Size());
+}
+
+void OSCSender::queueMessage(OSCMessage& msg) {
+	size_t size = getMessageSize(msg);
+	if(OSC_BUNDLE_HEADER_SIZE + size > max_packet_size) {
+		sendMessage(msg);
+		return;
+	}
+	
+	osc::OutboundPacketStream* p = packets[num_packets];
+	if(p->Size() && p->Size() + size > max_packet_size) {
+		finishPacket();
+		p = packets[num_packets];
+	}
+	if(!p->Size()) {
+		*p << osc::BeginBundleImmediate;
+		first_queued = now();
+	}
+	appendMessage(msg, *p);
+}
+
+void OSCSender::update() {
+	if(packets[num_packets]->Size() && now() - first_queued >= flush_millis) {
+		flush();
+	}
+	else if(num_packets) {
+		sendPackets();
+	}
+}
+
+void OSCSender::flush() {
+	if(packets[num_packets]->Size()) {
+		finishPacket();
+	}
+	sendPackets();
+}
+
+// Closes the current bundle; it's sent right away unless we use sendmmsg.
+void OSCSender::finishPacket() {
+	osc::OutboundPacketStream* p = packets[num_packets];
+	*p << osc::EndBundle;
+	++num_packets;
+	if(!use_sendmmsg || num_packets == packets.size()) {
+		sendPackets();
+	}
+}
+
+void OSCSender::sendPackets() {
+	if(!num_packets) {
+		return;
+	}
+	
+#if defined(__linux__)
+	if(use_sendmmsg) {
+		struct mmsghdr msgs[OSC_MAX_PENDING_PACKETS];
+		struct iovec iovecs[OSC_MAX_PENDING_PACKETS];
+		memset(msgs, 0, sizeof(msgs));
+		for(size_t i = 0; i < num_packets; ++i) {
+			iovecs[i].iov_base = (void*)packets[i]->Data();
+			iovecs[i].iov_len = packets[i]->Size();
+			msgs[i].msg_hdr.msg_iov = &iovecs[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+		}
+		size_t done = 0;
+		while(done < num_packets) {
+			int n = sendmmsg(socket->GetSocketHandle(), msgs + done, num_packets - done, 0);
+			if(n <= 0) {
+				num_dropped += num_packets - done;
+				break;
+			}
+			for(int i = 0; i < n; ++i) {
+				num_sent_bytes += iovecs[done + i].iov_len;
+			}
+			num_sent_packets += n;
+			done += n;
+		}
+		for(size_t i = 0; i < num_packets; ++i) {
+			packets[i]->Clear();
+		}
+		num_packets = 0;
+		return;
+	}
+#endif
 	
+	for(size_t i = 0; i < num_packets; ++i) {
+		sendPacket(packets[i]->Data(), packets[i]->Size());
+		packets[i]->Clear();
+	}
+	num_packets = 0;
+}
+
+void OSCSender::sendPacket(const char* data, size_t size) {
+	if(send(socket->GetSocketHandle(), data, size, 0) < 0) {
+		++num_dropped;
+		return;
+	}
+	++num_sent_packets;
+	num_sent_bytes += size;
+}
+
+// -----------------------------------------------------------------------------
+
+// The size of the message as bundle element (incl. the size prefix).
+size_t OSCSender::getMessageSize(OSCMessage& msg) {
+	size_t size = 4 + osc_pad4(msg.getAddress().size() + 1) + osc_pad4(msg.getNumArgs() + 2);
+	for(OSCMessage::iterator it = msg.begin(); it != msg.end(); ++it) {
+		if((*it)->getType() == OSCARG_TYPE_STRING) {
+			size += osc_pad4(((OSCArgString*)(*it))->get().size() + 1);
+		}
+		else {
+			size += 4;
+		}
+	}
+	return size;
 }
 
 void OSCSender::appendMessage(OSCMessage& msg, osc::OutboundPacketStream& p) {
 	p << osc::BeginMessage(msg.getAddress().c_str());
 
 	OSCMessage::iterator it = msg.begin();
-	int i = 0;
 	while(it != msg.end()) {
-		OSCArg* oscm = (*it);
-		OSCArgType type = oscm->getType();
-		switch(type) {
+		OSCArg* arg = (*it);
+		switch(arg->getType()) {
 			case OSCARG_TYPE_INT32: { 
-				p << msg.getInt32(i);
+				p << ((OSCArgInt32*)arg)->get();
 				break;
 			}
 			case OSCARG_TYPE_FLOAT: {
-				p << msg.getFloat(i);
+				p << ((OSCArgFloat*)arg)->get();
 				break;
 			}
 			case OSCARG_TYPE_STRING: {
-				p << msg.getString(i).c_str();
+				p << ((OSCArgString*)arg)->get().c_str();
 				break;
 			}
 			default:break;
 		}
-		++i;
 		++it;
 	}	
 	
@@ -64,4 +245,4 @@ void OSCSender::appendMessage(OSCMessage& msg, osc::OutboundPacketStream& p) {
 
 }
 
-} // roxlu
\ No newline at end of file
+} // roxlu
@@ -2,6 +2,8 @@
 #define ROXLU_OSC_SENDERH
 
 #include <string>
+#include <vector>
+#include <stdint.h>
 
 #include "OSCMessage.h"
 #include "OscTypes.h"
@@ -9,7 +11,26 @@
 #include "OscOutboundPacketStream.h"
 
 using std::string;
+using std::vector;
 
+/*
+
+sendMessage() sends every message right away in its own packet. When you
+send a lot of messages (e.g. driving LEDs) use queueMessage(): messages
+are packed into bundles of at most max_packet_size bytes (one ethernet
+frame by default). A bundle is sent when the next message doesn't fit,
+when flush() is called, or from update() when the oldest queued message
+is older than the flush time.
+
+With setUseSendmmsg(true) (linux) full bundles are kept until flush() /
+update() or until there are 64 of them, and all are sent with one
+sendmmsg() call.
+
+	sender.queueMessage(msg);
+	...
+	sender.update(); // once per frame
+
+*/
 namespace roxlu {
 
 class OSCSender {
@@ -18,12 +39,59 @@ public:
 	~OSCSender();
 	
 	void sendMessage(OSCMessage& msg);
+	void queueMessage(OSCMessage& msg);
+	void update(); // flushes when needed
+	void flush();
+	
+	void setMaxPacketSize(size_t bytes); // flushes
+	void setFlushMillis(int millis);
+	void setUseSendmmsg(bool flag);
+	
+	uint64_t getNumPackets();
+	uint64_t getNumBytes();
+	uint64_t getNumDropped(); // packets which could not be sent
 	
 private:
 	void shutdown();
 	void appendMessage(OSCMessage& msg, osc::OutboundPacketStream& p);
+	static size_t getMessageSize(OSCMessage& msg); // in a bundle
+	static uint64_t now(); // millis
+	void createStreams();
+	void deleteStreams();
+	void finishPacket();
+	void sendPackets();
+	void sendPacket(const char* data, size_t size);
+	
 	UdpTransmitSocket* socket;
+	vector<char> buffer; // for sendMessage()
+	vector<char> packet_data; // max_pending_packets * max_packet_size
+	vector<osc::OutboundPacketStream*> packets;
+	size_t num_packets; // full bundles waiting to be sent
+	size_t max_packet_size;
+	size_t max_pending_packets;
+	uint64_t flush_millis;
+	uint64_t first_queued; // when the first message of the current bundle was queued
+	bool use_sendmmsg;
+	uint64_t num_sent_packets;
+	uint64_t num_sent_bytes;
+	uint64_t num_dropped;
 };
 
+inline uint64_t OSCSender::getNumPackets() {
+	return num_sent_packets;
+}
+
+inline uint64_t OSCSender::getNumBytes() {
+	return num_sent_bytes;
+}
+
+inline uint64_t OSCSender::getNumDropped() {
+	return num_dropped;
+}
+
+inline void OSCSender::setFlushMillis(int millis) {
+	flush_millis = millis;
+}
+
 } // roxlu
-#endif
\ No newline at end of file
+#endif
@@ -107,6 +107,9 @@ public:
 	void Bind( const IpEndpointName& localEndpoint );
 	bool IsBound() const;
 
+	// the native socket (posix file descriptor), e.g. for sendmmsg()
+	int GetSocketHandle() const;
+
 	int ReceiveFrom( IpEndpointName& remoteEndpoint, char *data, int size );
 };
 
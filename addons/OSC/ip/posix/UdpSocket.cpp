@@ -172,6 +172,8 @@ public:
 		isConnected_ = true;
 	}
 
+	int GetSocketHandle() const { return socket_; }
+
 	void Send( const char *data, int size )
 	{
 		assert( isConnected_ );
@@ -262,6 +264,11 @@ bool UdpSocket::IsBound() const
 	return impl_->IsBound();
 }
 
+int UdpSocket::GetSocketHandle() const
+{
+	return impl_->GetSocketHandle();
+}
+
 int UdpSocket::ReceiveFrom( IpEndpointName& remoteEndpoint, char *data, int size )
 {
 	return impl_->ReceiveFrom( remoteEndpoint, data, size );
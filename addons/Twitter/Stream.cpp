@@ -314,26 +314,38 @@ bool Stream::getLocationsList(string& result) {
 }
 
 
+// The framer only scans the new bytes; the records are parsed straight
+// from its buffer.
 void Stream::parseBuffer() {
-	// after we received the http response
-	std::stringstream ss(buffer);
-	string line;
-	int num_chars = 0;
-	while(std::getline(ss, line, '\r')) {
-		int n = line.size();	
-		if(n == 1) {
-			num_chars += 1;
-			continue;
-		}
-		num_chars += n + 1;		
-		line = Stream::trim(line);
-		twitter.getJSON().parse(line);
+	const char* record = NULL;
+	size_t length = 0;
+	while(framer.next(record, length)) {
+		twitter.getJSON().parse(record, length);
 	}
-	
-	if(num_chars > 0) {
-		buffer.erase(0, num_chars);
+}
+
+void Stream::parseData(const char* data, size_t size) {
+	framer.append(data, size);
+	parseBuffer();
+}
+
+// Replays a capture of the stream (e.g. saved with curl) in chunks like
+// the ones curl gives us; handy to test and profile without twitter.
+bool Stream::replay(const string& filepath, size_t chunkSize) {
+	FILE* fp = fopen(filepath.c_str(), "rb");
+	if(!fp) {
+		printf("Error: cannot open stream capture: %s\n", filepath.c_str());
+		return false;
+	}
+	vector<char> chunk(chunkSize ? chunkSize : 16384);
+	size_t num = 0;
+	while((num = fread(&chunk[0], 1, chunk.size(), fp)) > 0) {
+		parseData(&chunk[0], num);
 	}
+	fclose(fp);
+	return true;
 }
+
 void Stream::addResponseHeader(const string& name, const string& value) {
 	response_headers.insert(std::pair<string, string>(name, value));
 }
@@ -351,8 +363,7 @@ bool Stream::getResponseHeader(const string& name, string& result) {
 
 size_t Stream::curlWriteCallback(char *ptr, size_t size, size_t nmemb, Stream* obj) {
 	size_t bytes_to_write = size * nmemb;
-	obj->buffer.append(ptr, bytes_to_write);
-	obj->parseBuffer();
+	obj->parseData(ptr, bytes_to_write);
 	return bytes_to_write;
 }
 
@@ -18,6 +18,7 @@
 
 #include "Twitter.h"
 #include "IStreamEventListener.h"
+#include "StreamFramer.h"
 
 using std::map;
 using std::vector;
@@ -59,6 +60,8 @@ public:
 	
 	// Callback & helpers
 	static size_t curlWriteCallback(char *ptr, size_t size, size_t nmemb, Stream* obj);
+	void parseData(const char* data, size_t size); // what we do with the data curl gives us
+	bool replay(const string& filepath, size_t chunkSize = 16384); // feeds a captured stream through parseData(), without network
 	void parseBuffer();
 	std::string& trim(std::string &s);
  	std::string& ltrim(std::string &s);
@@ -74,7 +77,7 @@ public:
 	void addEventListener(IStreamEventListener& listener);
 	vector<IStreamEventListener*>& getEventListeners();
 	
-	string buffer;
+	StreamFramer framer;
 
 private:
 	void join(vector<string>& collection, const string& sep, string& result);
@@ -0,0 +1,90 @@
+#include "StreamFramer.h"
+
+namespace roxlu {
+namespace twitter {
+
+StreamFramer::StreamFramer()
+	:used(0)
+	,read_pos(0)
+	,scan_pos(0)
+{
+}
+
+void StreamFramer::clear() {
+	used = 0;
+	read_pos = 0;
+	scan_pos = 0;
+}
+
+// The buffer grows geometrically and is never shrunk, so a steady stream
+// doesn't allocate.
+void StreamFramer::append(const char* data, size_t size) {
+	if(!size) {
+		return;
+	}
+	compact(false);
+	if(used + size > buffer.size()) {
+		compact(true);
+	}
+	if(used + size > buffer.size()) {
+		size_t capacity = buffer.size() ? buffer.size() : 4096;
+		while(capacity < used + size) {
+			capacity *= 2;
+		}
+		buffer.resize(capacity);
+	}
+	memcpy(&buffer[used], data, size);
+	used += size;
+}
+
+bool StreamFramer::next(const char*& record, size_t& length) {
+	while(scan_pos < used) {
+		const char* start = &buffer[0];
+		const char* found = (const char*)memchr(start + scan_pos, '\n', used - scan_pos);
+		if(!found) {
+			scan_pos = used;
+			return false;
+		}
+
+		// trim
+		const char* begin = start + read_pos;
+		const char* end = found;
+		while(begin < end && (*begin == ' ' || *begin == '\t' || *begin == '\r' || *begin == '\n')) {
+			++begin;
+		}
+		while(end > begin && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r')) {
+			--end;
+		}
+
+		read_pos = scan_pos = (found - start) + 1;
+		if(begin != end) {
+			record = begin;
+			length = end - begin;
+			return true;
+		}
+	}
+	return false;
+}
+
+// Everything consumed: just reset. Otherwise we only move the rest to the
+// front when the consumed part is big and more than half of the buffer, or
+// when we would have to grow the buffer; so every byte is moved about once.
+void StreamFramer::compact(bool force) {
+	if(read_pos == used) {
+		clear();
+		return;
+	}
+	if(!read_pos) {
+		return;
+	}
+	if(!force && (read_pos < TWITTER_FRAMER_COMPACT_SIZE || read_pos < used - read_pos)) {
+		return;
+	}
+	size_t num = used - read_pos;
+	memmove(&buffer[0], &buffer[read_pos], num);
+	scan_pos -= read_pos;
+	used = num;
+	read_pos = 0;
+}
+
+}} // roxlu::twitter
@@ -0,0 +1,56 @@
+#ifndef ROXLU_TWITTER_STREAMFRAMERH
+#define ROXLU_TWITTER_STREAMFRAMERH
+
+#include <string.h>
+#include <vector>
+
+using std::vector;
+
+namespace roxlu {
+namespace twitter {
+
+/*
+
+Splits the streaming API data into records ("\r\n" delimited JSON). Only
+the bytes which were appended since the last call are scanned for the
+delimiter, and the records are returned as pointer + length into the
+buffer, so nothing is copied. The consumed bytes are removed only when
+they make up most of the buffer (or when everything is consumed, which
+costs nothing).
+
+	framer.append(data, size);
+	const char* record = NULL;
+	size_t length = 0;
+	while(framer.next(record, length)) {
+		json.parse(record, length); // valid until the next append()
+	}
+
+Records are trimmed; empty records (keep-alive newlines) are skipped.
+
+*/
+
+#define TWITTER_FRAMER_COMPACT_SIZE (64 * 1024) // consumed bytes before we move the rest to the front
+
+class StreamFramer {
+public:
+	StreamFramer();
+	void append(const char* data, size_t size);
+	bool next(const char*& record, size_t& length);
+	void clear();
+	size_t size(); // bytes which are not returned as a record yet
+
+private:
+	void compact(bool force);
+	vector<char> buffer;
+	size_t used; // bytes in buffer
+	size_t read_pos; // start of the next record
+	size_t scan_pos; // bytes before this are scanned and contain no delimiter
+};
+
+inline size_t StreamFramer::size() {
+	return used - read_pos;
+}
+
+}} // roxlu::twitter
+
+#endif
@@ -392,16 +392,17 @@ bool JSON::parseStatusArray(const string& json, vector<rtt::Tweet>& result) {
 
 
 void JSON::parse(const string& line) {
+	parse(line.data(), line.size());
+}
+
+void JSON::parse(const char* data, size_t length) {
 	json_t* root;
 	json_error_t error;
-//	printf("--\n");
-//	printf("%s\n\n---------------------------------------------------------\n", line.c_str());
 
-	// load json into jansson
-	root = json_loads(line.c_str(), 0, &error);
+	// load json into jansson, straight from the stream buffer
+	root = json_loadb(data, length, 0, &error);
 	if(!root) {
 		printf("Error: on line: %d, %s\n", error.line, error.text);
-		json_decref(root);
 		return;
 	}
 	
@@ -449,7 +450,7 @@ void JSON::parse(const string& line) {
 			}
 		}
 	}
-
+	json_decref(root);
 }
 
 }}} // roxlu::twitter::parser
\ No newline at end of file
@@ -35,6 +35,7 @@ public:
 	~JSON();
 	
 	void parse(const string& line);
+	void parse(const char* data, size_t length); // doesn't have to be NUL terminated
 	bool parseStatusArray(const string& json, vector<rtt::Tweet>& result);
 	bool parseStatus(json_t* root, rtt::Tweet& tweet);	
 	bool parseDestroy(json_t* root, rtt::StatusDestroy& destroy);
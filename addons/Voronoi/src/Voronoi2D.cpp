@@ -1,6 +1,52 @@
 #include "Voronoi2D.h"
+#include "Parallel.h"
+#include <string.h>
+
 namespace roxlu {
 
+// Cells of a range of grid blocks; every chunk has its own voro_compute 
+// so chunks can be computed in parallel.
+struct Voronoi2DChunk {
+	Voronoi2DChunk(voro::container_2d& con)
+		:vc(con, con.xperiodic ? 2 * con.nx + 1 : con.nx, con.yperiodic ? 2 * con.ny + 1 : con.ny)
+		,first_block(0)
+		,last_block(0)
+		,first_cell(0)
+		,first_point(0)
+	{
+	}
+	
+	voro::voro_compute_2d<voro::container_2d> vc;
+	voro::voronoicell_2d cell;
+	voro::voronoicell_neighbor_2d neighbor_cell;
+	int first_block;
+	int last_block;
+	uint32_t first_cell; // in the result
+	uint32_t first_point;
+	vector<int> ids;
+	vector<float> sites;
+	vector<uint32_t> counts;
+	vector<float> points;
+	vector<int> neighbors;
+};
+
+struct Voronoi2DTask {
+	Voronoi2D* voro;
+	Voronoi2DCells* result; // NULL: compute, else copy into result
+	bool with_neighbors;
+	
+	void operator()(size_t begin, size_t end) {
+		for(size_t i = begin; i < end; ++i) {
+			if(result == NULL) {
+				voro->computeChunk(*voro->chunks[i], with_neighbors);
+			}
+			else {
+				voro->copyChunk(*voro->chunks[i], *result);
+			}
+		}
+	}
+};
+
 Voronoi2D::Voronoi2D()
 	:vl(NULL)
 	,con(NULL)
@@ -8,6 +54,7 @@ Voronoi2D::Voronoi2D()
 }
 
 Voronoi2D::~Voronoi2D() {
+	deleteChunks();
 	if(vl != NULL) {
 		delete vl;
 	}
@@ -26,9 +73,137 @@ void Voronoi2D::setup(
 		,int numParticlesPerGridCell // how many particles to start per grid
 )
 {
+	deleteChunks();
+	if(vl != NULL) {
+		delete vl;
+		vl = NULL;
+	}
+	if(con != NULL) {
+		delete con;
+	}
 	con = new voro::container_2d(minX, maxX, minY, maxY, numGridsX, numGridsY, false, false, numParticlesPerGridCell);
 }
 
+void Voronoi2D::put(const float* xy, size_t num) {
+	for(size_t i = 0; i < num; ++i) {
+		con->put(i, xy[i * 2], xy[i * 2 + 1]);
+	}
+}
 
+bool Voronoi2D::computeAll(Voronoi2DCells& result, bool withNeighbors, int numThreads) {
+	if(con == NULL) {
+		printf("Voronoi2D: call setup() first.\n");
+		return false;
+	}
+	if(numThreads <= 0) {
+		numThreads = getNumCores();
+	}
+	
+	// a couple of chunks per thread, so a busy part of the grid does
+	// not end up on one thread.
+	int num_chunks = std::min<int>(con->nxy, numThreads * 4);
+	if(num_chunks != (int)chunks.size()) {
+		deleteChunks();
+		for(int i = 0; i < num_chunks; ++i) {
+			Voronoi2DChunk* chunk = new Voronoi2DChunk(*con);
+			chunk->first_block = (con->nxy * i) / num_chunks;
+			chunk->last_block = (con->nxy * (i + 1)) / num_chunks;
+			chunks.push_back(chunk);
+		}
+	}
+	
+	Voronoi2DTask task;
+	task.voro = this;
+	task.result = NULL;
+	task.with_neighbors = withNeighbors;
+	parallelFor(chunks.size(), task, numThreads, 1);
+	
+	uint32_t num_cells = 0;
+	uint32_t num_points = 0;
+	for(size_t i = 0; i < chunks.size(); ++i) {
+		chunks[i]->first_cell = num_cells;
+		chunks[i]->first_point = num_points;
+		num_cells += chunks[i]->ids.size();
+		num_points += chunks[i]->points.size() / 2;
+	}
+	result.ids.resize(num_cells);
+	result.sites.resize(num_cells * 2);
+	result.offsets.resize(num_cells + 1);
+	result.points.resize(num_points * 2);
+	result.neighbors.resize(withNeighbors ? num_points : 0);
+	result.offsets[num_cells] = num_points;
+	
+	task.result = &result;
+	parallelFor(chunks.size(), task, numThreads, 1);
+	return true;
+}
+
+void Voronoi2D::computeChunk(Voronoi2DChunk& chunk, bool withNeighbors) {
+	chunk.ids.clear();
+	chunk.sites.clear();
+	chunk.counts.clear();
+	chunk.points.clear();
+	chunk.neighbors.clear();
+	
+	voro::voronoicell_base_2d& cell = withNeighbors 
+		? static_cast<voro::voronoicell_base_2d&>(chunk.neighbor_cell) 
+		: static_cast<voro::voronoicell_base_2d&>(chunk.cell);
+		
+	for(int ij = chunk.first_block; ij < chunk.last_block; ++ij) {
+		int j = ij / con->nx;
+		int i = ij - j * con->nx;
+		for(int q = 0; q < con->co[ij]; ++q) {
+			bool ok = withNeighbors 
+				? chunk.vc.compute_cell(chunk.neighbor_cell, ij, q, i, j)
+				: chunk.vc.compute_cell(chunk.cell, ij, q, i, j);
+			if(!ok) {
+				continue;
+			}
+			
+			double* pp = con->p[ij] + con->ps * q;
+			chunk.ids.push_back(con->id[ij][q]);
+			chunk.sites.push_back(pp[0]);
+			chunk.sites.push_back(pp[1]);
+			
+			uint32_t n = 0;
+			int v = 0;
+			do {
+				chunk.points.push_back(pp[0] + 0.5 * cell.pts[2 * v]);
+				chunk.points.push_back(pp[1] + 0.5 * cell.pts[2 * v + 1]);
+				if(withNeighbors) {
+					chunk.neighbors.push_back(chunk.neighbor_cell.ne[v]);
+				}
+				v = cell.ed[2 * v];
+				++n;
+			} while(v != 0);
+			chunk.counts.push_back(n);
+		}
+	}
+}
+
+void Voronoi2D::copyChunk(Voronoi2DChunk& chunk, Voronoi2DCells& result) {
+	size_t num_cells = chunk.ids.size();
+	if(num_cells == 0) {
+		return;
+	}
+	memcpy(&result.ids[chunk.first_cell], &chunk.ids[0], num_cells * sizeof(int));
+	memcpy(&result.sites[chunk.first_cell * 2], &chunk.sites[0], num_cells * 2 * sizeof(float));
+	memcpy(&result.points[chunk.first_point * 2], &chunk.points[0], chunk.points.size() * sizeof(float));
+	if(!chunk.neighbors.empty()) {
+		memcpy(&result.neighbors[chunk.first_point], &chunk.neighbors[0], chunk.neighbors.size() * sizeof(int));
+	}
+	uint32_t offset = chunk.first_point;
+	for(size_t i = 0; i < num_cells; ++i) {
+		result.offsets[chunk.first_cell + i] = offset;
+		offset += chunk.counts[i];
+	}
+}
+
+void Voronoi2D::deleteChunks() {
+	for(size_t i = 0; i < chunks.size(); ++i) {
+		delete chunks[i];
+	}
+	chunks.clear();
+}
 
-} // roxlu
\ No newline at end of file
+} // roxlu
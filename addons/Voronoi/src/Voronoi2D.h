@@ -12,10 +12,37 @@
 #include "../lib/wall_2d.hh"
 #include "../lib/cell_nc_2d.hh"
 #include "../lib/ctr_boundary_2d.hh"
+#include <vector>
+#include <stdint.h>
+
+using std::vector;
 
 	
 namespace roxlu {
 
+/**
+ * All cells of a diagram in flat arrays, see Voronoi2D::computeAll().
+ * Cell i has the vertices [offsets[i], offsets[i+1]); for each vertex 
+ * k we store the point (points[k*2], points[k*2+1]) and in neighbors[k]
+ * the id of the cell on the other side of the edge which starts at this
+ * vertex (a negative value for the walls of the container).
+ *
+ */
+struct Voronoi2DCells {
+	inline size_t size();
+	vector<int> ids; // particle id per cell
+	vector<float> sites; // particle position per cell (x,y)
+	vector<uint32_t> offsets; // num cells + 1
+	vector<float> points; // cell vertices (x,y)
+	vector<int> neighbors; // per cell vertex, empty when not requested
+};
+
+inline size_t Voronoi2DCells::size() {
+	return ids.size();
+}
+
+struct Voronoi2DChunk;
+
 /**
  * Minimalistic wrapper around Voro++2D create by
  * Chris H. Rycroft (LBL / UC Berkeley). See http://math.lbl.gov/voro++/
@@ -75,6 +102,8 @@ public:
 	);
 	void clear();
 	void put(int i, double x, double y);
+	void put(const float* xy, size_t num); // ids 0...num-1
+	bool computeAll(Voronoi2DCells& result, bool withNeighbors = true, int numThreads = 0);
 	bool start();
 	bool next();
 	int computeCell();	
@@ -87,16 +116,23 @@ public:
 	voro::c_loop_all_2d* vl;
 	voro::voronoicell_2d c;
 	int k;
+	
+private:
+	friend struct Voronoi2DTask;
+	void computeChunk(Voronoi2DChunk& chunk, bool withNeighbors);
+	void copyChunk(Voronoi2DChunk& chunk, Voronoi2DCells& result);
+	void deleteChunks();
+	vector<Voronoi2DChunk*> chunks;
 };
 
 inline void Voronoi2D::clear() {
-	voro::container_2d* curr = con;
 	if(vl != NULL) {
 		delete vl;
 		vl = NULL;
 	}
-	con = new voro::container_2d(curr->ax, curr->bx, curr->ay, curr->by, curr->nx, curr->ny, false, false, curr->ps);
-	delete curr;
+	if(con != NULL) {
+		con->clear();
+	}
 }
 
 inline void Voronoi2D::put(int i, double x, double y) {
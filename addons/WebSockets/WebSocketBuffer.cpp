@@ -0,0 +1,44 @@
+#include "WebSocketBuffer.h"
+#include <stdio.h>
+#include <string.h>
+
+namespace roxlu {
+
+WebSocketBuffer::WebSocketBuffer(size_t size, bool binary)
+	:data(NULL)
+	,size(size)
+	,binary(binary)
+	,refcount(1)
+{
+	data = (unsigned char*)malloc(LWS_SEND_BUFFER_PRE_PADDING + size + LWS_SEND_BUFFER_POST_PADDING);
+}
+
+WebSocketBuffer::~WebSocketBuffer() {
+	free(data);
+}
+
+WebSocketBuffer* WebSocketBuffer::create(size_t size, bool binary) {
+	WebSocketBuffer* buf = new WebSocketBuffer(size, binary);
+	if(!buf->data) {
+		printf("Error: cannot allocate a websocket buffer of %zu bytes.\n", size);
+		delete buf;
+		return NULL;
+	}
+	return buf;
+}
+
+WebSocketBuffer* WebSocketBuffer::create(const void* bytes, size_t size, bool binary) {
+	WebSocketBuffer* buf = create(size, binary);
+	if(buf && size) {
+		memcpy(buf->getPayload(), bytes, size);
+	}
+	return buf;
+}
+
+void WebSocketBuffer::release() {
+	if(__sync_sub_and_fetch(&refcount, 1) == 0) {
+		delete this;
+	}
+}
+
+} // roxlu
@@ -0,0 +1,63 @@
+#ifndef ROXLU_WEBSOCKET_BUFFERH
+#define ROXLU_WEBSOCKET_BUFFERH
+
+#include <stdlib.h>
+
+extern "C" {
+	#include "libwebsockets.h"
+}
+
+namespace roxlu {
+
+/*
+
+A refcounted websocket frame with the padding libwebsockets needs before
+and after the payload, so the payload is written once and can be queued on
+any number of connections without copying.
+
+	WebSocketBuffer* buf = WebSocketBuffer::create(size, true);
+	memcpy(buf->getPayload(), frame, size);
+	protocol.broadcast(buf);
+	buf->release();
+
+*/
+class WebSocketBuffer {
+public:
+	static WebSocketBuffer* create(size_t size, bool binary);
+	static WebSocketBuffer* create(const void* data, size_t size, bool binary);
+	void retain();
+	void release(); // deletes the buffer when nobody uses it anymore
+	unsigned char* getPayload();
+	size_t getSize();
+	enum libwebsocket_write_protocol getWriteProtocol();
+
+private:
+	WebSocketBuffer(size_t size, bool binary);
+	~WebSocketBuffer();
+	WebSocketBuffer(const WebSocketBuffer& other);
+	WebSocketBuffer& operator=(const WebSocketBuffer& other);
+
+	unsigned char* data;
+	size_t size;
+	bool binary;
+	volatile int refcount;
+};
+
+inline void WebSocketBuffer::retain() {
+	__sync_add_and_fetch(&refcount, 1);
+}
+
+inline unsigned char* WebSocketBuffer::getPayload() {
+	return data + LWS_SEND_BUFFER_PRE_PADDING;
+}
+
+inline size_t WebSocketBuffer::getSize() {
+	return size;
+}
+
+inline enum libwebsocket_write_protocol WebSocketBuffer::getWriteProtocol() {
+	return binary ? LWS_WRITE_BINARY : LWS_WRITE_TEXT;
+}
+
+} // roxlu
+#endif
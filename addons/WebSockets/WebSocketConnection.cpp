@@ -4,33 +4,156 @@
 
 namespace roxlu {
 
-// TODO: implement binary
 WebSocketConnection::WebSocketConnection(WebSockets* websockets, WebSocketProtocol* protocol)
 	:websockets(websockets)
 	,protocol(protocol)
 	,ws(NULL)
-	,buffer(LWS_SEND_BUFFER_PRE_PADDING+1024+LWS_SEND_BUFFER_POST_PADDING)
+	,protocol_index(0)
+	,queued_bytes(0)
+	,num_dropped(0)
+	,writeable_requested(false)
+	,must_close(false)
+	,closed(false)
+	,refcount(1)
 {
 }
 
 WebSocketConnection::~WebSocketConnection() {
+	while(queue.size()) {
+		popFront();
+	}
 }
 
 void WebSocketConnection::close() {
 	websockets->close(this);
 }
 
-void WebSocketConnection::send(const string& msg) {
-	int n = 0;
-	unsigned char* p = &buffer[LWS_SEND_BUFFER_PRE_PADDING];
-	memcpy(p, msg.c_str(), msg.size());
-	
-	n = libwebsocket_write(ws, p, msg.size(), LWS_WRITE_TEXT);
-	if(n < 0) {
-		printf("Error: cannot write to socket.\n");
+// Called after LWS_CALLBACK_CLOSED; the queued frames are dropped.
+void WebSocketConnection::onClosed() {
+	closed = true;
+	ws = NULL;
+	while(queue.size()) {
+		popFront();
+	}
+}
+
+bool WebSocketConnection::send(const string& msg) {
+	WebSocketBuffer* buf = WebSocketBuffer::create(msg.data(), msg.size(), false);
+	if(!buf) {
+		return false;
+	}
+	bool result = send(buf);
+	buf->release();
+	return result;
+}
+
+bool WebSocketConnection::sendBinary(const void* data, size_t size) {
+	WebSocketBuffer* buf = WebSocketBuffer::create(data, size, true);
+	if(!buf) {
+		return false;
+	}
+	bool result = send(buf);
+	buf->release();
+	return result;
+}
+
+bool WebSocketConnection::send(WebSocketBuffer* buffer) {
+	if(!buffer || closed) {
+		return false;
+	}
+	if(websockets->mustPost()) {
+		websockets->post(WS_EVENT_SEND, this, protocol, buffer);
+		return true;
 	}
+	return queueFrame(buffer, WebSockets::now());
 }
 
+// When the client doesn't keep up we apply the backpressure policy of the
+// protocol. A single frame which is bigger than the byte limit is still
+// queued when the queue is empty.
+bool WebSocketConnection::queueFrame(WebSocketBuffer* buffer, uint64_t queuedAt) {
+	if(must_close || closed) {
+		return false;
+	}
+	size_t max_bytes = protocol->getMaxQueuedBytes();
+	size_t max_messages = protocol->getMaxQueuedMessages();
+	size_t size = buffer->getSize();
+	if(queue.size() && (queue.size() >= max_messages || queued_bytes + size > max_bytes)) {
+		switch(protocol->getBackpressure()) {
+			case WS_BACKPRESSURE_DROP_NEWEST: {
+				++num_dropped;
+				return false;
+			}
+			case WS_BACKPRESSURE_DROP_OLDEST: {
+				while(queue.size() && (queue.size() >= max_messages || queued_bytes + size > max_bytes)) {
+					popFront();
+					++num_dropped;
+				}
+				break;
+			}
+			case WS_BACKPRESSURE_CLOSE: {
+				// closed from the writeable callback; closing here would remove
+				// the connection while a broadcast iterates over them
+				num_dropped += queue.size() + 1;
+				while(queue.size()) {
+					popFront();
+				}
+				must_close = true;
+				requestWriteable();
+				return false;
+			}
+			default: break;
+		}
+	}
+	buffer->retain();
+	WebSocketFrame frame;
+	frame.buffer = buffer;
+	frame.queued_at = queuedAt;
+	queue.push_back(frame);
+	queued_bytes += size;
+	requestWriteable();
+	return true;
+}
+
+// Writes whole frames as long as the socket can take them; a frame is
+// never split so the payload of a shared buffer is never touched.
+bool WebSocketConnection::onWriteable() {
+	writeable_requested = false;
+	if(must_close) {
+		return false;
+	}
+	while(queue.size()) {
+		if(lws_send_pipe_choked(ws)) {
+			requestWriteable();
+			break;
+		}
+		WebSocketFrame& frame = queue.front();
+		WebSocketBuffer* buf = frame.buffer;
+		int n = libwebsocket_write(ws, buf->getPayload(), buf->getSize(), buf->getWriteProtocol());
+		websockets->onFrameWritten(frame.queued_at);
+		popFront();
+		if(n < 0) {
+			printf("Error: cannot write to socket.\n");
+			return false;
+		}
+	}
+	return true;
+}
+
+void WebSocketConnection::requestWriteable() {
+	if(writeable_requested || ws == NULL) {
+		return;
+	}
+	writeable_requested = true;
+	libwebsocket_callback_on_writable(websockets->ws_context, ws);
+}
+
+void WebSocketConnection::popFront() {
+	WebSocketBuffer* buf = queue.front().buffer;
+	queued_bytes -= buf->getSize();
+	queue.pop_front();
+	buf->release();
+}
 
 const string WebSocketConnection::receive(const string& msg) {
 	// TODO: handle binary
@@ -5,31 +5,106 @@ extern "C" {
 	#include "libwebsockets.h"
 }
 
+#include <stdint.h>
 #include <string>
-#include <vector>
+#include <deque>
+#include "WebSocketBuffer.h"
 
 using std::string;
-using std::vector;
+using std::deque;
 
 namespace roxlu {
 
 class WebSockets;
 class WebSocketProtocol;
 
+/*
+
+Messages are not written right away but queued; they're written when the
+socket is writeable (LWS_CALLBACK_SERVER_WRITEABLE), as many as the socket
+accepts. The queue is limited per connection, see
+WebSocketProtocol::setSendLimits() for what happens with slow clients.
+
+When WebSockets runs its own thread, send() and close() can be called from
+any thread; they're passed to the service thread. The connection is
+refcounted so it stays valid until every queued event which uses it is
+handled.
+
+*/
+
+// A queued frame; queued_at is used for the outgoing latency.
+struct WebSocketFrame {
+	WebSocketBuffer* buffer;
+	uint64_t queued_at; // micros
+};
 class WebSocketConnection {
 public:
 	WebSocketConnection(WebSockets* websockets, WebSocketProtocol* protocol);
-	~WebSocketConnection();
-	
+	void retain();
+	void release(); // deletes the connection when nobody uses it anymore
+
 	void close();
-	void send(const string& msg);
+	bool send(const string& msg); // text frame
+	bool sendBinary(const void* data, size_t size);
+	bool send(WebSocketBuffer* buffer); // the connection retains the buffer
 	const string receive(const string& msg);
-	
+
+	size_t getNumQueued();
+	size_t getQueuedBytes();
+	uint64_t getNumDropped();
+	bool isClosed();
+
+	// service thread only
+	bool queueFrame(WebSocketBuffer* buffer, uint64_t queuedAt);
+	bool onWriteable(); // writes the queued frames; false when the socket failed
+	void onClosed();
+
 	struct libwebsocket* ws;
 	WebSockets* websockets;
 	WebSocketProtocol* protocol;
-	vector<unsigned char> buffer;
+	size_t protocol_index; // in WebSocketProtocol::connections
+
+private:
+	~WebSocketConnection();
+	WebSocketConnection(const WebSocketConnection& other);
+	WebSocketConnection& operator=(const WebSocketConnection& other);
+	void requestWriteable();
+	void popFront();
+
+	deque<WebSocketFrame> queue;
+	size_t queued_bytes;
+	uint64_t num_dropped;
+	bool writeable_requested;
+	bool must_close; // set by WS_BACKPRESSURE_CLOSE
+	volatile bool closed;
+	volatile int refcount;
 };
 
+inline void WebSocketConnection::retain() {
+	__sync_add_and_fetch(&refcount, 1);
+}
+
+inline void WebSocketConnection::release() {
+	if(__sync_sub_and_fetch(&refcount, 1) == 0) {
+		delete this;
+	}
+}
+
+inline bool WebSocketConnection::isClosed() {
+	return closed;
+}
+
+inline size_t WebSocketConnection::getNumQueued() {
+	return queue.size();
+}
+
+inline size_t WebSocketConnection::getQueuedBytes() {
+	return queued_bytes;
+}
+
+inline uint64_t WebSocketConnection::getNumDropped() {
+	return num_dropped;
+}
+
 } // roxlu
-#endif
\ No newline at end of file
+#endif
@@ -5,22 +5,79 @@ namespace roxlu {
 
 WebSocketProtocol::WebSocketProtocol()
 	:websockets(NULL) 
+	,protocol_dx(0)
+	,max_queued_bytes(4 * 1024 * 1024)
+	,max_queued_messages(256)
+	,backpressure(WS_BACKPRESSURE_DROP_OLDEST)
 {
+	pthread_mutexattr_t attr;
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&connections_mutex, &attr);
+	pthread_mutexattr_destroy(&attr);
 }
 
 WebSocketProtocol::~WebSocketProtocol() {
 	printf("~WebSocketProtocol\n");
+	pthread_mutex_destroy(&connections_mutex);
 }
 
 
 void WebSocketProtocol::broadcast(const string& msg) {
-	string buf(LWS_SEND_BUFFER_PRE_PADDING+1024+LWS_SEND_BUFFER_POST_PADDING, 0);
-	unsigned char* p = (unsigned char*)&buf[LWS_SEND_BUFFER_PRE_PADDING];
-	memcpy(p, msg.c_str(), msg.size());
-	int n = libwebsockets_broadcast(&websockets->ws_protocols[protocol_dx], p, msg.size());
-	if(n < 0) {
-		printf("Error: cannot broadcast.\n");
+	WebSocketBuffer* buf = WebSocketBuffer::create(msg.data(), msg.size(), false);
+	if(!buf) {
+		return;
 	}
+	broadcast(buf);
+	buf->release();
+}
+
+void WebSocketProtocol::broadcastBinary(const void* data, size_t size) {
+	WebSocketBuffer* buf = WebSocketBuffer::create(data, size, true);
+	if(!buf) {
+		return;
+	}
+	broadcast(buf);
+	buf->release();
+}
+
+void WebSocketProtocol::broadcast(WebSocketBuffer* buffer) {
+	if(websockets->mustPost()) {
+		websockets->post(WS_EVENT_SEND_ALL, NULL, this, buffer);
+		return;
+	}
+	queueFrameOnAll(buffer, WebSockets::now());
+}
+
+// Only the thread which changes the list gets here, so no lock needed.
+void WebSocketProtocol::queueFrameOnAll(WebSocketBuffer* buffer, uint64_t queuedAt) {
+	for(size_t i = 0; i < connections.size(); ++i) {
+		connections[i]->queueFrame(buffer, queuedAt);
+	}
+}
+
+void WebSocketProtocol::setSendLimits(size_t maxQueuedBytes, size_t maxQueuedMessages, WebSocketBackpressure policy) {
+	max_queued_bytes = maxQueuedBytes;
+	max_queued_messages = maxQueuedMessages;
+	backpressure = policy;
+}
+
+void WebSocketProtocol::addConnection(WebSocketConnection* conn) {
+	pthread_mutex_lock(&connections_mutex);
+	conn->protocol_index = connections.size();
+	connections.push_back(conn);
+	pthread_mutex_unlock(&connections_mutex);
+}
+
+void WebSocketProtocol::removeConnection(WebSocketConnection* conn) {
+	pthread_mutex_lock(&connections_mutex);
+	size_t dx = conn->protocol_index;
+	if(dx < connections.size() && connections[dx] == conn) {
+		connections[dx] = connections.back();
+		connections[dx]->protocol_index = dx;
+		connections.pop_back();
+	}
+	pthread_mutex_unlock(&connections_mutex);
 }
 
 } // roxlu
\ No newline at end of file
@@ -3,14 +3,59 @@
 
 #include "libwebsockets.h"
 #include <string>
+#include <vector>
+#include <pthread.h>
 #include "WebSocketConnection.h"
+#include "WebSocketBuffer.h"
 
 using std::string;
+using std::vector;
 
 namespace roxlu {
 
 class WebSockets;
 
+// What happens when a client doesn't read fast enough and its send queue
+// reaches the limits set with WebSocketProtocol::setSendLimits().
+enum WebSocketBackpressure {
+	 WS_BACKPRESSURE_DROP_OLDEST // good for streams where only the latest frame matters
+	,WS_BACKPRESSURE_DROP_NEWEST
+	,WS_BACKPRESSURE_CLOSE
+};
+
+/*
+
+Broadcasting:
+-------------
+broadcast() writes the payload once into a WebSocketBuffer which is queued
+on every connection of the protocol, so the payload is not copied per
+client. To avoid even the one copy, fill the buffer yourself:
+
+	WebSocketBuffer* buf = WebSocketBuffer::create(num_bytes, true);
+	sensor.read(buf->getPayload(), num_bytes);
+	protocol.broadcast(buf);
+	buf->release();
+
+Note: onBroadcast() is only called for messages sent with
+libwebsockets_broadcast(), not for broadcast().
+
+Connections:
+------------
+When WebSockets runs its service thread the connection list is changed
+on that thread. Lock it while you iterate over it from another thread;
+connections are not added or removed (nor deleted) while it's locked:
+
+	protocol.lockConnections();
+	for(size_t i = 0; i < protocol.getNumConnections(); ++i) {
+		WebSocketConnection* conn = protocol.getConnection(i);
+		...
+	}
+	protocol.unlockConnections();
+
+The lock is recursive, so getNumConnections() can be used inside it.
+
+*/
+
 class WebSocketProtocol {
 
 public:
@@ -21,7 +66,19 @@ public:
 	string getName();
 	void setProtocolIndex(const unsigned int dx);
 	unsigned int getProtocolIndex();
-	void broadcast(const string& msg);
+	void broadcast(const string& msg); // text frame
+	void broadcastBinary(const void* data, size_t size);
+	void broadcast(WebSocketBuffer* buffer); // retained by every connection
+	void setSendLimits(size_t maxQueuedBytes, size_t maxQueuedMessages, WebSocketBackpressure policy);
+	size_t getMaxQueuedBytes();
+	size_t getMaxQueuedMessages();
+	WebSocketBackpressure getBackpressure();
+	size_t getNumConnections();
+	WebSocketConnection* getConnection(size_t dx); // see lockConnections()
+	void lockConnections();
+	void unlockConnections();
+	void addConnection(WebSocketConnection* conn);
+	void removeConnection(WebSocketConnection* conn);
 
 	virtual void onOpen(string& msg, WebSocketConnection& conn) {};
 	virtual void onClose(string& msg, WebSocketConnection& conn) {};
@@ -33,10 +90,16 @@ public:
 	WebSockets* websockets;
 
 private:
-	
+	friend class WebSockets;
+	void queueFrameOnAll(WebSocketBuffer* buffer, uint64_t queuedAt); // on the service thread, or when not threaded
+
 	unsigned int protocol_dx;
 	string name;
-	
+	vector<WebSocketConnection*> connections;
+	pthread_mutex_t connections_mutex; // changes and reads from other threads
+	size_t max_queued_bytes;
+	size_t max_queued_messages;
+	WebSocketBackpressure backpressure;
 };
 
 inline void WebSocketProtocol::setName(const string& n) {
@@ -55,6 +118,37 @@ inline unsigned int WebSocketProtocol::getProtocolIndex() {
 	return protocol_dx;
 }
 
+inline size_t WebSocketProtocol::getMaxQueuedBytes() {
+	return max_queued_bytes;
+}
+
+inline size_t WebSocketProtocol::getMaxQueuedMessages() {
+	return max_queued_messages;
+}
+
+inline WebSocketBackpressure WebSocketProtocol::getBackpressure() {
+	return backpressure;
+}
+
+inline size_t WebSocketProtocol::getNumConnections() {
+	pthread_mutex_lock(&connections_mutex);
+	size_t num = connections.size();
+	pthread_mutex_unlock(&connections_mutex);
+	return num;
+}
+
+inline WebSocketConnection* WebSocketProtocol::getConnection(size_t dx) {
+	return connections[dx];
+}
+
+inline void WebSocketProtocol::lockConnections() {
+	pthread_mutex_lock(&connections_mutex);
+}
+
+inline void WebSocketProtocol::unlockConnections() {
+	pthread_mutex_unlock(&connections_mutex);
+}
+
 
 
 } // roxlu
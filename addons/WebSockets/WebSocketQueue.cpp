@@ -0,0 +1,135 @@
+#include "WebSocketQueue.h"
+#include "WebSocketConnection.h"
+#include "WebSocketBuffer.h"
+#include <string.h>
+
+namespace roxlu {
+
+WebSocketEvent::WebSocketEvent(int type, WebSocketConnection* conn, WebSocketProtocol* protocol, WebSocketBuffer* buffer)
+	:type(type)
+	,conn(conn)
+	,protocol(protocol)
+	,buffer(buffer)
+	,time(0)
+	,next(NULL)
+{
+	if(conn) {
+		conn->retain();
+	}
+	if(buffer) {
+		buffer->retain();
+	}
+}
+
+WebSocketEvent::~WebSocketEvent() {
+	if(conn) {
+		conn->release();
+	}
+	if(buffer) {
+		buffer->release();
+	}
+}
+
+// -----------------------------------------------------------------------------
+
+WebSocketQueue::WebSocketQueue()
+	:head(&stub)
+	,tail(&stub)
+	,stub(-1, NULL, NULL, NULL)
+	,num_queued(0)
+{
+}
+
+WebSocketQueue::~WebSocketQueue() {
+	WebSocketEvent* ev = NULL;
+	while((ev = pop())) {
+		delete ev;
+	}
+}
+
+void WebSocketQueue::push(WebSocketEvent* ev) {
+	__sync_fetch_and_add(&num_queued, 1);
+	pushNode(ev);
+}
+
+void WebSocketQueue::pushNode(WebSocketEvent* ev) {
+	ev->next = NULL;
+	__sync_synchronize();
+	WebSocketEvent* prev = __sync_lock_test_and_set(&head, ev);
+	prev->next = ev;
+}
+
+WebSocketEvent* WebSocketQueue::pop() {
+	WebSocketEvent* t = tail;
+	WebSocketEvent* next = t->next;
+	if(t == &stub) {
+		if(!next) {
+			return NULL;
+		}
+		tail = next;
+		t = next;
+		next = next->next;
+	}
+	if(!next) {
+		if(t != head) {
+			return NULL;
+		}
+		pushNode(&stub);
+		next = t->next;
+		if(!next) {
+			return NULL;
+		}
+	}
+	__sync_synchronize();
+	tail = next;
+	__sync_fetch_and_sub(&num_queued, 1);
+	return t;
+}
+
+// -----------------------------------------------------------------------------
+
+WebSocketHistogram::WebSocketHistogram() {
+	reset();
+}
+
+void WebSocketHistogram::reset() {
+	memset(buckets, 0, sizeof(buckets));
+	count = 0;
+	sum = 0;
+	max = 0;
+}
+
+void WebSocketHistogram::add(uint64_t value) {
+	int dx = (value) ? 64 - __builtin_clzll(value) : 0;
+	if(dx >= WS_HISTOGRAM_BUCKETS) {
+		dx = WS_HISTOGRAM_BUCKETS - 1;
+	}
+	++buckets[dx];
+	++count;
+	sum += value;
+	if(value > max) {
+		max = value;
+	}
+}
+
+uint64_t WebSocketHistogram::getPercentile(double percent) const {
+	if(!count) {
+		return 0;
+	}
+	uint64_t needed = (uint64_t)(count * percent / 100.0 + 0.5);
+	uint64_t total = 0;
+	for(int i = 0; i < WS_HISTOGRAM_BUCKETS; ++i) {
+		total += buckets[i];
+		if(total >= needed && total) {
+			uint64_t upper = (uint64_t(1) << i) - 1;
+			return (upper < max) ? upper : max;
+		}
+	}
+	return max;
+}
+
+double WebSocketHistogram::getAverage() const {
+	return (count) ? double(sum) / count : 0.0;
+}
+
+} // roxlu
@@ -0,0 +1,93 @@
+#ifndef ROXLU_WEBSOCKET_QUEUEH
+#define ROXLU_WEBSOCKET_QUEUEH
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define WS_HISTOGRAM_BUCKETS 32
+
+namespace roxlu {
+
+class WebSocketConnection;
+class WebSocketProtocol;
+class WebSocketBuffer;
+
+/*
+
+Messages between the service thread of WebSockets and the app, see
+WebSockets::startThread(). Events from the service thread to the app:
+WS_EVENT_OPEN, WS_EVENT_CLOSE, WS_EVENT_MESSAGE and WS_EVENT_BROADCAST.
+Commands from the app to the service thread: WS_EVENT_SEND,
+WS_EVENT_SEND_ALL and WS_EVENT_CLOSE_CONNECTION.
+
+*/
+
+enum WebSocketEventTypes {
+	 WS_EVENT_OPEN
+	,WS_EVENT_CLOSE
+	,WS_EVENT_MESSAGE
+	,WS_EVENT_BROADCAST // LWS_CALLBACK_BROADCAST
+	,WS_EVENT_SEND
+	,WS_EVENT_SEND_ALL // WebSocketProtocol::broadcast()
+	,WS_EVENT_CLOSE_CONNECTION
+};
+
+// The event holds a reference to the connection and buffer.
+struct WebSocketEvent {
+	WebSocketEvent(int type, WebSocketConnection* conn, WebSocketProtocol* protocol, WebSocketBuffer* buffer);
+	~WebSocketEvent();
+	int type;
+	WebSocketConnection* conn;
+	WebSocketProtocol* protocol;
+	WebSocketBuffer* buffer;
+	uint64_t time; // micros, when queued
+	WebSocketEvent* volatile next;
+};
+
+// Intrusive mpsc queue (Dmitry Vyukov), any thread can push, one thread pops.
+class WebSocketQueue {
+public:
+	WebSocketQueue();
+	~WebSocketQueue(); // deletes the events which are left
+	void push(WebSocketEvent* ev);
+	WebSocketEvent* pop(); // NULL when empty, or when a producer is between its exchange and setting `next`
+	size_t size(); // approximate
+
+private:
+	void pushNode(WebSocketEvent* ev);
+	WebSocketEvent* volatile head;
+	WebSocketEvent* tail;
+	WebSocketEvent stub;
+	volatile size_t num_queued;
+};
+
+inline size_t WebSocketQueue::size() {
+	return num_queued;
+}
+
+// Power of two buckets; bucket i counts the values < 2^i (and >= 2^(i-1)).
+struct WebSocketHistogram {
+	WebSocketHistogram();
+	void add(uint64_t value);
+	uint64_t getPercentile(double percent) const; // upper bound of the bucket, e.g. getPercentile(99)
+	double getAverage() const;
+	void reset();
+	uint64_t buckets[WS_HISTOGRAM_BUCKETS];
+	uint64_t count;
+	uint64_t sum;
+	uint64_t max;
+};
+
+// The incoming histograms are written by the thread which calls
+// WebSockets::update(), the outgoing ones by the service thread.
+struct WebSocketStats {
+	WebSocketHistogram incoming_depth; // events waiting for update(), sampled by update()
+	WebSocketHistogram incoming_latency; // micros from receiving to calling the protocol
+	WebSocketHistogram outgoing_depth; // commands waiting for the service thread, sampled when it wakes up
+	WebSocketHistogram outgoing_latency; // micros from send() / broadcast() to writing the frame
+	size_t num_incoming; // queued right now
+	size_t num_outgoing;
+};
+
+} // roxlu
+#endif
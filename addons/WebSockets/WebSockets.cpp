@@ -1,4 +1,8 @@
 #include "WebSockets.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
 
 namespace roxlu {
 
@@ -6,11 +10,20 @@ WebSockets* WebSockets::instance = NULL;
 
 WebSockets::WebSockets() 
 	:ws_context(NULL)
+	,running(false)
+	,threaded(false)
+	,poll_timeout(100)
+	,wake_pending(0)
 {
 	WebSockets::instance = this;
+	wake_pipe[0] = wake_pipe[1] = -1;
+	struct pollfd wake_fd = {-1, POLLIN, 0};
+	poll_fds.push_back(wake_fd);
+	memset(&thread, 0, sizeof(thread));
 }
 
 WebSockets::~WebSockets() {
+	stopThread();
 	if(ws_context != NULL) {
 		libwebsocket_context_destroy(ws_context);
 	}
@@ -25,7 +38,7 @@ void WebSockets::start(const unsigned int port) {
 		struct libwebsocket_protocols wsp = {	
 							 p.second->getName().c_str()
 							,ws_callback
-							,sizeof(WebSocketConnection)
+							,sizeof(WebSocketConnection*)
 		};
 		ws_protocols.push_back(wsp);
 		++it;
@@ -51,8 +64,267 @@ void WebSockets::start(const unsigned int port) {
 }
 
 
+// Dispatches the events from the service thread; when we're not threaded
+// there are only events left from a stopped service thread.
 void WebSockets::update() {
-	libwebsocket_service(ws_context,1);
+	size_t depth = incoming.size();
+	if(depth) {
+		stats.incoming_depth.add(depth);
+	}
+	WebSocketEvent* ev = NULL;
+	while((ev = incoming.pop())) {
+		stats.incoming_latency.add(now() - ev->time);
+		dispatchEvent(ev);
+		delete ev;
+	}
+	if(!threaded) {
+		libwebsocket_service(ws_context,1);
+	}
+}
+
+// Service thread
+// -----------------------------------------------------------------------------
+bool WebSockets::startThread(int pollTimeoutMillis) {
+	if(threaded) {
+		return true;
+	}
+	if(ws_context == NULL) {
+		printf("WebSockets: call start() before startThread().\n");
+		return false;
+	}
+	if(pipe(wake_pipe) != 0) {
+		printf("WebSockets: cannot create the wake-up pipe.\n");
+		return false;
+	}
+	fcntl(wake_pipe[0], F_SETFL, fcntl(wake_pipe[0], F_GETFL) | O_NONBLOCK);
+	fcntl(wake_pipe[1], F_SETFL, fcntl(wake_pipe[1], F_GETFL) | O_NONBLOCK);
+	poll_fds[0].fd = wake_pipe[0];
+	poll_timeout = pollTimeoutMillis;
+	wake_pending = 0;
+
+	// threaded is set first so sends from this thread are queued from now on
+	running = true;
+	threaded = true;
+	__sync_synchronize();
+	if(pthread_create(&thread, NULL, &WebSockets::threadFunction, this) != 0) {
+		printf("WebSockets: cannot create thread.\n");
+		running = false;
+		threaded = false;
+		::close(wake_pipe[0]);
+		::close(wake_pipe[1]);
+		wake_pipe[0] = wake_pipe[1] = -1;
+		poll_fds[0].fd = -1;
+		return false;
+	}
+	return true;
+}
+
+// The commands which are still queued are executed; the frames are
+// written by update() from now on.
+void WebSockets::stopThread() {
+	if(!threaded) {
+		return;
+	}
+	running = false;
+	__sync_synchronize();
+	wakeUp();
+	pthread_join(thread, NULL);
+	threaded = false;
+	executeCommands();
+	::close(wake_pipe[0]);
+	::close(wake_pipe[1]);
+	wake_pipe[0] = wake_pipe[1] = -1;
+	poll_fds[0].fd = -1;
+}
+
+void* WebSockets::threadFunction(void* user) {
+	WebSockets* websockets = static_cast<WebSockets*>(user);
+	websockets->run();
+	return NULL;
+}
+
+// We poll a copy of the fds because servicing an fd can add, remove or
+// change the fds. An fd which is removed in the meantime is ignored by
+// libwebsockets. Servicing a NULL fd runs the timeouts and keepalives of
+// libwebsockets (it checks once per second), also when nothing happens.
+void WebSockets::run() {
+	while(running) {
+		executeCommands();
+		polled_fds = poll_fds;
+		int n = poll(&polled_fds[0], polled_fds.size(), poll_timeout);
+		if(n < 0) {
+			if(errno == EINTR) {
+				continue;
+			}
+			printf("WebSockets: poll() failed: %s\n", strerror(errno));
+			break;
+		}
+		if(polled_fds[0].revents & POLLIN) {
+			char buf[64];
+			while(read(wake_pipe[0], buf, sizeof(buf)) > 0) {
+			}
+			// reset before we execute the commands, so a command which is
+			// pushed after this always writes to the pipe again
+			__sync_lock_release(&wake_pending);
+			__sync_synchronize();
+			--n;
+		}
+		for(size_t i = 1; i < polled_fds.size() && n > 0; ++i) {
+			if(polled_fds[i].revents) {
+				libwebsocket_service_fd(ws_context, &polled_fds[i]);
+				--n;
+			}
+		}
+		libwebsocket_service_fd(ws_context, NULL);
+	}
+}
+
+// One byte in the pipe is enough to wake up the service thread.
+void WebSockets::wakeUp() {
+	if(wake_pipe[1] < 0) {
+		return;
+	}
+	if(__sync_bool_compare_and_swap(&wake_pending, 0, 1)) {
+		char c = 1;
+		if(write(wake_pipe[1], &c, 1) < 0 && errno != EAGAIN) {
+			printf("WebSockets: cannot wake up the service thread.\n");
+		}
+	}
+}
+
+void WebSockets::post(int type, WebSocketConnection* conn, WebSocketProtocol* protocol, WebSocketBuffer* buffer) {
+	WebSocketEvent* ev = new WebSocketEvent(type, conn, protocol, buffer);
+	ev->time = now();
+	outgoing.push(ev);
+	wakeUp();
+}
+
+// Executes the sends, broadcasts and closes of the app.
+void WebSockets::executeCommands() {
+	size_t depth = outgoing.size();
+	if(!depth) {
+		return;
+	}
+	stats.outgoing_depth.add(depth);
+	WebSocketEvent* ev = NULL;
+	while((ev = outgoing.pop())) {
+		switch(ev->type) {
+			case WS_EVENT_SEND: {
+				ev->conn->queueFrame(ev->buffer, ev->time);
+				break;
+			}
+			case WS_EVENT_SEND_ALL: {
+				ev->protocol->queueFrameOnAll(ev->buffer, ev->time);
+				break;
+			}
+			case WS_EVENT_CLOSE_CONNECTION: {
+				if(ev->conn->ws != NULL) {
+					libwebsocket_close_and_free_session(ws_context, ev->conn->ws, LWS_CLOSE_STATUS_NORMAL);
+				}
+				break;
+			}
+			default: break;
+		}
+		delete ev;
+	}
+}
+
+// Called on the service thread; the protocol is called by update().
+void WebSockets::queueEvent(int type, WebSocketConnection* conn, const char* message, const unsigned int len) {
+	WebSocketBuffer* buffer = NULL;
+	if(message != NULL && len > 0) {
+		buffer = WebSocketBuffer::create(message, len, false);
+	}
+	WebSocketEvent* ev = new WebSocketEvent(type, conn, conn->protocol, buffer);
+	if(buffer) {
+		buffer->release();
+	}
+	ev->time = now();
+	incoming.push(ev);
+}
+
+void WebSockets::dispatchEvent(WebSocketEvent* ev) {
+	string msg;
+	if(ev->buffer) {
+		msg.assign((const char*)ev->buffer->getPayload(), ev->buffer->getSize());
+	}
+	switch(ev->type) {
+		case WS_EVENT_OPEN: {
+			ev->protocol->onOpen(msg, *ev->conn);
+			break;
+		}
+		case WS_EVENT_CLOSE: {
+			ev->protocol->onClose(msg, *ev->conn);
+			break;
+		}
+		case WS_EVENT_MESSAGE: {
+			ev->protocol->onMessage(msg, *ev->conn);
+			break;
+		}
+		case WS_EVENT_BROADCAST: {
+			ev->protocol->onBroadcast(msg, *ev->conn);
+			break;
+		}
+		default: break;
+	}
+}
+
+// Keeps our poll array in sync with the one of libwebsockets.
+void WebSockets::onPollFd(enum libwebsocket_callback_reasons reason, int fd, int events) {
+	if(reason == LWS_CALLBACK_ADD_POLL_FD) {
+		struct pollfd pfd = {fd, (short)events, 0};
+		poll_fds.push_back(pfd);
+		return;
+	}
+	for(size_t i = 1; i < poll_fds.size(); ++i) {
+		if(poll_fds[i].fd != fd) {
+			continue;
+		}
+		switch(reason) {
+			case LWS_CALLBACK_DEL_POLL_FD: {
+				poll_fds[i] = poll_fds.back();
+				poll_fds.pop_back();
+				break;
+			}
+			case LWS_CALLBACK_SET_MODE_POLL_FD: {
+				poll_fds[i].events |= events;
+				break;
+			}
+			case LWS_CALLBACK_CLEAR_MODE_POLL_FD: {
+				poll_fds[i].events &= ~events;
+				break;
+			}
+			default: break;
+		}
+		return;
+	}
+}
+
+// Stats
+// -----------------------------------------------------------------------------
+void WebSockets::onFrameWritten(uint64_t queuedAt) {
+	stats.outgoing_latency.add(now() - queuedAt);
+}
+
+// The histograms are written by two threads, so they can be a bit behind.
+void WebSockets::getStats(WebSocketStats& result) {
+	__sync_synchronize();
+	result = stats;
+	result.num_incoming = incoming.size();
+	result.num_outgoing = outgoing.size();
+}
+
+void WebSockets::resetStats() {
+	stats.incoming_depth.reset();
+	stats.incoming_latency.reset();
+	stats.outgoing_depth.reset();
+	stats.outgoing_latency.reset();
+}
+
+uint64_t WebSockets::now() {
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return uint64_t(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
 }
 
 void WebSockets::addProtocol(const string& name, WebSocketProtocol& protocol) {
@@ -63,7 +335,14 @@ void WebSockets::addProtocol(const string& name, WebSocketProtocol& protocol) {
 }
 
 void WebSockets::close(WebSocketConnection* conn) {
-	if(conn == NULL || conn->ws == NULL) {
+	if(conn == NULL || conn->isClosed()) {
+		return;
+	}
+	if(mustPost()) {
+		post(WS_EVENT_CLOSE_CONNECTION, conn, conn->protocol, NULL);
+		return;
+	}
+	if(conn->ws == NULL) {
 		return;
 	}
 	printf("Close connections...\n");
@@ -101,6 +380,34 @@ unsigned int WebSockets::onCallback(
 		return 1;
 	}
 	
+	if(threaded) {
+		switch(reason) {
+			case LWS_CALLBACK_ESTABLISHED: {
+				conn->protocol->addConnection(conn);
+				queueEvent(WS_EVENT_OPEN, conn, message, len);
+				break;
+			}
+			case LWS_CALLBACK_CLOSED: {
+				conn->protocol->removeConnection(conn);
+				queueEvent(WS_EVENT_CLOSE, conn, message, len);
+				break;
+			}
+			case LWS_CALLBACK_SERVER_WRITEABLE: {
+				return conn->onWriteable() ? 0 : 1;
+			}
+			case LWS_CALLBACK_BROADCAST: {
+				queueEvent(WS_EVENT_BROADCAST, conn, message, len);
+				break;
+			}
+			case LWS_CALLBACK_RECEIVE: {
+				queueEvent(WS_EVENT_MESSAGE, conn, message, len);
+				break;
+			}
+			default:break;
+		}
+		return 0;
+	}
+	
 	string msg;
 	if(message != NULL && len > 0) {
 		msg = string(message, len);
@@ -108,15 +415,22 @@ unsigned int WebSockets::onCallback(
 	
 	switch(reason) {
 		case LWS_CALLBACK_ESTABLISHED: {
+			conn->protocol->addConnection(conn);
 			conn->protocol->onOpen(msg, *conn);
 			break;
 		}
 		case LWS_CALLBACK_CLOSED: {
 			conn->protocol->onClose(msg, *conn);
+			conn->protocol->removeConnection(conn);
 			break;
 		}
 		case LWS_CALLBACK_SERVER_WRITEABLE: {
-			conn->protocol->onIdle(msg, *conn);
+			if(!conn->onWriteable()) {
+				return 1; // closes the connection
+			}
+			if(!conn->getNumQueued()) {
+				conn->protocol->onIdle(msg, *conn);
+			}
 			break;
 		}	
 		case LWS_CALLBACK_BROADCAST: {
@@ -150,6 +464,18 @@ int ws_callback(
 {
 	roxlu::WebSockets* websockets = roxlu::WebSockets::getInstance();
 	
+	// our own poll array for the service thread
+	switch(reason) {
+		case LWS_CALLBACK_ADD_POLL_FD:
+		case LWS_CALLBACK_DEL_POLL_FD:
+		case LWS_CALLBACK_SET_MODE_POLL_FD:
+		case LWS_CALLBACK_CLEAR_MODE_POLL_FD: {
+			websockets->onPollFd(reason, (int)(long)user, (int)len);
+			return 0;
+		}
+		default: break;
+	}
+	
 	// get protocol handle.
 	const struct libwebsocket_protocols* ws_protocol = libwebsockets_get_protocol(ws);
 	int dx = (ws_protocol) ? ws_protocol->protocol_index : 0;
@@ -159,15 +485,10 @@ int ws_callback(
 	roxlu::WebSocketConnection** const conn_ptr = (roxlu::WebSocketConnection**)user;
 	roxlu::WebSocketConnection* conn;
 	
-	// connection established & closed
+	// connection established; it's released after the closed callback
 	if(reason == LWS_CALLBACK_ESTABLISHED) {
 		*conn_ptr = new roxlu::WebSocketConnection(websockets, protocol);
 	}
-	else if(reason == LWS_CALLBACK_CLOSED) {
-		if(*conn_ptr != NULL) {
-			delete *conn_ptr;
-		}
-	}
 	
 	switch(reason) {
 		case LWS_CALLBACK_FILTER_NETWORK_CONNECTION: {
@@ -179,8 +500,19 @@ int ws_callback(
 			}
 		};
 		
+		case LWS_CALLBACK_CLOSED: {
+			conn = *conn_ptr;
+			if(conn == NULL) {
+				return 0;
+			}
+			conn->ws = ws;
+			websockets->onCallback(conn, reason, (char*)message, len);
+			conn->onClosed();
+			conn->release();
+			*conn_ptr = NULL;
+			return 0;
+		}
 		case LWS_CALLBACK_ESTABLISHED:
-		case LWS_CALLBACK_CLOSED:
 		case LWS_CALLBACK_SERVER_WRITEABLE:
 		case LWS_CALLBACK_RECEIVE:
 		case LWS_CALLBACK_BROADCAST: {
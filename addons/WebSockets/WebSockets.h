@@ -1,10 +1,15 @@
 #ifndef ROXLU_WEBSOCKETSH
 #define ROXLU_WEBSOCKETSH
 
+#include <stdint.h>
 #include <string>
 #include <vector>
+#include <pthread.h>
+#include <poll.h>
 #include "WebSocketProtocol.h"
 #include "WebSocketConnection.h"
+#include "WebSocketBuffer.h"
+#include "WebSocketQueue.h"
 
 extern "C" {
  #include "libwebsockets.h"
@@ -16,6 +21,31 @@ using std::pair;
 
 namespace roxlu {
 
+/*
+
+Service thread:
+---------------
+By default the websockets are serviced by update(), so the latency of
+the network depends on your frame rate. After startThread() the sockets
+are serviced by their own thread, which polls the sockets and a wake-up
+pipe:
+
+	websockets.addProtocol("sensors", sensors);
+	websockets.start(9001);
+	websockets.startThread();
+	...
+	// in your update loop; calls onOpen/onMessage/onClose on this thread
+	websockets.update();
+
+The protocol callbacks are still called on the thread which calls update(),
+the events are passed through a lock-free queue. send(), broadcast() and
+close() can be called from any thread; they are queued and the service
+thread is woken up right away, so the frames don't wait for update().
+onIdle() isn't called in this mode.
+
+getStats() returns the depth and latency histograms of both queues.
+
+*/
 
 class WebSockets {
 public:
@@ -23,8 +53,20 @@ public:
 	~WebSockets();
 	static WebSockets* getInstance();
 	void start(const unsigned int port);
-	void update();
+	bool startThread(int pollTimeoutMillis = 100);
+	void stopThread();
+	bool isThreaded();
+	void update(); // services the sockets or, when threaded, dispatches the received events
 	void close(WebSocketConnection* conn);
+	void getStats(WebSocketStats& result);
+	void resetStats();
+	static uint64_t now(); // micros
+
+	// used by the connections and protocols
+	bool mustPost(); // true when we must pass sends to the service thread
+	void post(int type, WebSocketConnection* conn, WebSocketProtocol* protocol, WebSocketBuffer* buffer);
+	void onFrameWritten(uint64_t queuedAt);
+	void onPollFd(enum libwebsocket_callback_reasons reason, int fd, int events);
 	
 	WebSocketProtocol* getProtocol(const unsigned int dx);
 	void addProtocol(const string& name, WebSocketProtocol& protocol);
@@ -47,6 +89,26 @@ public:
 	vector<pair<string, WebSocketProtocol*> > protocols;
 	struct libwebsocket_context* ws_context;	
 	string interface;
+
+private:
+	static void* threadFunction(void* user);
+	void run();
+	void wakeUp();
+	void executeCommands();
+	void dispatchEvent(WebSocketEvent* ev);
+	void queueEvent(int type, WebSocketConnection* conn, const char* message, const unsigned int len);
+
+	vector<struct pollfd> poll_fds; // [0] is the wake-up pipe, the others come from libwebsockets
+	vector<struct pollfd> polled_fds; // copy which we poll, libwebsockets changes poll_fds while servicing
+	pthread_t thread;
+	volatile bool running;
+	bool threaded;
+	int poll_timeout;
+	int wake_pipe[2];
+	volatile int wake_pending;
+	WebSocketQueue incoming; // service thread -> update()
+	WebSocketQueue outgoing; // send(), broadcast(), close() -> service thread
+	WebSocketStats stats;
 };
 
 inline WebSocketProtocol* WebSockets::getProtocol(const unsigned int dx) {
@@ -60,6 +122,14 @@ inline WebSockets* WebSockets::getInstance() {
 	return instance;
 }
 
+inline bool WebSockets::isThreaded() {
+	return threaded;
+}
+
+inline bool WebSockets::mustPost() {
+	return threaded && !pthread_equal(pthread_self(), thread);
+}
+
 extern "C" {
 
 int ws_callback(	 struct libwebsocket_context *context
@@ -1,18 +1,33 @@
 #include "Webp.h"
-WebP::WebP() 
+WebP::WebP()
 	:loaded(false)
+	,idec(NULL)
+	,decoded_rows(0)
 {
 	if(!WebPInitDecoderConfig(&config)) {
 		printf("Wrong webp library.\n");
 	}
+	resetOptions();
 }
 
-WebP::WebP(const string& filename) {
-	WebP();
+WebP::WebP(const string& filename)
+	:loaded(false)
+	,idec(NULL)
+	,decoded_rows(0)
+{
+	if(!WebPInitDecoderConfig(&config)) {
+		printf("Wrong webp library.\n");
+	}
+	resetOptions();
 	load(filename);
 }
 
 WebP::~WebP() {
+	endIncremental();
+	freeOutput();
+}
+
+void WebP::freeOutput() {
 	if(loaded) {
 		WebPFreeDecBuffer(&config.output);
 		loaded = false;
@@ -21,51 +36,229 @@ WebP::~WebP() {
 
 // we assume files to be in data path.
 bool WebP::load(const string& filename) {
-	if(loaded) {
-		WebPFreeDecBuffer(&config.output);
-		loaded = false;
-	}
-	
 	string filepath = File::toDataPath(filename);
-	printf("Loading: %s\n", filepath.c_str());
-	WebPDecBuffer* const output_buffer = &config.output;
-	WebPBitstreamFeatures* const bitstream = &config.input;
-	VP8StatusCode status = VP8_STATUS_OK;
-	int ok;
-	size_t data_size;
 	FILE* const in = fopen(filepath.c_str(), "rb");
-	
 	if(!in) {
 		printf("Cannot open file: %s\n", filepath.c_str());
 		return false;
 	}
-	
+
 	fseek(in, 0, SEEK_END);
-	data_size = ftell(in);
+	size_t data_size = ftell(in);
 	fseek(in, 0, SEEK_SET);
-	printf("Data size: %zu\n", data_size);
-	unsigned char* data = new unsigned char[data_size];	
-	ok = (fread(data, data_size, 1, in) == 1);
+	std::vector<unsigned char> file_data(data_size);
+	bool ok = data_size > 0 && (fread(&file_data[0], data_size, 1, in) == 1);
+	fclose(in);
 	if(!ok) {
 		printf("Cannot read from webp image.\n");
 		return false;
 	}
-	
-	status = WebPGetFeatures((const uint8_t*)data, data_size, bitstream);
+	return load(&file_data[0], data_size);
+}
+
+bool WebP::load(IOBuffer& buffer) {
+	return load(GET_IB_POINTER(buffer), GET_AVAILABLE_BYTES_COUNT(buffer));
+}
+
+bool WebP::load(const unsigned char* data, size_t size) {
+	endIncremental();
+	freeOutput();
+
+	VP8StatusCode status = WebPGetFeatures((const uint8_t*)data, size, &config.input);
 	if(status != VP8_STATUS_OK) {
-		delete[] data;
-		data = NULL;
+		printf("Cannot read webp features: %d\n", status);
+		return false;
+	}
+	if(!setupOutput()) {
 		return false;
 	}
-	
-	output_buffer->colorspace = MODE_RGBA;
-	status = WebPDecode((const uint8_t*)data, data_size, &config);
+	status = WebPDecode((const uint8_t*)data, size, &config);
 	if(status != VP8_STATUS_OK) {
+		printf("Cannot decode webp: %d\n", status);
+		WebPFreeDecBuffer(&config.output);
 		return false;
 	}
 	loaded = true;
-	delete[] data;
-	data = NULL;
+	decoded_rows = config.output.height;
+	return true;
+}
+
+// Options
+// -----------------------------------------------------------------------------
+void WebP::setScale(int width, int height) {
+	scale_width = width;
+	scale_height = height;
+}
+
+void WebP::setCrop(int x, int y, int width, int height) {
+	crop_x = x;
+	crop_y = y;
+	crop_width = width;
+	crop_height = height;
+}
+
+// The buffer must be big enough for the (scaled/cropped) image: stride * height.
+void WebP::setOutput(unsigned char* pixels, int stride, size_t size) {
+	output_pixels = pixels;
+	output_stride = stride;
+	output_size = size;
+}
+
+void WebP::resetOptions() {
+	scale_width = scale_height = 0;
+	crop_x = crop_y = crop_width = crop_height = 0;
+	output_pixels = NULL;
+	output_stride = 0;
+	output_size = 0;
+}
+
+// Applies the options to the config, config.input must be valid.
+bool WebP::setupOutput() {
+	int w = config.input.width;
+	int h = config.input.height;
+	config.options.use_cropping = 0;
+	config.options.use_scaling = 0;
+	if(crop_width > 0 && crop_height > 0) {
+		if(crop_x < 0 || crop_y < 0 || crop_x + crop_width > w || crop_y + crop_height > h) {
+			printf("WebP: crop rectangle is outside the image.\n");
+			return false;
+		}
+		config.options.use_cropping = 1;
+		config.options.crop_left = crop_x;
+		config.options.crop_top = crop_y;
+		config.options.crop_width = crop_width;
+		config.options.crop_height = crop_height;
+		w = crop_width;
+		h = crop_height;
+	}
+	if(scale_width > 0 || scale_height > 0) {
+		int sw = (scale_width > 0) ? scale_width : std::max<int>(1, (w * scale_height + h / 2) / h);
+		int sh = (scale_height > 0) ? scale_height : std::max<int>(1, (h * scale_width + w / 2) / w);
+		config.options.use_scaling = 1;
+		config.options.scaled_width = sw;
+		config.options.scaled_height = sh;
+		w = sw;
+		h = sh;
+	}
+
+	config.output.colorspace = MODE_RGBA;
+	config.output.is_external_memory = 0;
+	if(output_pixels) {
+		if(output_stride < w * 4 || output_size < (size_t)output_stride * h) {
+			printf("WebP: the output buffer is too small for %dx%d.\n", w, h);
+			return false;
+		}
+		config.output.is_external_memory = 1;
+		config.output.u.RGBA.rgba = output_pixels;
+		config.output.u.RGBA.stride = output_stride;
+		config.output.u.RGBA.size = output_size;
+	}
+	return true;
+}
+
+// Incremental
+// -----------------------------------------------------------------------------
+bool WebP::beginIncremental() {
+	endIncremental();
+	freeOutput();
+	header.clear();
+	decoded_rows = 0;
 	return true;
 }
 
+// We keep the first bytes until we know the size of the image, then we
+// setup the output (scale, crop, buffer) and start the decoder.
+int WebP::append(const unsigned char* data, size_t size) {
+	if(!size) {
+		return WEBP_DECODE_SUSPENDED;
+	}
+	if(!idec) {
+		header.insert(header.end(), data, data + size);
+		VP8StatusCode status = WebPGetFeatures(&header[0], header.size(), &config.input);
+		if(status == VP8_STATUS_NOT_ENOUGH_DATA) {
+			return WEBP_DECODE_SUSPENDED;
+		}
+		if(status != VP8_STATUS_OK || !setupOutput()) {
+			printf("Cannot read webp features: %d\n", status);
+			return WEBP_DECODE_ERROR;
+		}
+		idec = WebPIDecode(NULL, 0, &config);
+		if(!idec) {
+			printf("Cannot create incremental webp decoder.\n");
+			return WEBP_DECODE_ERROR;
+		}
+		loaded = true;
+		data = &header[0];
+		size = header.size();
+	}
+
+	VP8StatusCode status = WebPIAppend(idec, (const uint8_t*)data, size);
+	header.clear();
+	if(status == VP8_STATUS_OK) {
+		decoded_rows = config.output.height;
+		return WEBP_DECODE_DONE;
+	}
+	if(status == VP8_STATUS_SUSPENDED) {
+		return WEBP_DECODE_SUSPENDED;
+	}
+	printf("Cannot decode webp: %d\n", status);
+	return WEBP_DECODE_ERROR;
+}
+
+int WebP::append(IOBuffer& buffer) {
+	uint32_t num = GET_AVAILABLE_BYTES_COUNT(buffer);
+	int result = append(GET_IB_POINTER(buffer), num);
+	buffer.ignore(num);
+	return result;
+}
+
+int WebP::getNumDecodedRows() {
+	if(idec && decoded_rows < config.output.height) {
+		int last_y = 0;
+		if(WebPIDecGetRGB(idec, &last_y, NULL, NULL, NULL)) {
+			decoded_rows = last_y;
+		}
+	}
+	return decoded_rows;
+}
+
+// The decoded pixels stay valid.
+void WebP::endIncremental() {
+	if(idec) {
+		getNumDecodedRows();
+		WebPIDelete(idec);
+		idec = NULL;
+	}
+	header.clear();
+}
+
+// -----------------------------------------------------------------------------
+
+bool WebPImageDecoder::canDecode(const unsigned char* data, size_t size) {
+	return size >= 12 && memcmp(data, "RIFF", 4) == 0 && memcmp(data + 8, "WEBP", 4) == 0;
+}
+
+// Decodes straight into a pooled buffer of the loader.
+bool WebPImageDecoder::decode(const unsigned char* data, size_t size, roxlu::ImageLoader& loader, roxlu::LoadedImage& result) {
+	WebPDecoderConfig config;
+	if(!WebPInitDecoderConfig(&config)) {
+		printf("Wrong webp library.\n");
+		return false;
+	}
+	if(WebPGetFeatures((const uint8_t*)data, size, &config.input) != VP8_STATUS_OK) {
+		return false;
+	}
+	result.width = config.input.width;
+	result.height = config.input.height;
+	result.bytes_per_pixel = 4;
+	result.pixels = loader.allocBuffer(result.width * result.height * 4, result.capacity);
+
+	config.output.colorspace = MODE_RGBA;
+	config.output.is_external_memory = 1;
+	config.output.u.RGBA.rgba = result.pixels;
+	config.output.u.RGBA.stride = result.width * 4;
+	config.output.u.RGBA.size = result.width * result.height * 4;
+	VP8StatusCode status = WebPDecode((const uint8_t*)data, size, &config);
+	WebPFreeDecBuffer(&config.output);
+	return status == VP8_STATUS_OK;
+}
@@ -3,21 +3,94 @@
 
 #include "Roxlu.h"
 #include <string>
+#include <vector>
 #include "./decode.h"
 
+// return values of WebP::append()
+#define WEBP_DECODE_ERROR -1
+#define WEBP_DECODE_SUSPENDED 0 // we need more data
+#define WEBP_DECODE_DONE 1
+
+/*
+
+Decodes WebP images into RGBA.
+
+Options (used by the next load or incremental decode):
+------------------------------------------------------
+- setScale(w, h): decode straight to this size; use 0 for the width or
+  height to keep the aspect ratio. This is a lot faster and uses less
+  memory than decoding a big image and scaling it down.
+- setCrop(x, y, w, h): only decode this part, applied before scaling.
+- setOutput(pixels, stride, size): decode into your own RGBA buffer (e.g.
+  a mapped PBO) instead of memory which is allocated by the decoder.
+
+	WebP thumb;
+	thumb.setScale(320, 0);
+	thumb.load("photo_4k.webp");
+
+Incremental:
+------------
+When the data comes in over time (network, a big file) you can decode it
+while it arrives, rows become available while decoding.
+
+	WebP wp;
+	wp.beginIncremental();
+	while(wp.append(buffer, num_bytes) == WEBP_DECODE_SUSPENDED) {
+		... read more, getNumDecodedRows() rows are ready.
+	}
+	wp.endIncremental();
+
+*/
 class WebP {
 public:
 	WebP();
 	WebP(const string& filename);
 	~WebP();
-	bool load(const string& filename);
+	bool load(const string& filename); // from data path
+	bool load(const unsigned char* data, size_t size);
+	bool load(IOBuffer& buffer); // the bytes which are not consumed
+
+	void setScale(int width, int height);
+	void setCrop(int x, int y, int width, int height);
+	void setOutput(unsigned char* pixels, int stride, size_t size);
+	void resetOptions();
+
+	bool beginIncremental();
+	int append(const unsigned char* data, size_t size);
+	int append(IOBuffer& buffer); // consumes the bytes
+	int getNumDecodedRows();
+	void endIncremental();
+
 	int getWidth();
 	int getHeight();
+	int getStride();
 	unsigned char* getPixels();
 	WebPDecoderConfig config;
 
 private:
+	bool setupOutput(); // call after the features are read
+	void freeOutput();
+
 	bool loaded;
+	int scale_width;
+	int scale_height;
+	int crop_x;
+	int crop_y;
+	int crop_width;
+	int crop_height;
+	unsigned char* output_pixels; // when decoding into the users buffer
+	int output_stride;
+	size_t output_size;
+	WebPIDecoder* idec;
+	std::vector<unsigned char> header; // incremental: data until we know the size
+	int decoded_rows;
+};
+
+// Decodes WebP images for the roxlu::ImageLoader, into RGBA.
+class WebPImageDecoder : public roxlu::ImageDecoder {
+public:
+	bool canDecode(const unsigned char* data, size_t size);
+	bool decode(const unsigned char* data, size_t size, roxlu::ImageLoader& loader, roxlu::LoadedImage& result);
 };
 
 inline unsigned char* WebP::getPixels() {
@@ -32,5 +105,8 @@ inline int WebP::getHeight() {
 	return config.output.height;
 }
 
+inline int WebP::getStride() {
+	return config.output.u.RGBA.stride;
+}
 
-#endif
\ No newline at end of file
+#endif
@@ -20,11 +20,14 @@
 #include "3d/shapes/UVSphere.h"
 #include "core/Constants.h"
 #include "core/Noise.h"
+#include "core/Parallel.h"
+#include "core/ThreadPool.h"
 #include "core/StringUtil.h"
 #include "core/Utils.h"
 #include "core/Keyboard.h"
 #include "experimental/ShaderGenerator.h"
 #include "experimental/SimpleClient.h"
+#include "experimental/SimpleReactor.h"
 #include "experimental/SimpleServer.h"
 #include "experimental/ShaderTypes.h"
 #include "experimental/Timer.h"
@@ -33,6 +36,7 @@
 #include "experimental/VertexBuffer.h"
 #include "graphics/Color.h"
 #include "graphics/Image.h"
+#include "graphics/ImageLoader.h"
 #include "io/Dictionary.h"
 #include "io/DictionaryMap.h"
 #include "io/Endianness.h"
@@ -44,6 +48,7 @@
 #include "io/R3F.h"
 #include "math/Interpolator.h"
 #include "math/Random.h"
+#include "math/RandomGenerator.h"
 #include "math/Mat3.h"
 #include "math/Mat4.h"
 #include "math/Quat.h"
@@ -1,4 +1,8 @@
 #include "Noise.h"
+#include "Parallel.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 #define FASTFLOOR(x) ( ((x)>0) ? ((int)x) : (((int)x)-1) )
 
 namespace roxlu {
@@ -369,4 +373,411 @@ float fbm(const Vec2& v) {
 
 
 
+// -----------------------------------------------------------------------------
+// Batch evaluation
+
+NoiseSettings::NoiseSettings()
+	:octaves(1)
+	,frequency(1.0f)
+	,amplitude(1.0f)
+	,lacunarity(2.0f)
+	,gain(0.5f)
+{
+}
+
+float fbm2(float x, float y, const NoiseSettings& settings) {
+	float result = 0.0f;
+	float amp = settings.amplitude;
+	float freq = settings.frequency;
+	for(int i = 0; i < settings.octaves; ++i) {
+		result += noise2(x * freq, y * freq) * amp;
+		freq *= settings.lacunarity;
+		amp *= settings.gain;
+	}
+	return result;
+}
+
+float fbm3(float x, float y, float z, const NoiseSettings& settings) {
+	float result = 0.0f;
+	float amp = settings.amplitude;
+	float freq = settings.frequency;
+	for(int i = 0; i < settings.octaves; ++i) {
+		result += noise3(x * freq, y * freq, z * freq) * amp;
+		freq *= settings.lacunarity;
+		amp *= settings.gain;
+	}
+	return result;
+}
+
+#if defined(__SSE2__)
+
+// floor() for 4 floats, also returns the integer values
+static inline __m128 floor4(__m128 v, __m128i& iv) {
+	__m128i t = _mm_cvttps_epi32(v);
+	__m128 tf = _mm_cvtepi32_ps(t);
+	__m128 neg = _mm_cmplt_ps(v, tf); // truncated towards zero
+	iv = _mm_add_epi32(t, _mm_castps_si128(neg)); // neg is -1 
+	return _mm_sub_ps(tf, _mm_and_ps(neg, _mm_set1_ps(1.0f)));
+}
+
+static inline __m128 select4(__m128 mask, __m128 a, __m128 b) {
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static inline __m128 negate4(__m128i hash, int bit, __m128 v) {
+	__m128i b = _mm_set1_epi32(bit);
+	__m128 mask = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(hash, b), b));
+	return _mm_xor_ps(v, _mm_and_ps(mask, _mm_set1_ps(-0.0f)));
+}
+
+// same as grad2() 
+static inline __m128 grad2_4(__m128i hash, __m128 x, __m128 y) {
+	__m128i h = _mm_and_si128(hash, _mm_set1_epi32(7));
+	__m128 lt4 = _mm_castsi128_ps(_mm_cmplt_epi32(h, _mm_set1_epi32(4)));
+	__m128 u = select4(lt4, x, y);
+	__m128 v = select4(lt4, y, x);
+	return _mm_add_ps(negate4(h, 1, u), negate4(h, 2, _mm_add_ps(v, v)));
+}
+
+// same as grad3()
+static inline __m128 grad3_4(__m128i hash, __m128 x, __m128 y, __m128 z) {
+	__m128i h = _mm_and_si128(hash, _mm_set1_epi32(15));
+	__m128 lt8 = _mm_castsi128_ps(_mm_cmplt_epi32(h, _mm_set1_epi32(8)));
+	__m128 lt4 = _mm_castsi128_ps(_mm_cmplt_epi32(h, _mm_set1_epi32(4)));
+	__m128 h12 = _mm_castsi128_ps(_mm_or_si128(_mm_cmpeq_epi32(h, _mm_set1_epi32(12)), _mm_cmpeq_epi32(h, _mm_set1_epi32(14))));
+	__m128 u = select4(lt8, x, y);
+	__m128 v = select4(lt4, y, select4(h12, x, z));
+	return _mm_add_ps(negate4(h, 1, u), negate4(h, 2, v));
+}
+
+// (max(0, t))^4 * grad
+static inline __m128 falloff4(__m128 t, __m128 grad) {
+	t = _mm_max_ps(t, _mm_setzero_ps());
+	t = _mm_mul_ps(t, t);
+	return _mm_mul_ps(_mm_mul_ps(t, t), grad);
+}
+
+static inline __m128 noise2_4(__m128 x, __m128 y) {
+	const __m128 g2 = _mm_set1_ps((float)G2);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 half = _mm_set1_ps(0.5f);
+
+	__m128 s = _mm_mul_ps(_mm_add_ps(x, y), _mm_set1_ps((float)F2));
+	__m128i i, j;
+	__m128 fi = floor4(_mm_add_ps(x, s), i);
+	__m128 fj = floor4(_mm_add_ps(y, s), j);
+	__m128 t = _mm_mul_ps(_mm_add_ps(fi, fj), g2);
+	__m128 x0 = _mm_sub_ps(x, _mm_sub_ps(fi, t));
+	__m128 y0 = _mm_sub_ps(y, _mm_sub_ps(fj, t));
+
+	__m128 upper = _mm_cmpgt_ps(x0, y0);
+	__m128 x1 = _mm_add_ps(_mm_sub_ps(x0, _mm_and_ps(upper, one)), g2);
+	__m128 y1 = _mm_add_ps(_mm_sub_ps(y0, _mm_andnot_ps(upper, one)), g2);
+	__m128 x2 = _mm_add_ps(x0, _mm_set1_ps(-1.0f + 2.0f * (float)G2));
+	__m128 y2 = _mm_add_ps(y0, _mm_set1_ps(-1.0f + 2.0f * (float)G2));
+
+	// permutation lookups per lane.
+	int ii[4], jj[4], up[4], h0[4], h1[4], h2[4];
+	_mm_storeu_si128((__m128i*)ii, _mm_and_si128(i, _mm_set1_epi32(0xff)));
+	_mm_storeu_si128((__m128i*)jj, _mm_and_si128(j, _mm_set1_epi32(0xff)));
+	_mm_storeu_si128((__m128i*)up, _mm_castps_si128(upper));
+	for(int l = 0; l < 4; ++l) {
+		int i1 = up[l] & 1;
+		int j1 = 1 - i1;
+		h0[l] = perm[ii[l] + perm[jj[l]]];
+		h1[l] = perm[ii[l] + i1 + perm[jj[l] + j1]];
+		h2[l] = perm[ii[l] + 1 + perm[jj[l] + 1]];
+	}
+
+	__m128 n0 = falloff4(
+		 _mm_sub_ps(_mm_sub_ps(half, _mm_mul_ps(x0, x0)), _mm_mul_ps(y0, y0))
+		,grad2_4(_mm_loadu_si128((__m128i*)h0), x0, y0)
+	);
+	__m128 n1 = falloff4(
+		 _mm_sub_ps(_mm_sub_ps(half, _mm_mul_ps(x1, x1)), _mm_mul_ps(y1, y1))
+		,grad2_4(_mm_loadu_si128((__m128i*)h1), x1, y1)
+	);
+	__m128 n2 = falloff4(
+		 _mm_sub_ps(_mm_sub_ps(half, _mm_mul_ps(x2, x2)), _mm_mul_ps(y2, y2))
+		,grad2_4(_mm_loadu_si128((__m128i*)h2), x2, y2)
+	);
+	return _mm_mul_ps(_mm_set1_ps(40.0f), _mm_add_ps(_mm_add_ps(n0, n1), n2));
+}
+
+static inline __m128 noise3_4(__m128 x, __m128 y, __m128 z) {
+	const __m128 g3 = _mm_set1_ps((float)G3);
+	const __m128 g3_2 = _mm_set1_ps(2.0f * (float)G3);
+	const __m128 g3_3 = _mm_set1_ps(-1.0f + 3.0f * (float)G3);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 r = _mm_set1_ps(0.6f);
+
+	__m128 s = _mm_mul_ps(_mm_add_ps(_mm_add_ps(x, y), z), _mm_set1_ps((float)F3));
+	__m128i i, j, k;
+	__m128 fi = floor4(_mm_add_ps(x, s), i);
+	__m128 fj = floor4(_mm_add_ps(y, s), j);
+	__m128 fk = floor4(_mm_add_ps(z, s), k);
+	__m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(fi, fj), fk), g3);
+	__m128 x0 = _mm_sub_ps(x, _mm_sub_ps(fi, t));
+	__m128 y0 = _mm_sub_ps(y, _mm_sub_ps(fj, t));
+	__m128 z0 = _mm_sub_ps(z, _mm_sub_ps(fk, t));
+
+	// the same simplex selection as noise3() written with masks
+	__m128 xy = _mm_cmpge_ps(x0, y0);
+	__m128 yz = _mm_cmpge_ps(y0, z0);
+	__m128 xz = _mm_cmpge_ps(x0, z0);
+	__m128 i1 = _mm_and_ps(xy, xz);
+	__m128 j1 = _mm_andnot_ps(xy, yz);
+	__m128 k1 = _mm_andnot_ps(xz, _mm_andnot_ps(yz, _mm_castsi128_ps(_mm_set1_epi32(-1))));
+	__m128 i2 = _mm_or_ps(xy, xz);
+	__m128 j2 = _mm_or_ps(_mm_andnot_ps(xy, _mm_castsi128_ps(_mm_set1_epi32(-1))), yz);
+	__m128 k2 = _mm_andnot_ps(_mm_and_ps(xz, yz), _mm_castsi128_ps(_mm_set1_epi32(-1)));
+
+	__m128 x1 = _mm_add_ps(_mm_sub_ps(x0, _mm_and_ps(i1, one)), g3);
+	__m128 y1 = _mm_add_ps(_mm_sub_ps(y0, _mm_and_ps(j1, one)), g3);
+	__m128 z1 = _mm_add_ps(_mm_sub_ps(z0, _mm_and_ps(k1, one)), g3);
+	__m128 x2 = _mm_add_ps(_mm_sub_ps(x0, _mm_and_ps(i2, one)), g3_2);
+	__m128 y2 = _mm_add_ps(_mm_sub_ps(y0, _mm_and_ps(j2, one)), g3_2);
+	__m128 z2 = _mm_add_ps(_mm_sub_ps(z0, _mm_and_ps(k2, one)), g3_2);
+	__m128 x3 = _mm_add_ps(x0, g3_3);
+	__m128 y3 = _mm_add_ps(y0, g3_3);
+	__m128 z3 = _mm_add_ps(z0, g3_3);
+
+	// permutation lookups per lane.
+	const __m128i bit = _mm_set1_epi32(1);
+	int ii[4], jj[4], kk[4], h0[4], h1[4], h2[4], h3[4];
+	int a[4], b[4], c[4], d[4], e[4], f[4];
+	_mm_storeu_si128((__m128i*)ii, _mm_and_si128(i, _mm_set1_epi32(0xff)));
+	_mm_storeu_si128((__m128i*)jj, _mm_and_si128(j, _mm_set1_epi32(0xff)));
+	_mm_storeu_si128((__m128i*)kk, _mm_and_si128(k, _mm_set1_epi32(0xff)));
+	_mm_storeu_si128((__m128i*)a, _mm_and_si128(_mm_castps_si128(i1), bit));
+	_mm_storeu_si128((__m128i*)b, _mm_and_si128(_mm_castps_si128(j1), bit));
+	_mm_storeu_si128((__m128i*)c, _mm_and_si128(_mm_castps_si128(k1), bit));
+	_mm_storeu_si128((__m128i*)d, _mm_and_si128(_mm_castps_si128(i2), bit));
+	_mm_storeu_si128((__m128i*)e, _mm_and_si128(_mm_castps_si128(j2), bit));
+	_mm_storeu_si128((__m128i*)f, _mm_and_si128(_mm_castps_si128(k2), bit));
+	for(int l = 0; l < 4; ++l) {
+		h0[l] = perm[ii[l] + perm[jj[l] + perm[kk[l]]]];
+		h1[l] = perm[ii[l] + a[l] + perm[jj[l] + b[l] + perm[kk[l] + c[l]]]];
+		h2[l] = perm[ii[l] + d[l] + perm[jj[l] + e[l] + perm[kk[l] + f[l]]]];
+		h3[l] = perm[ii[l] + 1 + perm[jj[l] + 1 + perm[kk[l] + 1]]];
+	}
+
+	#define ROXLU_NOISE3_CORNER(hash, px, py, pz) \
+		falloff4( \
+			 _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(r, _mm_mul_ps(px, px)), _mm_mul_ps(py, py)), _mm_mul_ps(pz, pz)) \
+			,grad3_4(_mm_loadu_si128((__m128i*)hash), px, py, pz) \
+		)
+	__m128 n0 = ROXLU_NOISE3_CORNER(h0, x0, y0, z0);
+	__m128 n1 = ROXLU_NOISE3_CORNER(h1, x1, y1, z1);
+	__m128 n2 = ROXLU_NOISE3_CORNER(h2, x2, y2, z2);
+	__m128 n3 = ROXLU_NOISE3_CORNER(h3, x3, y3, z3);
+	#undef ROXLU_NOISE3_CORNER
+	return _mm_mul_ps(_mm_set1_ps(32.0f), _mm_add_ps(_mm_add_ps(n0, n1), _mm_add_ps(n2, n3)));
+}
+
+// fBm for exactly 4 points
+static inline void fbm2_4(const float* x, const float* y, float* result, const NoiseSettings& settings) {
+	__m128 px = _mm_loadu_ps(x);
+	__m128 py = _mm_loadu_ps(y);
+	__m128 sum = _mm_setzero_ps();
+	float amp = settings.amplitude;
+	float freq = settings.frequency;
+	for(int i = 0; i < settings.octaves; ++i) {
+		__m128 f = _mm_set1_ps(freq);
+		__m128 n = noise2_4(_mm_mul_ps(px, f), _mm_mul_ps(py, f));
+		sum = _mm_add_ps(sum, _mm_mul_ps(n, _mm_set1_ps(amp)));
+		freq *= settings.lacunarity;
+		amp *= settings.gain;
+	}
+	_mm_storeu_ps(result, sum);
+}
+
+static inline void fbm3_4(const float* x, const float* y, const float* z, float* result, const NoiseSettings& settings) {
+	__m128 px = _mm_loadu_ps(x);
+	__m128 py = _mm_loadu_ps(y);
+	__m128 pz = _mm_loadu_ps(z);
+	__m128 sum = _mm_setzero_ps();
+	float amp = settings.amplitude;
+	float freq = settings.frequency;
+	for(int i = 0; i < settings.octaves; ++i) {
+		__m128 f = _mm_set1_ps(freq);
+		__m128 n = noise3_4(_mm_mul_ps(px, f), _mm_mul_ps(py, f), _mm_mul_ps(pz, f));
+		sum = _mm_add_ps(sum, _mm_mul_ps(n, _mm_set1_ps(amp)));
+		freq *= settings.lacunarity;
+		amp *= settings.gain;
+	}
+	_mm_storeu_ps(result, sum);
+}
+
+#else
+
+static inline void fbm2_4(const float* x, const float* y, float* result, const NoiseSettings& settings) {
+	for(int l = 0; l < 4; ++l) {
+		result[l] = fbm2(x[l], y[l], settings);
+	}
+}
+
+static inline void fbm3_4(const float* x, const float* y, const float* z, float* result, const NoiseSettings& settings) {
+	for(int l = 0; l < 4; ++l) {
+		result[l] = fbm3(x[l], y[l], z[l], settings);
+	}
+}
+
+#endif
+
+// Tasks for parallelFor; arrays are processed in blocks of 4 points,
+// grids per row.
+struct NoiseArray2Task {
+	const float* x;
+	const float* y;
+	float* result;
+	size_t num;
+	const NoiseSettings* settings;
+
+	void operator()(size_t begin, size_t end) {
+		for(size_t b = begin; b < end; ++b) {
+			size_t dx = b * 4;
+			if(dx + 4 <= num) {
+				fbm2_4(x + dx, y + dx, result + dx, *settings);
+				continue;
+			}
+			float px[4] = {0}, py[4] = {0}, out[4];
+			for(size_t i = dx; i < num; ++i) {
+				px[i - dx] = x[i];
+				py[i - dx] = y[i];
+			}
+			fbm2_4(px, py, out, *settings);
+			for(size_t i = dx; i < num; ++i) {
+				result[i] = out[i - dx];
+			}
+		}
+	}
+};
+
+struct NoiseArray3Task {
+	const float* x;
+	const float* y;
+	const float* z;
+	float* result;
+	size_t num;
+	const NoiseSettings* settings;
+
+	void operator()(size_t begin, size_t end) {
+		for(size_t b = begin; b < end; ++b) {
+			size_t dx = b * 4;
+			if(dx + 4 <= num) {
+				fbm3_4(x + dx, y + dx, z + dx, result + dx, *settings);
+				continue;
+			}
+			float px[4] = {0}, py[4] = {0}, pz[4] = {0}, out[4];
+			for(size_t i = dx; i < num; ++i) {
+				px[i - dx] = x[i];
+				py[i - dx] = y[i];
+				pz[i - dx] = z[i];
+			}
+			fbm3_4(px, py, pz, out, *settings);
+			for(size_t i = dx; i < num; ++i) {
+				result[i] = out[i - dx];
+			}
+		}
+	}
+};
+
+struct NoiseGridTask {
+	float* result;
+	int width;
+	int height;
+	int depth;
+	float x0, y0, z0;
+	float step_x, step_y, step_z;
+	const NoiseSettings* settings;
+
+	void operator()(size_t begin, size_t end) {
+		float px[4], py[4], pz[4], out[4];
+		for(size_t row = begin; row < end; ++row) {
+			float* dest = result + row * width;
+			float y = y0 + (row % height) * step_y;
+			float z = z0 + (row / height) * step_z;
+			for(int l = 0; l < 4; ++l) {
+				py[l] = y;
+				pz[l] = z;
+			}
+			for(int i = 0; i < width; i += 4) {
+				for(int l = 0; l < 4; ++l) {
+					px[l] = x0 + (i + l) * step_x;
+				}
+				if(depth > 0) {
+					fbm3_4(px, py, pz, out, *settings);
+				}
+				else {
+					fbm2_4(px, py, out, *settings);
+				}
+				int n = std::min<int>(4, width - i);
+				for(int l = 0; l < n; ++l) {
+					dest[i + l] = out[l];
+				}
+			}
+		}
+	}
+};
+
+void noiseArray2(const float* x, const float* y, float* result, size_t num, const NoiseSettings& settings, int numThreads) {
+	NoiseArray2Task task;
+	task.x = x;
+	task.y = y;
+	task.result = result;
+	task.num = num;
+	task.settings = &settings;
+	parallelFor((num + 3) / 4, task, numThreads, 1024);
+}
+
+void noiseArray3(const float* x, const float* y, const float* z, float* result, size_t num, const NoiseSettings& settings, int numThreads) {
+	NoiseArray3Task task;
+	task.x = x;
+	task.y = y;
+	task.z = z;
+	task.result = result;
+	task.num = num;
+	task.settings = &settings;
+	parallelFor((num + 3) / 4, task, numThreads, 512);
+}
+
+void noiseGrid2(float* result, int width, int height, float x0, float y0, float stepX, float stepY, const NoiseSettings& settings, int numThreads) {
+	if(width <= 0 || height <= 0) {
+		return;
+	}
+	NoiseGridTask task;
+	task.result = result;
+	task.width = width;
+	task.height = height;
+	task.depth = 0;
+	task.x0 = x0;
+	task.y0 = y0;
+	task.z0 = 0.0f;
+	task.step_x = stepX;
+	task.step_y = stepY;
+	task.step_z = 0.0f;
+	task.settings = &settings;
+	parallelFor(height, task, numThreads, std::max<int>(1, 4096 / width));
+}
+
+void noiseGrid3(float* result, int width, int height, int depth, float x0, float y0, float z0, float stepX, float stepY, float stepZ, const NoiseSettings& settings, int numThreads) {
+	if(width <= 0 || height <= 0 || depth <= 0) {
+		return;
+	}
+	NoiseGridTask task;
+	task.result = result;
+	task.width = width;
+	task.height = height;
+	task.depth = depth;
+	task.x0 = x0;
+	task.y0 = y0;
+	task.z0 = z0;
+	task.step_x = stepX;
+	task.step_y = stepY;
+	task.step_z = stepZ;
+	task.settings = &settings;
+	parallelFor((size_t)height * depth, task, numThreads, std::max<int>(1, 2048 / width));
+}
+
 }; // roxlu
\ No newline at end of file
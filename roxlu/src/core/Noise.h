@@ -1,6 +1,7 @@
 #ifndef ROXLU_NOISEH
 #define ROXLU_NOISEH
 
+#include <stddef.h>
 #include "Vec2.h"
 
 namespace roxlu {
@@ -19,6 +20,45 @@ float fbm(const Vec2& v);
 }
 
 #endif
+
+// -----------------------------------------------------------------------------
+
+/**
+ * Batch evaluation of noise2/noise3 and fBm.
+ *
+ * The noiseArray* functions evaluate the points (x[i], y[i], z[i]), the
+ * noiseGrid* functions a regular grid which starts at (x0, y0, z0) with 
+ * the given step per cell; the result is stored row by row, slice by slice
+ * (result[(z * height + y) * width + x]). With the default settings you 
+ * get plain noise; set octaves > 1 for fBm: 
+ *
+ *		sum(amplitude * gain^o * noise(p * frequency * lacunarity^o))
+ *
+ * The points are evaluated 4 at a time (SSE2 when available) and the work
+ * is split over numThreads threads (0 = number of cores) by rows. Every
+ * point is evaluated with the same code, so the result does not depend on
+ * the number of threads. The result matches noise2()/noise3()/fbm() up to
+ * float rounding.
+ *
+ */
+struct NoiseSettings {
+	NoiseSettings();
+	int octaves;
+	float frequency;
+	float amplitude;
+	float lacunarity;
+	float gain;
+};
+
+float fbm2(float x, float y, const NoiseSettings& settings); // scalar reference
+float fbm3(float x, float y, float z, const NoiseSettings& settings);
+
+void noiseArray2(const float* x, const float* y, float* result, size_t num, const NoiseSettings& settings = NoiseSettings(), int numThreads = 0);
+void noiseArray3(const float* x, const float* y, const float* z, float* result, size_t num, const NoiseSettings& settings = NoiseSettings(), int numThreads = 0);
+
+void noiseGrid2(float* result, int width, int height, float x0, float y0, float stepX, float stepY, const NoiseSettings& settings = NoiseSettings(), int numThreads = 0);
+void noiseGrid3(float* result, int width, int height, int depth, float x0, float y0, float z0, float stepX, float stepY, float stepZ, const NoiseSettings& settings = NoiseSettings(), int numThreads = 0);
+
 }; // roxlu
 
 #endif
\ No newline at end of file
@@ -0,0 +1,72 @@
+#include "Parallel.h"
+#include <unistd.h>
+
+namespace roxlu {
+
+static pthread_once_t parallel_once = PTHREAD_ONCE_INIT;
+static pthread_key_t parallel_worker_key;
+static ThreadPool* parallel_pool = NULL;
+
+int getNumCores() {
+	static int num_cores = 0;
+	if(num_cores == 0) {
+		long n = sysconf(_SC_NPROCESSORS_ONLN);
+		num_cores = (n > 0) ? (int)n : 1;
+	}
+	return num_cores;
+}
+
+// The calling thread of parallelFor() does one range itself. The pool is
+// never deleted: its threads may still be in use while static objects
+// are destroyed.
+static void parallel_create_pool() {
+	pthread_key_create(&parallel_worker_key, NULL);
+	parallel_pool = new ThreadPool();
+	parallel_pool->start(std::max<int>(1, getNumCores() - 1));
+}
+
+ThreadPool& getParallelPool() {
+	pthread_once(&parallel_once, parallel_create_pool);
+	return *parallel_pool;
+}
+
+bool isParallelWorker() {
+	pthread_once(&parallel_once, parallel_create_pool);
+	return pthread_getspecific(parallel_worker_key) != NULL;
+}
+
+void markParallelWorker() {
+	pthread_setspecific(parallel_worker_key, (void*)1);
+}
+
+// ParallelJoin
+// -----------------------------------------------------------------------------
+ParallelJoin::ParallelJoin(int numTasks)
+	:num_tasks(numTasks)
+{
+	pthread_mutex_init(&mutex, NULL);
+	pthread_cond_init(&cond, NULL);
+}
+
+ParallelJoin::~ParallelJoin() {
+	pthread_cond_destroy(&cond);
+	pthread_mutex_destroy(&mutex);
+}
+
+void ParallelJoin::done() {
+	pthread_mutex_lock(&mutex);
+	if(--num_tasks == 0) {
+		pthread_cond_signal(&cond);
+	}
+	pthread_mutex_unlock(&mutex);
+}
+
+void ParallelJoin::wait() {
+	pthread_mutex_lock(&mutex);
+	while(num_tasks > 0) {
+		pthread_cond_wait(&cond, &mutex);
+	}
+	pthread_mutex_unlock(&mutex);
+}
+
+} // roxlu
@@ -0,0 +1,111 @@
+#ifndef ROXLU_PARALLELH
+#define ROXLU_PARALLELH
+
+#include <pthread.h>
+#include <vector>
+#include <stdlib.h>
+#include <algorithm>
+#include "ThreadPool.h"
+
+using std::vector;
+
+/**
+ * Very small helper to split a loop over a couple of threads.
+ *
+ * The task must be a functor with an "void operator()(size_t begin, size_t end)"
+ * which processes the elements [begin, end). Make sure the ranges can be 
+ * processed independently (i.e. only write to the elements in the range).
+ *
+ * 		struct ScaleTask {
+ *			float* values;
+ *			void operator()(size_t begin, size_t end) {
+ *				for(size_t i = begin; i < end; ++i) { values[i] *= 2.0f; }
+ *			}
+ *		};
+ *
+ *		ScaleTask task;
+ *		task.values = &values[0];
+ *		parallelFor(values.size(), task);
+ *
+ * When the number of elements is small (< minPerThread) the task is 
+ * executed on the calling thread.
+ *
+ * The ranges run on one shared ThreadPool (getNumCores() - 1 threads, 
+ * started on first use) and the calling thread does the last range, so
+ * a call doesn't create any threads. A parallelFor() from inside a task
+ * runs on the calling thread.
+ *
+ */
+namespace roxlu {
+
+int getNumCores();
+ThreadPool& getParallelPool(); // shared by all parallelFor() calls
+bool isParallelWorker(); // true on the threads of the parallel pool
+void markParallelWorker();
+
+// Waits until the ranges of one parallelFor() call are done.
+class ParallelJoin {
+public:
+	ParallelJoin(int numTasks);
+	~ParallelJoin();
+	void done();
+	void wait();
+
+private:
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	int num_tasks;
+};
+
+template<class T>
+struct ParallelRange : public ThreadTask {
+	void run() {
+		markParallelWorker();
+		(*task)(begin, end);
+		join->done();
+	}
+	T* task;
+	size_t begin;
+	size_t end;
+	ParallelJoin* join;
+};
+
+template<class T>
+void parallelFor(size_t num, T& task, int numThreads = 0, size_t minPerThread = 512) {
+	if(num == 0) {
+		return;
+	}
+	if(numThreads <= 0) {
+		numThreads = getNumCores();
+	}
+	size_t max_threads = (num + minPerThread - 1) / minPerThread;
+	if(max_threads < (size_t)numThreads) {
+		numThreads = max_threads;
+	}
+	if(numThreads <= 1 || isParallelWorker()) {
+		task(0, num);
+		return;
+	}
+	
+	ThreadPool& pool = getParallelPool();
+	ParallelJoin join(numThreads - 1);
+	vector<ParallelRange<T> > ranges(numThreads);
+	size_t per_thread = (num + numThreads - 1) / numThreads;
+	for(int i = 0; i < numThreads; ++i) {
+		ranges[i].task = &task;
+		ranges[i].begin = std::min<size_t>(num, i * per_thread);
+		ranges[i].end = std::min<size_t>(num, (i + 1) * per_thread);
+		ranges[i].join = &join;
+	}
+	
+	// last range is processed on the calling thread.
+	for(int i = 0; i < numThreads - 1; ++i) {
+		pool.add(&ranges[i]);
+	}
+	task(ranges.back().begin, ranges.back().end);
+	join.wait();
+}
+
+} // roxlu
+
+#endif
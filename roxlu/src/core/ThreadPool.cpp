@@ -0,0 +1,104 @@
+#include "ThreadPool.h"
+#include "Parallel.h"
+#include <stdio.h>
+
+namespace roxlu {
+
+ThreadPool::ThreadPool()
+	:num_busy(0)
+	,stopping(false)
+{
+	pthread_mutex_init(&mutex, NULL);
+	pthread_cond_init(&task_cond, NULL);
+	pthread_cond_init(&idle_cond, NULL);
+}
+
+ThreadPool::~ThreadPool() {
+	stop();
+	pthread_cond_destroy(&idle_cond);
+	pthread_cond_destroy(&task_cond);
+	pthread_mutex_destroy(&mutex);
+}
+
+bool ThreadPool::start(int numThreads) {
+	if(isStarted()) {
+		return true;
+	}
+	if(numThreads <= 0) {
+		numThreads = getNumCores();
+	}
+	stopping = false;
+	for(int i = 0; i < numThreads; ++i) {
+		pthread_t thread;
+		if(pthread_create(&thread, NULL, &ThreadPool::threadFunction, this) != 0) {
+			printf("ThreadPool: cannot create thread %d.\n", i);
+			break;
+		}
+		threads.push_back(thread);
+	}
+	return isStarted();
+}
+
+void ThreadPool::stop() {
+	if(!isStarted()) {
+		return;
+	}
+	pthread_mutex_lock(&mutex);
+	stopping = true;
+	pthread_cond_broadcast(&task_cond);
+	pthread_mutex_unlock(&mutex);
+
+	for(size_t i = 0; i < threads.size(); ++i) {
+		pthread_join(threads[i], NULL);
+	}
+	threads.clear();
+}
+
+// When the pool isn't started we execute the task right away.
+void ThreadPool::add(ThreadTask* task) {
+	if(!isStarted()) {
+		task->run();
+		return;
+	}
+	pthread_mutex_lock(&mutex);
+	tasks.push_back(task);
+	pthread_cond_signal(&task_cond);
+	pthread_mutex_unlock(&mutex);
+}
+
+void ThreadPool::wait() {
+	pthread_mutex_lock(&mutex);
+	while(tasks.size() || num_busy > 0) {
+		pthread_cond_wait(&idle_cond, &mutex);
+	}
+	pthread_mutex_unlock(&mutex);
+}
+
+void* ThreadPool::threadFunction(void* user) {
+	ThreadPool* pool = static_cast<ThreadPool*>(user);
+	pthread_mutex_lock(&pool->mutex);
+	while(true) {
+		while(!pool->tasks.size() && !pool->stopping) {
+			pthread_cond_wait(&pool->task_cond, &pool->mutex);
+		}
+		if(!pool->tasks.size()) {
+			break; // stopping and nothing left to do
+		}
+		ThreadTask* task = pool->tasks.front();
+		pool->tasks.pop_front();
+		++pool->num_busy;
+		pthread_mutex_unlock(&pool->mutex);
+
+		task->run();
+
+		pthread_mutex_lock(&pool->mutex);
+		--pool->num_busy;
+		if(!pool->tasks.size() && pool->num_busy == 0) {
+			pthread_cond_broadcast(&pool->idle_cond);
+		}
+	}
+	pthread_mutex_unlock(&pool->mutex);
+	return NULL;
+}
+
+} // roxlu
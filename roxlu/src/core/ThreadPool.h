@@ -0,0 +1,70 @@
+#ifndef ROXLU_THREADPOOLH
+#define ROXLU_THREADPOOLH
+
+#include <pthread.h>
+#include <vector>
+#include <deque>
+
+using std::vector;
+using std::deque;
+
+/**
+ * A fixed set of worker threads which execute tasks from a queue.
+ *
+ * Use this (instead of parallelFor) when you have a stream of independent
+ * jobs, e.g. encoding the frames of a movie while you're recording. The
+ * pool does not take ownership of the tasks; a task may not be deleted
+ * before run() returned. You can delete a task from inside its own run().
+ *
+ *		struct EncodeTask : public roxlu::ThreadTask {
+ *			void run() { ... }
+ *		};
+ *
+ *		roxlu::ThreadPool pool;
+ *		pool.start(4);
+ *		pool.add(&task);
+ *		pool.wait(); // blocks until all tasks are done
+ *
+ */
+namespace roxlu {
+
+class ThreadTask {
+public:
+	virtual ~ThreadTask() {}
+	virtual void run() = 0;
+};
+
+class ThreadPool {
+public:
+	ThreadPool();
+	~ThreadPool(); // calls stop()
+	bool start(int numThreads = 0); // 0 = number of cores
+	void stop(); // executes the queued tasks and joins the threads
+	void add(ThreadTask* task);
+	void wait();
+	inline bool isStarted() const;
+	inline size_t getNumThreads() const;
+
+private:
+	static void* threadFunction(void* user);
+
+	vector<pthread_t> threads;
+	deque<ThreadTask*> tasks;
+	pthread_mutex_t mutex;
+	pthread_cond_t task_cond; // a task was added or we stop
+	pthread_cond_t idle_cond; // all tasks are done
+	int num_busy;
+	bool stopping;
+};
+
+inline bool ThreadPool::isStarted() const {
+	return threads.size() > 0;
+}
+
+inline size_t ThreadPool::getNumThreads() const {
+	return threads.size();
+}
+
+} // roxlu
+
+#endif
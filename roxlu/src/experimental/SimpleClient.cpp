@@ -1,38 +1,48 @@
 #include "SimpleClient.h"
-#include "SimpleServer.h"
-
-// NO POCO, USE LIBEVENT
+#include "SimpleReactor.h"
+#include <unistd.h>
 
 namespace roxlu {
 
-//SimpleClient::SimpleClient(StreamSocket streamSocket, SocketReactor& socketReactor) 
-//	:sock(streamSocket)
-//	,reactor(socketReactor)
-//{
-//	reactor.addEventHandler(sock, NObserver<SimpleClient, ReadableNotification>(*this, &SimpleClient::onReadable));
-//	reactor.addEventHandler(sock, NObserver<SimpleClient, ShutdownNotification>(*this, &SimpleClient::onShutdown));
-//}
+SimpleClient::SimpleClient()
+	:sock(-1)
+	,reactor_index(0)
+	,server_index(0)
+	,reactor(NULL)
+	,is_dirty(false)
+	,is_ready(false)
+	,is_hup(false)
+	,read_loop(0)
+	,is_closing(false)
+	,is_closed(false)
+{
+}
 
 SimpleClient::~SimpleClient() {
-//	reactor.removeEventHandler(sock,NObserver<SimpleClient, ReadableNotification>(*this,&SimpleClient::onReadable));
-//	reactor.removeEventHandler(sock,NObserver<SimpleClient, ShutdownNotification>(*this,&SimpleClient::onShutdown));
+	if(sock >= 0) {
+		::close(sock);
+		sock = -1;
+	}
+}
+
+void SimpleClient::send(const char* data, size_t size) {
+	if(is_closing || is_closed || !size) {
+		return;
+	}
+	write_buffer.storeBytes(data, size);
+	reactor->requestFlush(this);
 }
 
-//void SimpleClient::onReadable(const AutoPtr<ReadableNotification>& pNotif) {
-//	char buf[1024];
-//	int read = sock.receiveBytes(buf, 1024);
-//	if(read > 0) {
-//		read_buffer.storeBytes(buf, read);
-//		onDataReceived();
-//	}
-//	else {
-//		delete this;
-//	}
-//}
-//
-//void SimpleClient::onShutdown(const AutoPtr<ShutdownNotification>& pNotif) {
-//	delete this;
-//}
+void SimpleClient::send(const string& data) {
+	send(data.data(), data.size());
+}
 
+void SimpleClient::close() {
+	if(is_closing || is_closed) {
+		return;
+	}
+	is_closing = true;
+	reactor->requestClose(this);
+}
 
-}; // roxlu
\ No newline at end of file
+}; // roxlu
@@ -1,50 +1,74 @@
 #ifndef SIMPLECLIENTH
 #define SIMPLECLIENTH
 
-// NO POCO!! Use i.e. LibEvent!!
-
-//#include "Poco/Net/SocketReactor.h"
-//#include "Poco/Net/SocketAcceptor.h"
-//#include "Poco/Net/SocketNotification.h"
-//#include "Poco/Net/StreamSocket.h"
-//#include "Poco/Net/ServerSocket.h"
-//#include "Poco/NObserver.h"
-//#include "Poco/Exception.h"
-//#include "Poco/Thread.h"
-//#include "Poco/AutoPtr.h"
-#include <iostream>
-#include "Roxlu.h"
-
-//using Poco::Net::SocketReactor;
-//using Poco::Net::SocketAcceptor;
-//using Poco::Net::ReadableNotification;
-//using Poco::Net::ShutdownNotification;
-//using Poco::Net::ServerSocket;
-//using Poco::Net::StreamSocket;
-//using Poco::Thread;
-//using Poco::NObserver;
-//using Poco::AutoPtr;
+#include <string>
+#include "IOBuffer.h"
+
+using std::string;
 
 namespace roxlu {
 
 template<typename C>
 class SimpleServer;
 
+class SimpleReactor;
+
+/**
+ * A connection of SimpleServer, see SimpleServer.h. All members are called
+ * on the thread of the reactor which owns the client; call send() and
+ * close() from onDataReceived() or a timer of the same reactor.
+ *
+ * send() doesn't write right away: everything which is sent during one
+ * round of the event loop is written with one write() at the end of the
+ * round (write coalescing). When the socket is full the rest is written
+ * when it's writeable again.
+ */
 class SimpleClient {
 public:
-//	SimpleClient(StreamSocket conSocket, SocketReactor& sockReactor);
-	~SimpleClient();
-	
-	//void onReadable(const AutoPtr<ReadableNotification>& pNotif);
-//	void onShutdown(const AutoPtr<ShutdownNotification>& pNotif);
-	
+	SimpleClient();
+	virtual ~SimpleClient(); // closes the socket
+
+	void send(const char* data, size_t size);
+	void send(const string& data);
+	void close(); // after the queued data is written
+	size_t getNumBytesToWrite();
+	int getSocket();
+	SimpleReactor* getReactor();
+
 protected:
-	virtual void onDataReceived() = 0;
-	
+	virtual void onDataReceived() = 0; // new data is in read_buffer; consume what you handled
+	virtual void onConnected() {}
+	virtual void onDisconnected() {} // the socket is closed, the client is deleted after this
+
 	IOBuffer read_buffer;
-//	StreamSocket sock;
-//	SocketReactor& reactor;
+	IOBuffer write_buffer;
+
+private:
+	friend class SimpleReactor;
+	template<typename C> friend class SimpleServer;
+	int sock;
+	size_t reactor_index; // in SimpleReactor::clients
+	size_t server_index; // in SimpleServer::clients
+	SimpleReactor* reactor;
+	bool is_dirty; // in the flush list of the reactor
+	bool is_ready; // in the read list of the reactor
+	bool is_hup; // the other side closed; read until recv() returns 0
+	uint64_t read_loop; // loop of the reactor in which we read from the ready list
+	bool is_closing;
+	bool is_closed;
 };
 
+inline size_t SimpleClient::getNumBytesToWrite() {
+	return GET_AVAILABLE_BYTES_COUNT(write_buffer);
+}
+
+inline int SimpleClient::getSocket() {
+	return sock;
+}
+
+inline SimpleReactor* SimpleClient::getReactor() {
+	return reactor;
+}
+
 }; // roxlu
-#endif
\ No newline at end of file
+#endif
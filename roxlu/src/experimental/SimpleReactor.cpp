@@ -0,0 +1,472 @@
+#include "SimpleReactor.h"
+#include "SimpleClient.h"
+
+#if defined(__linux__)
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <algorithm>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#ifndef SO_REUSEPORT
+#define SO_REUSEPORT 15
+#endif
+
+namespace roxlu {
+
+SimpleReactor::SimpleReactor(ISimpleClientFactory* factory)
+	:factory(factory)
+	,epoll_fd(-1)
+	,listen_fd(-1)
+	,wake_fd(-1)
+	,started(false)
+	,running(false)
+	,num_loops(0)
+	,timer_id(0)
+{
+	memset(&thread, 0, sizeof(thread));
+	pthread_mutex_init(&timer_mutex, NULL);
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if(epoll_fd < 0) {
+		printf("SimpleReactor: cannot create epoll: %s\n", strerror(errno));
+		return;
+	}
+	wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if(wake_fd < 0) {
+		printf("SimpleReactor: cannot create eventfd: %s\n", strerror(errno));
+		return;
+	}
+	epoll_event ev;
+	ev.events = EPOLLIN;
+	ev.data.ptr = &wake_fd;
+	epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &ev);
+}
+
+SimpleReactor::~SimpleReactor() {
+	stop();
+	while(clients.size()) {
+		close(clients.back());
+	}
+	for(size_t i = 0; i < dead.size(); ++i) {
+		delete dead[i];
+	}
+	dead.clear();
+	if(listen_fd >= 0) {
+		::close(listen_fd);
+	}
+	if(wake_fd >= 0) {
+		::close(wake_fd);
+	}
+	if(epoll_fd >= 0) {
+		::close(epoll_fd);
+	}
+	pthread_mutex_destroy(&timer_mutex);
+}
+
+bool SimpleReactor::listen(int port, bool reusePort) {
+	if(epoll_fd < 0 || wake_fd < 0) {
+		return false;
+	}
+	if(listen_fd >= 0) {
+		printf("SimpleReactor: error, already listening.\n");
+		return false;
+	}
+	listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if(listen_fd < 0) {
+		printf("SimpleReactor: cannot create socket: %s\n", strerror(errno));
+		return false;
+	}
+	int on = 1;
+	setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+	if(reusePort && setsockopt(listen_fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) != 0) {
+		printf("SimpleReactor: cannot set SO_REUSEPORT: %s\n", strerror(errno));
+	}
+
+	sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port = htons(port);
+	if(bind(listen_fd, (sockaddr*)&addr, sizeof(addr)) != 0 || ::listen(listen_fd, SOMAXCONN) != 0) {
+		printf("SimpleReactor: cannot listen on port %d: %s\n", port, strerror(errno));
+		::close(listen_fd);
+		listen_fd = -1;
+		return false;
+	}
+
+	epoll_event ev;
+	ev.events = EPOLLIN;
+	ev.data.ptr = &listen_fd;
+	epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev);
+	return true;
+}
+
+bool SimpleReactor::start() {
+	if(started) {
+		return true;
+	}
+	running = true;
+	if(pthread_create(&thread, NULL, &SimpleReactor::threadFunction, this) != 0) {
+		printf("SimpleReactor: cannot create thread.\n");
+		running = false;
+		return false;
+	}
+	started = true;
+	return true;
+}
+
+void SimpleReactor::stop() {
+	running = false;
+	wakeUp();
+	if(started) {
+		pthread_join(thread, NULL);
+		started = false;
+	}
+}
+
+void* SimpleReactor::threadFunction(void* user) {
+	SimpleReactor* reactor = static_cast<SimpleReactor*>(user);
+	reactor->loop();
+	return NULL;
+}
+
+bool SimpleReactor::isReactorThread() {
+	return running && pthread_equal(pthread_self(), thread);
+}
+
+void SimpleReactor::wakeUp() {
+	if(wake_fd < 0) {
+		return;
+	}
+	uint64_t one = 1;
+	if(write(wake_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+		printf("SimpleReactor: cannot wake up the reactor: %s\n", strerror(errno));
+	}
+}
+
+// Loop
+// -----------------------------------------------------------------------------
+void SimpleReactor::run() {
+	thread = pthread_self();
+	running = true;
+	loop();
+}
+
+void SimpleReactor::loop() {
+	epoll_event events[SIMPLE_REACTOR_MAX_EVENTS];
+	while(running) {
+		int timeout = runTimers();
+		if(ready.size()) {
+			timeout = 0;
+		}
+		int n = epoll_wait(epoll_fd, events, SIMPLE_REACTOR_MAX_EVENTS, timeout);
+		if(n < 0) {
+			if(errno == EINTR) {
+				continue;
+			}
+			printf("SimpleReactor: epoll_wait failed: %s\n", strerror(errno));
+			break;
+		}
+
+		// continue reading the clients which we stopped reading last time;
+		// these aren't read again for an event in the same loop.
+		++num_loops;
+		if(ready.size()) {
+			ready_next.swap(ready);
+			for(size_t i = 0; i < ready_next.size(); ++i) {
+				SimpleClient* client = ready_next[i];
+				client->is_ready = false;
+				if(!client->is_closed) {
+					client->read_loop = num_loops;
+					read(client);
+				}
+			}
+			ready_next.clear();
+		}
+
+		for(int i = 0; i < n; ++i) {
+			void* ptr = events[i].data.ptr;
+			if(ptr == &wake_fd) {
+				uint64_t value = 0;
+				if(::read(wake_fd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+					printf("SimpleReactor: cannot read the eventfd: %s\n", strerror(errno));
+				}
+				continue;
+			}
+			if(ptr == &listen_fd) {
+				accept();
+				continue;
+			}
+			SimpleClient* client = static_cast<SimpleClient*>(ptr);
+			if(client->is_closed) {
+				continue;
+			}
+			uint32_t flags = events[i].events;
+			if(flags & EPOLLERR) {
+				close(client);
+				continue;
+			}
+			if(flags & (EPOLLHUP | EPOLLRDHUP)) {
+				client->is_hup = true;
+			}
+			if((flags & (EPOLLIN | EPOLLHUP | EPOLLRDHUP)) && client->read_loop != num_loops) {
+				read(client);
+			}
+			if((flags & EPOLLOUT) && !client->is_closed && client->getNumBytesToWrite()) {
+				requestFlush(client);
+			}
+		}
+
+		flushAll();
+		for(size_t i = 0; i < dead.size(); ++i) {
+			delete dead[i];
+		}
+		dead.clear();
+	}
+}
+
+void SimpleReactor::accept() {
+	while(true) {
+		int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if(fd < 0) {
+			if(errno == EINTR) {
+				continue;
+			}
+			if(errno != EAGAIN && errno != EWOULDBLOCK) {
+				printf("SimpleReactor: cannot accept: %s\n", strerror(errno));
+			}
+			return;
+		}
+
+		// we coalesce the writes ourself
+		int on = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+		SimpleClient* client = factory->createClient();
+		if(client == NULL) {
+			printf("SimpleReactor: the factory didn't create a client.\n");
+			::close(fd);
+			continue;
+		}
+		client->sock = fd;
+		client->reactor = this;
+		client->reactor_index = clients.size();
+		clients.push_back(client);
+
+		// edge triggered; EPOLLOUT only fires when a full socket becomes writeable
+		epoll_event ev;
+		ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+		ev.data.ptr = client;
+		if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+			printf("SimpleReactor: cannot add client to epoll: %s\n", strerror(errno));
+			clients.pop_back();
+			delete client;
+			continue;
+		}
+		factory->addClient(client);
+		client->onConnected();
+	}
+}
+
+// Reads until the socket is drained (a short read), or until we've read
+// SIMPLE_REACTOR_MAX_READ; then the client continues in the next loop.
+// When the other side closed, the last data and the FIN can come with one
+// edge, so then we read until recv() returns 0.
+void SimpleReactor::read(SimpleClient* client) {
+	IOBuffer& buf = client->read_buffer;
+	size_t total = 0;
+	while(true) {
+		buf.ensureSize(SIMPLE_REACTOR_READ_SIZE);
+		uint32_t space = buf.size - buf.published;
+		ssize_t n = recv(client->sock, buf.getStorePtr(), space, 0);
+		if(n > 0) {
+			buf.addNumBytesStored(n);
+			total += n;
+			if((uint32_t)n < space && !client->is_hup) {
+				break;
+			}
+			if(total >= SIMPLE_REACTOR_MAX_READ) {
+				if(!client->is_ready) {
+					client->is_ready = true;
+					ready.push_back(client);
+				}
+				break;
+			}
+			continue;
+		}
+		if(n == 0) {
+			// the other side closed; handle what we got first
+			if(total) {
+				client->onDataReceived();
+			}
+			close(client);
+			return;
+		}
+		if(errno == EINTR) {
+			continue;
+		}
+		if(errno == EAGAIN || errno == EWOULDBLOCK) {
+			break;
+		}
+		close(client);
+		return;
+	}
+	if(total) {
+		client->onDataReceived();
+	}
+}
+
+// Returns false when the client was closed.
+bool SimpleReactor::flush(SimpleClient* client) {
+	IOBuffer& buf = client->write_buffer;
+	while(GET_AVAILABLE_BYTES_COUNT(buf)) {
+		ssize_t n = ::send(client->sock, GET_IB_POINTER(buf), GET_AVAILABLE_BYTES_COUNT(buf), MSG_NOSIGNAL);
+		if(n > 0) {
+			buf.ignore(n);
+			continue;
+		}
+		if(n < 0 && errno == EINTR) {
+			continue;
+		}
+		if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			return true; // EPOLLOUT tells us when we can write again
+		}
+		close(client);
+		return false;
+	}
+	return true;
+}
+
+void SimpleReactor::requestFlush(SimpleClient* client) {
+	if(client->is_dirty) {
+		return;
+	}
+	client->is_dirty = true;
+	dirty.push_back(client);
+}
+
+void SimpleReactor::requestClose(SimpleClient* client) {
+	requestFlush(client);
+}
+
+// One write per client for everything it sent during this loop.
+void SimpleReactor::flushAll() {
+	for(size_t i = 0; i < dirty.size(); ++i) {
+		SimpleClient* client = dirty[i];
+		client->is_dirty = false;
+		if(client->is_closed) {
+			continue;
+		}
+		if(flush(client) && client->is_closing && !client->getNumBytesToWrite()) {
+			close(client);
+		}
+	}
+	dirty.clear();
+}
+
+// The client is deleted at the end of the loop iteration because it may
+// still be in one of the event lists.
+void SimpleReactor::close(SimpleClient* client) {
+	if(client->is_closed) {
+		return;
+	}
+	client->is_closed = true;
+	if(client->is_ready) {
+		// it's deleted before the next loop, so it can't stay on the ready list
+		vector<SimpleClient*>::iterator it = std::find(ready.begin(), ready.end(), client);
+		if(it != ready.end()) {
+			*it = ready.back();
+			ready.pop_back();
+		}
+		client->is_ready = false;
+	}
+	epoll_ctl(epoll_fd, EPOLL_CTL_DEL, client->sock, NULL);
+	::close(client->sock);
+	client->sock = -1;
+
+	size_t dx = client->reactor_index;
+	clients[dx] = clients.back();
+	clients[dx]->reactor_index = dx;
+	clients.pop_back();
+
+	client->onDisconnected();
+	factory->removeClient(client);
+	dead.push_back(client);
+}
+
+// Timers
+// -----------------------------------------------------------------------------
+int SimpleReactor::addTimer(ISimpleTimerListener* listener, uint64_t millis, bool repeat) {
+	SimpleTimer timer;
+	timer.interval = (millis) ? millis : 1;
+	timer.at = now() + timer.interval;
+	timer.repeat = repeat;
+	timer.listener = listener;
+	pthread_mutex_lock(&timer_mutex);
+	timer.id = ++timer_id;
+	timers[timer.id] = timer;
+	timer_queue.insert(std::make_pair(timer.at, timer.id));
+	pthread_mutex_unlock(&timer_mutex);
+	if(!isReactorThread()) {
+		wakeUp();
+	}
+	return timer.id;
+}
+
+void SimpleReactor::removeTimer(int id) {
+	pthread_mutex_lock(&timer_mutex);
+	timers.erase(id);
+	pthread_mutex_unlock(&timer_mutex);
+}
+
+// Fires the timers which are due; the listeners are called without the
+// lock so they can add and remove timers.
+int SimpleReactor::runTimers() {
+	pthread_mutex_lock(&timer_mutex);
+	uint64_t t = now();
+	while(timer_queue.size() && timer_queue.begin()->first <= t) {
+		uint64_t at = timer_queue.begin()->first;
+		int id = timer_queue.begin()->second;
+		timer_queue.erase(timer_queue.begin());
+		map<int, SimpleTimer>::iterator it = timers.find(id);
+		if(it == timers.end() || it->second.at != at) {
+			continue;
+		}
+		ISimpleTimerListener* listener = it->second.listener;
+		if(it->second.repeat) {
+			it->second.at = (at + it->second.interval > t) ? at + it->second.interval : t + it->second.interval;
+			timer_queue.insert(std::make_pair(it->second.at, id));
+		}
+		else {
+			timers.erase(it);
+		}
+		pthread_mutex_unlock(&timer_mutex);
+		listener->onTimer(id);
+		pthread_mutex_lock(&timer_mutex);
+		t = now();
+	}
+	int timeout = -1;
+	if(timer_queue.size()) {
+		uint64_t wait = timer_queue.begin()->first - t;
+		timeout = (wait > 60000) ? 60000 : (int)wait;
+	}
+	pthread_mutex_unlock(&timer_mutex);
+	return timeout;
+}
+
+uint64_t SimpleReactor::now() {
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return uint64_t(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+} // roxlu
+
+#endif // __linux__
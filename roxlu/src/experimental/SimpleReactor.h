@@ -0,0 +1,118 @@
+#ifndef ROXLU_SIMPLEREACTORH
+#define ROXLU_SIMPLEREACTORH
+
+#include <stdint.h>
+#include <pthread.h>
+#include <vector>
+#include <map>
+
+#define SIMPLE_REACTOR_MAX_EVENTS 256
+#define SIMPLE_REACTOR_READ_SIZE (16 * 1024) // free space we make in the read buffer before reading
+#define SIMPLE_REACTOR_MAX_READ (256 * 1024) // per client per loop, so one fast sender can't starve the others
+
+using std::vector;
+using std::map;
+using std::multimap;
+
+/**
+ * One epoll loop (Linux) for SimpleServer. The reactor accepts the
+ * connections of its listening socket, reads into the read_buffer of the
+ * clients (edge triggered, until the socket is drained), writes the data
+ * which the clients queued with send() and runs timers.
+ *
+ * All callbacks of a reactor (onDataReceived, onConnected, onDisconnected,
+ * onTimer) are called on the thread of the reactor. SimpleServer starts
+ * one reactor per core when asked; they all listen on the same port with
+ * SO_REUSEPORT and the kernel spreads the connections over them.
+ *
+ * Timers:
+ * -------
+ *		class App : public ISimpleTimerListener {
+ *			void onTimer(int id) { ... }
+ *		};
+ *		int id = server.addTimer(&app, 1000, true); // every second
+ *		server.removeTimer(id);
+ */
+namespace roxlu {
+
+class SimpleClient;
+
+class ISimpleClientFactory {
+public:
+	virtual ~ISimpleClientFactory() {}
+	virtual SimpleClient* createClient() = 0;
+	virtual void addClient(SimpleClient* client) = 0; // called after the client is connected
+	virtual void removeClient(SimpleClient* client) = 0; // called before the client is deleted
+};
+
+class ISimpleTimerListener {
+public:
+	virtual ~ISimpleTimerListener() {}
+	virtual void onTimer(int id) = 0;
+};
+
+struct SimpleTimer {
+	int id;
+	uint64_t at; // millis, SimpleReactor::now()
+	uint64_t interval;
+	bool repeat;
+	ISimpleTimerListener* listener;
+};
+
+class SimpleReactor {
+public:
+	SimpleReactor(ISimpleClientFactory* factory);
+	~SimpleReactor(); // calls stop() and closes all clients
+	bool listen(int port, bool reusePort);
+	bool start(); // starts the thread
+	void stop();
+	void run(); // runs the loop on the calling thread until stop(), instead of start()
+	bool isReactorThread();
+	int addTimer(ISimpleTimerListener* listener, uint64_t millis, bool repeat); // any thread
+	void removeTimer(int id); // any thread; from another thread the timer may still fire once
+	size_t getNumClients();
+	static uint64_t now(); // millis
+
+	// used by SimpleClient
+	void requestFlush(SimpleClient* client);
+	void requestClose(SimpleClient* client);
+
+private:
+	static void* threadFunction(void* user);
+	void loop();
+	void wakeUp();
+	void accept();
+	void read(SimpleClient* client);
+	bool flush(SimpleClient* client);
+	void close(SimpleClient* client);
+	int runTimers(); // returns the epoll timeout
+	void flushAll();
+
+	ISimpleClientFactory* factory;
+	int epoll_fd;
+	int listen_fd;
+	int wake_fd; // eventfd
+	pthread_t thread;
+	bool started;
+	volatile bool running;
+	vector<SimpleClient*> clients;
+	vector<SimpleClient*> dirty; // clients with data to write or which must be closed
+	vector<SimpleClient*> ready; // clients which still had data after SIMPLE_REACTOR_MAX_READ
+	vector<SimpleClient*> ready_next;
+	vector<SimpleClient*> dead; // deleted at the end of the loop iteration
+	uint64_t num_loops;
+
+	pthread_mutex_t timer_mutex;
+	map<int, SimpleTimer> timers;
+	multimap<uint64_t, int> timer_queue; // by time; stale entries are skipped
+	int timer_id;
+};
+
+// Not locked; from another thread this is a rough number.
+inline size_t SimpleReactor::getNumClients() {
+	return clients.size();
+}
+
+} // roxlu
+
+#endif
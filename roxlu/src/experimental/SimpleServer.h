@@ -2,22 +2,19 @@
 #define SIMPLESERVERH
 
 /**
- * Very simple, fast TCP server implementation which can handles hundreds
- * of simultanious connected clients. To use this, you extends the SimpleClient
- * and inherit some abstract member functions which are called automagically.
- * 
+ * Very simple, fast TCP server implementation which can handle thousands
+ * of simultanious connected clients (epoll, Linux). To use this, you extend
+ * SimpleClient and implement onDataReceived() which is called automagically.
+ *
  * Example: Extending the simple client
  * -------------------------------------
 	 class iPhoneClient : public SimpleClient {
-		public:	
-			iPhoneClient(StreamSocket conSocket, SocketReactor& sockReactor)
-				:SimpleClient(conSocket, sockReactor)
-			{
+		protected:
+			virtual void onDataReceived() {
+				uint32_t num = GET_AVAILABLE_BYTES_COUNT(read_buffer);
+				send((const char*)GET_IB_POINTER(read_buffer), num); // echo
+				read_buffer.ignore(num);
 			}
-			
-
-		protected: 
-			virtual void onDataReceived();
 	};
  * -------------------------------------
  *
@@ -27,149 +24,155 @@
  * To create an instance of this simple server use this:
  * ----------------------------------------------------
  * SimpleServer<iPhoneClient> server;
- * server.setup(1234); // set port
+ * server.setup(1234); // set port; setup(1234, 0) starts one reactor per core
  * server.start();
+ *
+ * With more then one reactor every reactor has its own thread and listening
+ * socket (SO_REUSEPORT); a client stays on the reactor which accepted it.
+ * The clients are called on the thread of their reactor, so guard data
+ * which is shared between clients. See SimpleReactor for timers.
+ *
+ * Linux only: SimpleReactor uses epoll and is not compiled on other
+ * platforms (there is no kqueue version yet); using SimpleServer there
+ * gives a compile error.
  */
 
-// NO POCO!! USE LIBEVENT
-
-//#include "Poco/Thread.h"
-//#include "Poco/Net/SocketNotification.h"
-//#include "Poco/Net/ServerSocket.h"
-//#include "Poco/Net/StreamSocket.h"
-//#include "Poco/Net/SocketReactor.h"
-//#include "Poco/Net/SocketAcceptor.h"
-//#include "Poco/Net/socketAddress.h"
-//#include "Poco/Mutex.h"
-//#include "Poco/Runnable.h"
-//#include "Poco/NObserver.h"
-//#include "Poco/AutoPtr.h"
-
 #include <vector>
 #include <string>
+#include <pthread.h>
+#include "SimpleReactor.h"
+#include "SimpleClient.h"
+#include "Parallel.h"
 
-//using Poco::Net::ReadableNotification;
-//using Poco::Net::ShutdownNotification;
-//using Poco::Thread;
-//using Poco::Mutex;
-//using Poco::Runnable;
-//using Poco::Net::ServerSocket;
-//using Poco::Net::StreamSocket;
-//using Poco::Net::SocketAddress;
-//using Poco::Net::SocketReactor;
-//using Poco::Net::SocketAcceptor;
-//using Poco::Net::IPAddress;
-//using Poco::NObserver;
-//using Poco::AutoPtr;
 using std::string;
 using std::vector;
 
 namespace roxlu {
 
-template <typename C>
-class SimpleAcceptor;
-
 // TCP server
 // --------------------
 template <typename T>
-class SimpleServer {
+class SimpleServer : public ISimpleClientFactory {
 public:
 	typedef T SimpleServerType;
-	
-	SimpleServer() 
-//		:server_port(0)
-//		,server_socket(NULL)
-//		,server_reactor(NULL)
-//		,server_address(NULL)
+#if !defined(__linux__)
+	typedef char simple_server_needs_linux_epoll[sizeof(T) == 0 ? 1 : -1];
+#endif
+
+	SimpleServer()
+		:server_port(0)
+		,num_reactors(1)
 	{
+		pthread_mutex_init(&mutex, NULL);
 	}
-	
 
 	~SimpleServer() {
+		stop();
+		pthread_mutex_destroy(&mutex);
 	}
-	
-	void setup(int port) {
+
+	// numReactors: 0 = one per core
+	void setup(int port, int numReactors = 1) {
 		server_port = port;
+		num_reactors = (numReactors > 0) ? numReactors : getNumCores();
+	}
+
+	bool start() {
+		if(reactors.size()) {
+			printf("SimpleServer: error, already started.\n");
+			return false;
+		}
+		for(int i = 0; i < num_reactors; ++i) {
+			SimpleReactor* reactor = new SimpleReactor(this);
+			reactors.push_back(reactor);
+			if(!reactor->listen(server_port, num_reactors > 1) || !reactor->start()) {
+				stop();
+				return false;
+			}
+		}
+		return true;
 	}
-	
-	void start() {
-//		if(server_socket != NULL) {
-//			printf("SimpleServer: error, already created a socket.\n");
-//			return;
-//		}
-//		
-//		IPAddress wildcard_address;
-//		server_address = new SocketAddress(wildcard_address, server_port);
-//		server_socket = new ServerSocket(*server_address);
-//		server_reactor = new SocketReactor();
-//		server_acceptor = new SimpleAcceptor<T>(*server_socket, *server_reactor, this);
-//		
-//		server_reactor->addEventHandler(*server_socket, NObserver<SimpleServer, ReadableNotification>(*this, &SimpleServer::onReadable));
-//		server_reactor->addEventHandler(*server_socket, NObserver<SimpleServer, ShutdownNotification>(*this, &SimpleServer::onShutdown));
-//		
-//		reactor_thread = new Thread();
-//		reactor_thread->start(*server_reactor);
+
+	// Closes all clients.
+	void stop() {
+		for(size_t i = 0; i < reactors.size(); ++i) {
+			reactors[i]->stop();
+		}
+		for(size_t i = 0; i < reactors.size(); ++i) {
+			delete reactors[i];
+		}
+		reactors.clear();
 	}
-//	
-//	void onReadable(const AutoPtr<ReadableNotification>& pNotif) {
-//	}
-//
-//	void onShutdown(const AutoPtr<ShutdownNotification>& pNotif) {
-//		printf("onShutdown socket reactor.\n");
-//	}
-
-	void addClient(T* client) {
-//		mutex.lock();
-//		clients.push_back(client);
-//		mutex.unlock();
+
+	// The timer runs on the first reactor.
+	int addTimer(ISimpleTimerListener* listener, uint64_t millis, bool repeat) {
+		if(!reactors.size()) {
+			printf("SimpleServer: start() before adding timers.\n");
+			return -1;
+		}
+		return reactors[0]->addTimer(listener, millis, repeat);
 	}
-	
-	void removeClient(T* client) {
-//		mutex.lock();
-//		typename vector<T*>::iterator it = std::find(clients.begin(), clients.end(), client);
-//		if(it != clients.end()) {
-//			clients.erase(it);
-//			printf("SimpleServer: removed client.\n");
-//		}
-//		mutex.unlock();
-//
+
+	void removeTimer(int id) {
+		if(reactors.size()) {
+			reactors[0]->removeTimer(id);
+		}
 	}
-	
+
+	SimpleClient* createClient() {
+		return new T();
+	}
+
+	void addClient(SimpleClient* client) {
+		pthread_mutex_lock(&mutex);
+		client->server_index = clients.size();
+		clients.push_back(static_cast<T*>(client));
+		pthread_mutex_unlock(&mutex);
+	}
+
+	void removeClient(SimpleClient* client) {
+		pthread_mutex_lock(&mutex);
+		size_t dx = client->server_index;
+		if(dx < clients.size() && clients[dx] == client) {
+			clients[dx] = clients.back();
+			clients[dx]->server_index = dx;
+			clients.pop_back();
+		}
+		pthread_mutex_unlock(&mutex);
+	}
+
+	// Clients aren't deleted while you hold the lock:
+	//   server.lockClients();
+	//   vector<T*>& clients = server.getClients();
+	//   ...
+	//   server.unlockClients();
+	void lockClients() {
+		pthread_mutex_lock(&mutex);
+	}
+
+	void unlockClients() {
+		pthread_mutex_unlock(&mutex);
+	}
+
 	vector<T*>& getClients() {
 		return clients;
 	}
-	
+
+	size_t getNumClients() {
+		pthread_mutex_lock(&mutex);
+		size_t num = clients.size();
+		pthread_mutex_unlock(&mutex);
+		return num;
+	}
+
 private:
 	int server_port;
-//	ServerSocket* server_socket;
-//	SocketReactor* server_reactor;
-//	SocketAddress* server_address;
-//	Mutex mutex;
-//	Thread* reactor_thread;
-//	SocketAcceptor<T>* server_acceptor;
+	int num_reactors;
+	vector<SimpleReactor*> reactors;
+	pthread_mutex_t mutex;
 	vector<T*> clients;
 };
 
-
-// connection acceptor
-// --------------------
-//template <typename T>
-//class SimpleAcceptor : public SocketAcceptor<T> {
-//public:
-//	SimpleAcceptor(ServerSocket& socket, SocketReactor& reactor, SimpleServer<T>* server)
-//		:SocketAcceptor<T>(socket, reactor)
-//		,simple_server(server)
-//	{
-//	}
-//	SimpleServer<T>* simple_server;
-//protected:
-//		virtual T* createServiceHandler(StreamSocket& sock) {
-//			T* obj = new T(sock, *(SocketAcceptor<T>::reactor()));
-//			simple_server->addClient(obj);
-//			return obj;
-//	}
-//};
-
 }; // roxlu
 
 #endif
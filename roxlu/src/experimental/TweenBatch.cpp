@@ -0,0 +1,427 @@
+#include "TweenBatch.h"
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Easing functions on the normalized position p [0, 1] -> [0, 1]. Every
+// easing is a functor so the loops below are instantiated (and inlined)
+// per easing type.
+// -----------------------------------------------------------------------------
+#define TWEEN_BACK_S 1.70158f
+#define TWEEN_BACK_S2 (1.70158f * 1.525f)
+
+static inline float tween_out_bounce(float p) {
+	if(p < (1.0f / 2.75f)) {
+		return 7.5625f * p * p;
+	}
+	else if(p < (2.0f / 2.75f)) {
+		p -= (1.5f / 2.75f);
+		return 7.5625f * p * p + 0.75f;
+	}
+	else if(p < (2.5f / 2.75f)) {
+		p -= (2.25f / 2.75f);
+		return 7.5625f * p * p + 0.9375f;
+	}
+	p -= (2.625f / 2.75f);
+	return 7.5625f * p * p + 0.984375f;
+}
+
+struct TweenLinear { static inline float ease(float p) { return p; } };
+
+struct TweenInQuad { static inline float ease(float p) { return p * p; } };
+struct TweenOutQuad { static inline float ease(float p) { return -p * (p - 2.0f); } };
+struct TweenInOutQuad { static inline float ease(float p) {
+	float t = p * 2.0f;
+	float u = t - 1.0f;
+	return (t < 1.0f) ? 0.5f * t * t : -0.5f * (u * (u - 2.0f) - 1.0f);
+} };
+
+struct TweenInCubic { static inline float ease(float p) { return p * p * p; } };
+struct TweenOutCubic { static inline float ease(float p) { float t = p - 1.0f; return t * t * t + 1.0f; } };
+struct TweenInOutCubic { static inline float ease(float p) {
+	float t = p * 2.0f;
+	float u = t - 2.0f;
+	return (t < 1.0f) ? 0.5f * t * t * t : 0.5f * (u * u * u + 2.0f);
+} };
+
+struct TweenInQuart { static inline float ease(float p) { return p * p * p * p; } };
+struct TweenOutQuart { static inline float ease(float p) { float t = p - 1.0f; return -(t * t * t * t - 1.0f); } };
+struct TweenInOutQuart { static inline float ease(float p) {
+	float t = p * 2.0f;
+	float u = t - 2.0f;
+	return (t < 1.0f) ? 0.5f * t * t * t * t : -0.5f * (u * u * u * u - 2.0f);
+} };
+
+struct TweenInQuint { static inline float ease(float p) { return p * p * p * p * p; } };
+struct TweenOutQuint { static inline float ease(float p) { float t = p - 1.0f; return t * t * t * t * t + 1.0f; } };
+struct TweenInOutQuint { static inline float ease(float p) {
+	float t = p * 2.0f;
+	float u = t - 2.0f;
+	return (t < 1.0f) ? 0.5f * t * t * t * t * t : 0.5f * (u * u * u * u * u + 2.0f);
+} };
+
+struct TweenInExpo { static inline float ease(float p) { return exp2f(10.0f * (p - 1.0f)); } };
+struct TweenOutExpo { static inline float ease(float p) { return 1.0f - exp2f(-10.0f * p); } };
+struct TweenInOutExpo { static inline float ease(float p) {
+	float t = p * 2.0f - 1.0f;
+	return (t < 0.0f) ? 0.5f * exp2f(10.0f * t) : 0.5f * (2.0f - exp2f(-10.0f * t));
+} };
+
+struct TweenInCirc { static inline float ease(float p) { return 1.0f - sqrtf(1.0f - p * p); } };
+struct TweenOutCirc { static inline float ease(float p) { float t = p - 1.0f; return sqrtf(1.0f - t * t); } };
+struct TweenInOutCirc { static inline float ease(float p) {
+	float t = p * 2.0f;
+	float u = t - 2.0f;
+	return (t < 1.0f) ? -0.5f * (sqrtf(1.0f - t * t) - 1.0f) : 0.5f * (sqrtf(std::max<float>(0.0f, 1.0f - u * u)) + 1.0f);
+} };
+
+struct TweenInSine { static inline float ease(float p) { return 1.0f - cosf(p * (float)HALF_PI); } };
+struct TweenOutSine { static inline float ease(float p) { return sinf(p * (float)HALF_PI); } };
+struct TweenInOutSine { static inline float ease(float p) { return -0.5f * (cosf((float)PI * p) - 1.0f); } };
+
+struct TweenInBack { static inline float ease(float p) { return p * p * ((TWEEN_BACK_S + 1.0f) * p - TWEEN_BACK_S); } };
+struct TweenOutBack { static inline float ease(float p) { float t = p - 1.0f; return t * t * ((TWEEN_BACK_S + 1.0f) * t + TWEEN_BACK_S) + 1.0f; } };
+struct TweenInOutBack { static inline float ease(float p) {
+	float t = p * 2.0f;
+	float u = t - 2.0f;
+	return (t < 1.0f)
+		? 0.5f * (t * t * ((TWEEN_BACK_S2 + 1.0f) * t - TWEEN_BACK_S2))
+		: 0.5f * (u * u * ((TWEEN_BACK_S2 + 1.0f) * u + TWEEN_BACK_S2) + 2.0f);
+} };
+
+// period 0.3, shifted by period / 4 like in Tween
+struct TweenInElastic { static inline float ease(float p) {
+	float t = p - 1.0f;
+	return -(exp2f(10.0f * t) * sinf((t - 0.075f) * (float)TWO_PI / 0.3f));
+} };
+struct TweenOutElastic { static inline float ease(float p) {
+	return exp2f(-10.0f * p) * sinf((p - 0.075f) * (float)TWO_PI / 0.3f) + 1.0f;
+} };
+struct TweenInOutElastic { static inline float ease(float p) {
+	float t = p * 2.0f - 1.0f;
+	float s = sinf((t - 0.1125f) * (float)TWO_PI / 0.45f);
+	return (t < 0.0f) ? -0.5f * exp2f(10.0f * t) * s : 0.5f * exp2f(-10.0f * t) * s + 1.0f;
+} };
+
+struct TweenInBounce { static inline float ease(float p) { return 1.0f - tween_out_bounce(1.0f - p); } };
+struct TweenOutBounce { static inline float ease(float p) { return tween_out_bounce(p); } };
+struct TweenInOutBounce { static inline float ease(float p) {
+	return (p < 0.5f) ? 0.5f - 0.5f * tween_out_bounce(1.0f - p * 2.0f) : 0.5f * tween_out_bounce(p * 2.0f - 1.0f) + 0.5f;
+} };
+
+template<class T>
+static void tween_ease(float* p, size_t num) {
+	for(size_t i = 0; i < num; ++i) {
+		p[i] = T::ease(p[i]);
+	}
+}
+
+// Explicit SSE2 versions of the polynomial easings, 4 tweens at a time.
+// The others (expo, circ, sine, back, elastic, bounce) use tween_ease()
+// which stays scalar: libm calls and branches keep the compiler from
+// vectorizing those loops.
+#if defined(__SSE2__)
+
+static inline __m128 tween_select4(__m128 mask, __m128 a, __m128 b) {
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+struct TweenInQuad4 { static inline __m128 ease(__m128 p) { return _mm_mul_ps(p, p); } };
+struct TweenOutQuad4 { static inline __m128 ease(__m128 p) {
+	return _mm_mul_ps(p, _mm_sub_ps(_mm_set1_ps(2.0f), p));
+} };
+struct TweenInOutQuad4 { static inline __m128 ease(__m128 p) {
+	__m128 t = _mm_add_ps(p, p);
+	__m128 u = _mm_sub_ps(t, _mm_set1_ps(1.0f));
+	__m128 in = _mm_mul_ps(_mm_set1_ps(0.5f), _mm_mul_ps(t, t));
+	__m128 out = _mm_mul_ps(_mm_set1_ps(-0.5f), _mm_sub_ps(_mm_mul_ps(u, _mm_sub_ps(u, _mm_set1_ps(2.0f))), _mm_set1_ps(1.0f)));
+	return tween_select4(_mm_cmplt_ps(t, _mm_set1_ps(1.0f)), in, out);
+} };
+
+struct TweenInCubic4 { static inline __m128 ease(__m128 p) { return _mm_mul_ps(_mm_mul_ps(p, p), p); } };
+struct TweenOutCubic4 { static inline __m128 ease(__m128 p) {
+	__m128 t = _mm_sub_ps(p, _mm_set1_ps(1.0f));
+	return _mm_add_ps(_mm_mul_ps(_mm_mul_ps(t, t), t), _mm_set1_ps(1.0f));
+} };
+struct TweenInOutCubic4 { static inline __m128 ease(__m128 p) {
+	__m128 t = _mm_add_ps(p, p);
+	__m128 u = _mm_sub_ps(t, _mm_set1_ps(2.0f));
+	__m128 in = _mm_mul_ps(_mm_set1_ps(0.5f), _mm_mul_ps(_mm_mul_ps(t, t), t));
+	__m128 out = _mm_mul_ps(_mm_set1_ps(0.5f), _mm_add_ps(_mm_mul_ps(_mm_mul_ps(u, u), u), _mm_set1_ps(2.0f)));
+	return tween_select4(_mm_cmplt_ps(t, _mm_set1_ps(1.0f)), in, out);
+} };
+
+template<class T4, class T>
+static void tween_ease_sse(float* p, size_t num) {
+	size_t i = 0;
+	for(; i + 4 <= num; i += 4) {
+		_mm_storeu_ps(p + i, T4::ease(_mm_loadu_ps(p + i)));
+	}
+	for(; i < num; ++i) {
+		p[i] = T::ease(p[i]);
+	}
+}
+
+#define TWEEN_EASE_SSE(T) tween_ease_sse<T##4, T>
+#else
+#define TWEEN_EASE_SSE(T) tween_ease<T>
+#endif
+
+// -----------------------------------------------------------------------------
+
+TweenBatch::TweenBatch()
+	:time_base(now())
+	,num_tweens(0)
+{
+	for(int i = 0; i < TWEENBATCH_NUM_TYPES; ++i) {
+		groups[i].num_targets = 0;
+	}
+}
+
+uint64_t TweenBatch::now() {
+	timeval time;
+	gettimeofday(&time, NULL);
+	uint64_t n = time.tv_usec;
+	n /= 1000;
+	n += (time.tv_sec * 1000);
+	return n;
+}
+
+TweenHandle TweenBatch::start(float fromValue, float toValue, uint64_t millis, uint64_t delay, int type, float* target) {
+	if(type < 0 || type >= TWEENBATCH_NUM_TYPES) {
+		printf("TweenBatch: unknown type: %d\n", type);
+		return TWEENBATCH_INVALID_HANDLE;
+	}
+	uint64_t n = now();
+	if(n < time_base) {
+		rebase(n);
+	}
+	uint32_t slot;
+	if(free_slots.size()) {
+		slot = free_slots.back();
+		free_slots.pop_back();
+	}
+	else {
+		slot = slots.size();
+		Slot s;
+		s.generation = 0;
+		slots.push_back(s);
+	}
+
+	TweenGroup& g = groups[type];
+	float start_time = float(n - time_base + delay);
+	float duration = std::max<float>(1.0f, millis);
+	slots[slot].group = type;
+	slots[slot].index = g.start.size();
+	g.start.push_back(start_time);
+	g.end.push_back(start_time + duration);
+	g.inv_duration.push_back(1.0f / duration);
+	g.from.push_back(fromValue);
+	g.change.push_back(toValue - fromValue);
+	g.value.push_back(fromValue);
+	g.target.push_back(target);
+	g.slot.push_back(slot);
+	if(target) {
+		*target = fromValue;
+		++g.num_targets;
+	}
+	++num_tweens;
+	return makeHandle(slot);
+}
+
+void TweenBatch::stop(TweenHandle handle) {
+	uint32_t slot;
+	if(!findSlot(handle, slot)) {
+		return;
+	}
+	remove(groups[slots[slot].group], slots[slot].index);
+}
+
+void TweenBatch::clear() {
+	for(int i = 0; i < TWEENBATCH_NUM_TYPES; ++i) {
+		TweenGroup& g = groups[i];
+		while(g.start.size()) {
+			remove(g, g.start.size() - 1);
+		}
+	}
+	finished.clear();
+}
+
+bool TweenBatch::isActive(TweenHandle handle) const {
+	uint32_t slot;
+	return findSlot(handle, slot);
+}
+
+float TweenBatch::getValue(TweenHandle handle) const {
+	uint32_t slot;
+	if(!findSlot(handle, slot)) {
+		return 0.0f;
+	}
+	return groups[slots[slot].group].value[slots[slot].index];
+}
+
+void TweenBatch::update() {
+	update(now());
+}
+
+void TweenBatch::update(uint64_t nowMillis) {
+	finished.clear();
+
+	// the times are floats relative to time_base; keep them small so we
+	// don't lose precision when running for hours.
+	if(nowMillis < time_base || nowMillis - time_base > (1 << 22)) {
+		rebase(nowMillis);
+	}
+	float n = float(nowMillis - time_base);
+
+	for(int type = 0; type < TWEENBATCH_NUM_TYPES; ++type) {
+		TweenGroup& g = groups[type];
+		size_t num = g.start.size();
+		if(!num) {
+			continue;
+		}
+
+		g.p.resize(num);
+		float* p = &g.p[0];
+		const float* start = &g.start[0];
+		const float* inv_duration = &g.inv_duration[0];
+		size_t i = 0;
+#if defined(__SSE2__)
+		const __m128 n4 = _mm_set1_ps(n);
+		const __m128 zero4 = _mm_setzero_ps();
+		const __m128 one4 = _mm_set1_ps(1.0f);
+		for(; i + 4 <= num; i += 4) {
+			__m128 v = _mm_mul_ps(_mm_sub_ps(n4, _mm_loadu_ps(start + i)), _mm_loadu_ps(inv_duration + i));
+			_mm_storeu_ps(p + i, _mm_min_ps(one4, _mm_max_ps(zero4, v)));
+		}
+#endif
+		for(; i < num; ++i) {
+			float v = (n - start[i]) * inv_duration[i];
+			p[i] = std::min<float>(1.0f, std::max<float>(0.0f, v));
+		}
+
+		switch(type) {
+			case TWEEN_LINEAR: break;
+			case TWEEN_IN_QUAD: TWEEN_EASE_SSE(TweenInQuad)(p, num); break;
+			case TWEEN_OUT_QUAD: TWEEN_EASE_SSE(TweenOutQuad)(p, num); break;
+			case TWEEN_INOUT_QUAD: TWEEN_EASE_SSE(TweenInOutQuad)(p, num); break;
+			case TWEEN_IN_CUBIC: TWEEN_EASE_SSE(TweenInCubic)(p, num); break;
+			case TWEEN_OUT_CUBIC: TWEEN_EASE_SSE(TweenOutCubic)(p, num); break;
+			case TWEEN_INOUT_CUBIC: TWEEN_EASE_SSE(TweenInOutCubic)(p, num); break;
+			case TWEEN_IN_QUART: tween_ease<TweenInQuart>(p, num); break;
+			case TWEEN_OUT_QUART: tween_ease<TweenOutQuart>(p, num); break;
+			case TWEEN_INOUT_QUART: tween_ease<TweenInOutQuart>(p, num); break;
+			case TWEEN_IN_QUINT: tween_ease<TweenInQuint>(p, num); break;
+			case TWEEN_OUT_QUINT: tween_ease<TweenOutQuint>(p, num); break;
+			case TWEEN_INOUT_QUINT: tween_ease<TweenInOutQuint>(p, num); break;
+			case TWEEN_IN_EXPO: tween_ease<TweenInExpo>(p, num); break;
+			case TWEEN_OUT_EXPO: tween_ease<TweenOutExpo>(p, num); break;
+			case TWEEN_INOUT_EXPO: tween_ease<TweenInOutExpo>(p, num); break;
+			case TWEEN_IN_CIRC: tween_ease<TweenInCirc>(p, num); break;
+			case TWEEN_OUT_CIRC: tween_ease<TweenOutCirc>(p, num); break;
+			case TWEEN_INOUT_CIRC: tween_ease<TweenInOutCirc>(p, num); break;
+			case TWEEN_IN_SINE: tween_ease<TweenInSine>(p, num); break;
+			case TWEEN_OUT_SINE: tween_ease<TweenOutSine>(p, num); break;
+			case TWEEN_INOUT_SINE: tween_ease<TweenInOutSine>(p, num); break;
+			case TWEEN_IN_BACK: tween_ease<TweenInBack>(p, num); break;
+			case TWEEN_OUT_BACK: tween_ease<TweenOutBack>(p, num); break;
+			case TWEEN_INOUT_BACK: tween_ease<TweenInOutBack>(p, num); break;
+			case TWEEN_IN_ELASTIC: tween_ease<TweenInElastic>(p, num); break;
+			case TWEEN_OUT_ELASTIC: tween_ease<TweenOutElastic>(p, num); break;
+			case TWEEN_INOUT_ELASTIC: tween_ease<TweenInOutElastic>(p, num); break;
+			case TWEEN_IN_BOUNCE: tween_ease<TweenInBounce>(p, num); break;
+			case TWEEN_OUT_BOUNCE: tween_ease<TweenOutBounce>(p, num); break;
+			case TWEEN_INOUT_BOUNCE: tween_ease<TweenInOutBounce>(p, num); break;
+			default: break;
+		}
+
+		float* value = &g.value[0];
+		const float* from = &g.from[0];
+		const float* change = &g.change[0];
+		i = 0;
+#if defined(__SSE2__)
+		for(; i + 4 <= num; i += 4) {
+			__m128 v = _mm_add_ps(_mm_loadu_ps(from + i), _mm_mul_ps(_mm_loadu_ps(change + i), _mm_loadu_ps(p + i)));
+			_mm_storeu_ps(value + i, v);
+		}
+#endif
+		for(; i < num; ++i) {
+			value[i] = from[i] + change[i] * p[i];
+		}
+		if(g.num_targets) {
+			float** target = &g.target[0];
+			for(size_t i = 0; i < num; ++i) {
+				if(target[i]) {
+					*target[i] = value[i];
+				}
+			}
+		}
+
+		// finished tweens end exactly on their end value; we go backwards
+		// because remove() moves the last tween into the removed spot.
+		const float* end = &g.end[0];
+		for(size_t i = num; i > 0; --i) {
+			size_t dx = i - 1;
+			if(n < end[dx]) {
+				continue;
+			}
+			TweenEvent ev;
+			ev.handle = makeHandle(g.slot[dx]);
+			ev.value = g.from[dx] + g.change[dx];
+			ev.target = g.target[dx];
+			if(ev.target) {
+				*ev.target = ev.value;
+			}
+			finished.push_back(ev);
+			remove(g, dx);
+		}
+	}
+}
+
+// Swap with the last tween in the group.
+void TweenBatch::remove(TweenGroup& g, uint32_t index) {
+	uint32_t last = g.start.size() - 1;
+	uint32_t slot = g.slot[index];
+	if(g.target[index]) {
+		--g.num_targets;
+	}
+	if(index != last) {
+		g.start[index] = g.start[last];
+		g.end[index] = g.end[last];
+		g.inv_duration[index] = g.inv_duration[last];
+		g.from[index] = g.from[last];
+		g.change[index] = g.change[last];
+		g.value[index] = g.value[last];
+		g.target[index] = g.target[last];
+		g.slot[index] = g.slot[last];
+		slots[g.slot[index]].index = index;
+	}
+	g.start.pop_back();
+	g.end.pop_back();
+	g.inv_duration.pop_back();
+	g.from.pop_back();
+	g.change.pop_back();
+	g.value.pop_back();
+	g.target.pop_back();
+	g.slot.pop_back();
+
+	slots[slot].group = -1;
+	++slots[slot].generation;
+	free_slots.push_back(slot);
+	--num_tweens;
+}
+
+void TweenBatch::rebase(uint64_t nowMillis) {
+	float offset = float(int64_t(nowMillis - time_base));
+	for(int i = 0; i < TWEENBATCH_NUM_TYPES; ++i) {
+		TweenGroup& g = groups[i];
+		for(size_t j = 0; j < g.start.size(); ++j) {
+			g.start[j] -= offset;
+			g.end[j] -= offset;
+		}
+	}
+	time_base = nowMillis;
+}
@@ -0,0 +1,112 @@
+#ifndef APOLLO_TWEENBATCHH
+#define APOLLO_TWEENBATCHH
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "Tween.h"
+
+#define TWEENBATCH_NUM_TYPES (TWEEN_INOUT_BOUNCE + 1)
+#define TWEENBATCH_INVALID_HANDLE 0xFFFFFFFFFFFFFFFFULL
+
+/*
+
+Animates a lot of floats at once (tens of thousands of particle or UI
+properties per frame).
+
+Tweens are stored per easing type in flat arrays so every update is a
+couple of tight loops per easing type. The position, the polynomial
+easings (quad, cubic) and the interpolation use SSE2 when available;
+the other easings are scalar.
+The clock is read once per update(). You get an integer handle for every
+tween; the handle stays valid until the tween finished or is stopped.
+The tweens which finished in the last update() are returned by
+getFinished() in one batch.
+
+When you pass a target pointer the value is written to it on every update.
+
+	TweenBatch tweens;
+	TweenHandle h = tweens.start(0.0f, 100.0f, 500, 0, TWEEN_OUT_QUAD, &particle.x);
+	...
+	tweens.update();
+	const std::vector<TweenEvent>& done = tweens.getFinished();
+
+Note: the easing equations are normalized versions of the ones in Tween;
+IN_BOUNCE and INOUT_BOUNCE follow Robert Penner's equations.
+
+*/
+
+typedef uint64_t TweenHandle;
+
+struct TweenEvent {
+	TweenHandle handle;
+	float value; // end value
+	float* target;
+};
+
+struct TweenGroup {
+	std::vector<float> start; // millis since TweenBatch::time_base, including delay
+	std::vector<float> end;
+	std::vector<float> inv_duration;
+	std::vector<float> from;
+	std::vector<float> change;
+	std::vector<float> value;
+	std::vector<float*> target;
+	std::vector<uint32_t> slot;
+	std::vector<float> p; // scratch: position, then eased position
+	size_t num_targets;
+};
+
+class TweenBatch {
+public:
+	TweenBatch();
+	TweenHandle start(float fromValue, float toValue, uint64_t millis, uint64_t delay = 0, int type = TWEEN_LINEAR, float* target = NULL);
+	void stop(TweenHandle handle); // no event is generated
+	void clear();
+	void update(); // reads the clock once
+	void update(uint64_t nowMillis);
+	bool isActive(TweenHandle handle) const;
+	float getValue(TweenHandle handle) const; // 0 when not active
+	size_t size() const;
+	const std::vector<TweenEvent>& getFinished() const;
+	static uint64_t now();
+
+private:
+	struct Slot {
+		int group; // -1 = free
+		uint32_t index;
+		uint32_t generation;
+	};
+
+	bool findSlot(TweenHandle handle, uint32_t& slot) const;
+	TweenHandle makeHandle(uint32_t slot) const;
+	void remove(TweenGroup& group, uint32_t index);
+	void rebase(uint64_t nowMillis);
+
+	uint64_t time_base;
+	TweenGroup groups[TWEENBATCH_NUM_TYPES];
+	std::vector<Slot> slots;
+	std::vector<uint32_t> free_slots;
+	std::vector<TweenEvent> finished;
+	size_t num_tweens;
+};
+
+inline const std::vector<TweenEvent>& TweenBatch::getFinished() const {
+	return finished;
+}
+
+inline size_t TweenBatch::size() const {
+	return num_tweens;
+}
+
+// handle = generation (high 32 bits) and slot index (low 32 bits)
+inline TweenHandle TweenBatch::makeHandle(uint32_t slot) const {
+	return ((TweenHandle)slots[slot].generation << 32) | slot;
+}
+
+inline bool TweenBatch::findSlot(TweenHandle handle, uint32_t& slot) const {
+	slot = (uint32_t)handle;
+	return slot < slots.size() && slots[slot].group >= 0 && slots[slot].generation == (uint32_t)(handle >> 32);
+}
+
+#endif
@@ -0,0 +1,391 @@
+#include "ImageLoader.h"
+#include <sys/stat.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace roxlu {
+
+void ImageLoaderTask::run() {
+	loader->execute(this);
+}
+
+ImageLoader::ImageLoader(size_t maxCacheBytes)
+	:lru_first(NULL)
+	,lru_last(NULL)
+	,cache_bytes(0)
+	,max_cache_bytes(maxCacheBytes)
+	,free_buffer_bytes(0)
+	,max_free_buffer_bytes(maxCacheBytes / 4)
+{
+	pthread_mutex_init(&mutex, NULL);
+	pthread_mutex_init(&buffer_mutex, NULL);
+}
+
+ImageLoader::~ImageLoader() {
+	stop();
+	for(size_t i = 0; i < finished.size(); ++i) {
+		delete finished[i];
+	}
+	finished.clear();
+	pending.clear();
+
+	LoadedImage* img = lru_first;
+	while(img) {
+		LoadedImage* next = img->next;
+		delete[] img->pixels;
+		delete img;
+		img = next;
+	}
+	images.clear();
+
+	for(map<size_t, vector<unsigned char*> >::iterator it = free_buffers.begin(); it != free_buffers.end(); ++it) {
+		for(size_t i = 0; i < it->second.size(); ++i) {
+			delete[] it->second[i];
+		}
+	}
+	free_buffers.clear();
+	pthread_mutex_destroy(&buffer_mutex);
+	pthread_mutex_destroy(&mutex);
+}
+
+bool ImageLoader::start(int numThreads) {
+	if(!decoders.size()) {
+		printf("ImageLoader: add a decoder before calling start().\n");
+		return false;
+	}
+	return pool.start(numThreads);
+}
+
+// Finishes the loads which are queued; their listeners are called on the
+// next update().
+void ImageLoader::stop() {
+	pool.stop();
+}
+
+void ImageLoader::addDecoder(ImageDecoder* decoder) {
+	decoders.push_back(decoder);
+}
+
+void ImageLoader::load(const string& filepath, IImageLoaderListener* listener) {
+	// already loading, we only need to tell one more listener.
+	map<string, ImageLoaderTask*>::iterator pit = pending.find(filepath);
+	if(pit != pending.end()) {
+		if(listener) {
+			pit->second->listeners.push_back(listener);
+		}
+		return;
+	}
+
+	ImageLoaderTask* task = new ImageLoaderTask();
+	task->loader = this;
+	task->filepath = filepath;
+	task->file_size = 0;
+	task->file_time = 0;
+	task->result = NULL;
+	if(listener) {
+		task->listeners.push_back(listener);
+	}
+	pending[filepath] = task;
+
+	struct stat info;
+	if(stat(filepath.c_str(), &info) != 0) {
+		printf("ImageLoader: cannot find %s\n", filepath.c_str());
+		pthread_mutex_lock(&mutex);
+		finished.push_back(task);
+		pthread_mutex_unlock(&mutex);
+		return;
+	}
+	task->file_size = info.st_size;
+	task->file_time = info.st_mtime;
+
+	// when the file didn't change we can use the cached image right away.
+	pthread_mutex_lock(&mutex);
+	map<string, FileInfo>::iterator fit = files.find(filepath);
+	if(fit != files.end() && fit->second.size == task->file_size && fit->second.time == task->file_time) {
+		LoadedImage* img = findImage(fit->second.key);
+		if(img) {
+			++img->refcount;
+			touchImage(img);
+			task->result = img;
+			finished.push_back(task);
+			pthread_mutex_unlock(&mutex);
+			return;
+		}
+	}
+	pthread_mutex_unlock(&mutex);
+
+	pool.add(task);
+}
+
+void ImageLoader::update() {
+	pthread_mutex_lock(&mutex);
+	finished_copy.swap(finished);
+	pthread_mutex_unlock(&mutex);
+
+	for(size_t i = 0; i < finished_copy.size(); ++i) {
+		ImageLoaderTask* task = finished_copy[i];
+		map<string, ImageLoaderTask*>::iterator pit = pending.find(task->filepath);
+		if(pit != pending.end() && pit->second == task) {
+			pending.erase(pit);
+		}
+
+		if(task->result) {
+			// the task holds one reference, every listener gets one.
+			pthread_mutex_lock(&mutex);
+			task->result->refcount += task->listeners.size();
+			pthread_mutex_unlock(&mutex);
+			for(size_t j = 0; j < task->listeners.size(); ++j) {
+				task->listeners[j]->onImageLoaded(task->result);
+			}
+			release(task->result);
+		}
+		else {
+			for(size_t j = 0; j < task->listeners.size(); ++j) {
+				task->listeners[j]->onImageFailed(task->filepath);
+			}
+		}
+		delete task;
+	}
+	finished_copy.clear();
+}
+
+void ImageLoader::release(LoadedImage* image) {
+	pthread_mutex_lock(&mutex);
+	--image->refcount;
+	if(image->refcount == 0 && cache_bytes > max_cache_bytes) {
+		trimCache();
+	}
+	pthread_mutex_unlock(&mutex);
+}
+
+void ImageLoader::setMaxCacheBytes(size_t bytes) {
+	// freeBuffer() reads this on the worker threads
+	pthread_mutex_lock(&buffer_mutex);
+	max_free_buffer_bytes = bytes / 4;
+	pthread_mutex_unlock(&buffer_mutex);
+
+	pthread_mutex_lock(&mutex);
+	max_cache_bytes = bytes;
+	trimCache();
+	pthread_mutex_unlock(&mutex);
+}
+
+// -----------------------------------------------------------------------------
+
+void ImageLoader::execute(ImageLoaderTask* task) {
+	unsigned char* data = NULL;
+	size_t size = 0;
+	size_t capacity = 0;
+	if(!readFile(task->filepath, data, size, capacity)) {
+		pthread_mutex_lock(&mutex);
+		finished.push_back(task);
+		pthread_mutex_unlock(&mutex);
+		return;
+	}
+
+	FileInfo info;
+	info.size = task->file_size;
+	info.time = task->file_time;
+	info.key = hash(data, size);
+
+	pthread_mutex_lock(&mutex);
+	LoadedImage* img = findImage(info.key);
+	if(img) {
+		++img->refcount;
+		touchImage(img);
+		files[task->filepath] = info;
+	}
+	pthread_mutex_unlock(&mutex);
+
+	if(!img) {
+		for(size_t i = 0; i < decoders.size(); ++i) {
+			if(!decoders[i]->canDecode(data, size)) {
+				continue;
+			}
+			LoadedImage* decoded = new LoadedImage();
+			memset(decoded, 0, sizeof(LoadedImage));
+			if(!decoders[i]->decode(data, size, *this, *decoded)) {
+				if(decoded->pixels) {
+					freeBuffer(decoded->pixels, decoded->capacity);
+				}
+				delete decoded;
+				continue; // another decoder may handle it
+			}
+			decoded->key = info.key;
+			decoded->refcount = 1;
+
+			// another thread may have decoded the same contents.
+			pthread_mutex_lock(&mutex);
+			img = findImage(info.key);
+			if(img) {
+				++img->refcount;
+				touchImage(img);
+			}
+			else {
+				img = decoded;
+				addImage(img);
+				trimCache();
+			}
+			files[task->filepath] = info;
+			pthread_mutex_unlock(&mutex);
+
+			if(img != decoded) {
+				freeBuffer(decoded->pixels, decoded->capacity);
+				delete decoded;
+			}
+			break;
+		}
+		if(!img) {
+			printf("ImageLoader: cannot decode %s\n", task->filepath.c_str());
+		}
+	}
+	freeBuffer(data, capacity);
+
+	pthread_mutex_lock(&mutex);
+	task->result = img;
+	finished.push_back(task);
+	pthread_mutex_unlock(&mutex);
+}
+
+bool ImageLoader::readFile(const string& filepath, unsigned char*& data, size_t& size, size_t& capacity) {
+	FILE* fp = fopen(filepath.c_str(), "rb");
+	if(!fp) {
+		printf("ImageLoader: cannot open %s\n", filepath.c_str());
+		return false;
+	}
+	fseek(fp, 0, SEEK_END);
+	long len = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	if(len <= 0) {
+		fclose(fp);
+		return false;
+	}
+	size = len;
+	data = allocBuffer(size, capacity);
+	bool ok = (fread(data, size, 1, fp) == 1);
+	fclose(fp);
+	if(!ok) {
+		printf("ImageLoader: cannot read %s\n", filepath.c_str());
+		freeBuffer(data, capacity);
+		data = NULL;
+		return false;
+	}
+	return true;
+}
+
+uint64_t ImageLoader::hash(const unsigned char* data, size_t size) {
+	uint64_t h = 14695981039346656037ULL;
+	size_t i = 0;
+	for(; i + 8 <= size; i += 8) {
+		uint64_t v;
+		memcpy(&v, data + i, 8);
+		h = (h ^ v) * 1099511628211ULL;
+		h ^= h >> 29;
+	}
+	for(; i < size; ++i) {
+		h = (h ^ data[i]) * 1099511628211ULL;
+	}
+	return h ^ size;
+}
+
+// -----------------------------------------------------------------------------
+
+LoadedImage* ImageLoader::findImage(uint64_t key) {
+	map<uint64_t, LoadedImage*>::iterator it = images.find(key);
+	return (it == images.end()) ? NULL : it->second;
+}
+
+void ImageLoader::addImage(LoadedImage* img) {
+	images[img->key] = img;
+	cache_bytes += img->capacity;
+	img->prev = NULL;
+	img->next = lru_first;
+	if(lru_first) {
+		lru_first->prev = img;
+	}
+	lru_first = img;
+	if(!lru_last) {
+		lru_last = img;
+	}
+}
+
+void ImageLoader::touchImage(LoadedImage* img) {
+	if(img == lru_first) {
+		return;
+	}
+	img->prev->next = img->next;
+	if(img->next) {
+		img->next->prev = img->prev;
+	}
+	else {
+		lru_last = img->prev;
+	}
+	img->prev = NULL;
+	img->next = lru_first;
+	lru_first->prev = img;
+	lru_first = img;
+}
+
+// Removes the least recently used images which are not in use.
+void ImageLoader::trimCache() {
+	LoadedImage* img = lru_last;
+	while(img && cache_bytes > max_cache_bytes) {
+		LoadedImage* prev = img->prev;
+		if(img->refcount == 0) {
+			if(img->prev) {
+				img->prev->next = img->next;
+			}
+			else {
+				lru_first = img->next;
+			}
+			if(img->next) {
+				img->next->prev = img->prev;
+			}
+			else {
+				lru_last = img->prev;
+			}
+			images.erase(img->key);
+			cache_bytes -= img->capacity;
+			freeBuffer(img->pixels, img->capacity);
+			delete img;
+		}
+		img = prev;
+	}
+}
+
+// -----------------------------------------------------------------------------
+
+// Buffers are rounded up to 1/8th of their highest bit, so images with
+// about the same size share buffers without wasting much memory.
+unsigned char* ImageLoader::allocBuffer(size_t size, size_t& capacity) {
+	size_t step = 4096;
+	while((step << 3) < size) {
+		step <<= 1;
+	}
+	capacity = ((size + step - 1) / step) * step;
+
+	pthread_mutex_lock(&buffer_mutex);
+	map<size_t, vector<unsigned char*> >::iterator it = free_buffers.find(capacity);
+	if(it != free_buffers.end() && it->second.size()) {
+		unsigned char* buffer = it->second.back();
+		it->second.pop_back();
+		free_buffer_bytes -= capacity;
+		pthread_mutex_unlock(&buffer_mutex);
+		return buffer;
+	}
+	pthread_mutex_unlock(&buffer_mutex);
+	return new unsigned char[capacity];
+}
+
+void ImageLoader::freeBuffer(unsigned char* buffer, size_t capacity) {
+	pthread_mutex_lock(&buffer_mutex);
+	if(free_buffer_bytes + capacity <= max_free_buffer_bytes) {
+		free_buffers[capacity].push_back(buffer);
+		free_buffer_bytes += capacity;
+		buffer = NULL;
+	}
+	pthread_mutex_unlock(&buffer_mutex);
+	delete[] buffer;
+}
+
+} // roxlu
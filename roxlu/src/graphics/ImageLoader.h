@@ -0,0 +1,156 @@
+#ifndef ROXLU_IMAGELOADERH
+#define ROXLU_IMAGELOADERH
+
+#include <pthread.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+#include "ThreadPool.h"
+
+using std::string;
+using std::vector;
+using std::map;
+
+/**
+ * Loads and decodes images on a couple of threads, so you can keep on
+ * drawing while they load (e.g. a slideshow which shows hundreds of
+ * images per minute).
+ *
+ * The decoded images are kept in a cache with a maximum size in bytes;
+ * when it's full the least recently used images which aren't in use are
+ * removed. The cache is keyed by the contents of the file, so the same
+ * image under two names is decoded once; when a file didn't change (same
+ * size and modification time) it isn't even read again. The pixels of
+ * removed images go back into a pool of buffers which is used for the
+ * next images.
+ *
+ * The decoding itself is done by ImageDecoder objects which you add with
+ * addDecoder() (see WebPImageDecoder in the WebP addon); they're tried in
+ * the order they were added until one decodes the file. The listeners
+ * are called from update(), so call it from your main thread every frame.
+ * You get an image with a reference which you give back with release(),
+ * for example after you uploaded the pixels to a texture.
+ *
+ *		class Slideshow : public roxlu::IImageLoaderListener {
+ *			void onImageLoaded(roxlu::LoadedImage* img) {
+ *				tex.setPixels(img->pixels, img->width, img->height, GL_RGBA);
+ *				loader.release(img);
+ *			}
+ *			void onImageFailed(const string& filepath) {}
+ *		};
+ *
+ *		roxlu::WebPImageDecoder webp;
+ *		loader.addDecoder(&webp);
+ *		loader.start();
+ *		loader.load(File::toDataPath("photo.webp"), &slideshow);
+ *		...
+ *		loader.update(); // in your update()
+ *
+ */
+namespace roxlu {
+
+class ImageLoader;
+
+struct LoadedImage {
+	uint64_t key; // hash of the file contents
+	unsigned char* pixels;
+	int width;
+	int height;
+	int bytes_per_pixel;
+	size_t capacity; // size of the pixel buffer
+	int refcount; // not removed from the cache while > 0
+	LoadedImage* prev; // lru list, most recently used first
+	LoadedImage* next;
+};
+
+class ImageDecoder {
+public:
+	virtual ~ImageDecoder() {}
+	virtual bool canDecode(const unsigned char* data, size_t size) = 0;
+
+	// Called on a worker thread. Allocate the pixels with loader.allocBuffer()
+	// and set pixels, width, height, bytes_per_pixel and capacity.
+	virtual bool decode(const unsigned char* data, size_t size, ImageLoader& loader, LoadedImage& result) = 0;
+};
+
+class IImageLoaderListener {
+public:
+	virtual void onImageLoaded(LoadedImage* image) = 0; // call ImageLoader::release() when done
+	virtual void onImageFailed(const string& filepath) = 0;
+};
+
+struct ImageLoaderTask : public ThreadTask {
+	void run();
+	ImageLoader* loader;
+	string filepath;
+	vector<IImageLoaderListener*> listeners;
+	uint64_t file_size;
+	int64_t file_time;
+	LoadedImage* result;
+};
+
+class ImageLoader {
+public:
+	ImageLoader(size_t maxCacheBytes = 256 * 1024 * 1024);
+	~ImageLoader();
+	bool start(int numThreads = 0);
+	void stop();
+	void addDecoder(ImageDecoder* decoder); // add before start(), not owned
+	void load(const string& filepath, IImageLoaderListener* listener);
+	void update(); // calls the listeners of the finished loads
+	void release(LoadedImage* image);
+	void setMaxCacheBytes(size_t bytes);
+	inline size_t getCacheBytes() const;
+	inline size_t getNumPending() const;
+
+	// pooled buffers, thread safe
+	unsigned char* allocBuffer(size_t size, size_t& capacity);
+	void freeBuffer(unsigned char* buffer, size_t capacity);
+
+private:
+	struct FileInfo {
+		uint64_t size;
+		int64_t time;
+		uint64_t key;
+	};
+
+	void execute(ImageLoaderTask* task); // worker thread
+	bool readFile(const string& filepath, unsigned char*& data, size_t& size, size_t& capacity);
+	static uint64_t hash(const unsigned char* data, size_t size);
+	LoadedImage* findImage(uint64_t key); // call with the mutex locked
+	void addImage(LoadedImage* image); // call with the mutex locked
+	void touchImage(LoadedImage* image); // call with the mutex locked
+	void trimCache(); // call with the mutex locked
+
+	ThreadPool pool;
+	vector<ImageDecoder*> decoders;
+	pthread_mutex_t mutex; // cache, files and finished
+	pthread_mutex_t buffer_mutex;
+	map<uint64_t, LoadedImage*> images;
+	map<string, FileInfo> files;
+	map<string, ImageLoaderTask*> pending; // by filepath, only used on the main thread
+	vector<ImageLoaderTask*> finished;
+	vector<ImageLoaderTask*> finished_copy;
+	map<size_t, vector<unsigned char*> > free_buffers; // by capacity
+	LoadedImage* lru_first;
+	LoadedImage* lru_last;
+	size_t cache_bytes;
+	size_t max_cache_bytes;
+	size_t free_buffer_bytes;
+	size_t max_free_buffer_bytes;
+
+	friend struct ImageLoaderTask;
+};
+
+inline size_t ImageLoader::getCacheBytes() const {
+	return cache_bytes;
+}
+
+inline size_t ImageLoader::getNumPending() const {
+	return pending.size();
+}
+
+} // roxlu
+
+#endif
@@ -141,8 +141,7 @@ bool IOBuffer::moveData() {
 
 void IOBuffer::cleanup() {
 	if(buffer != NULL) {
-		//printf("* need to free memory in iobuffer \n");
-		//delete[] buffer;
+		delete[] buffer;
 		buffer = NULL;
 	}	
 	size = 0;
@@ -2,46 +2,44 @@
 #define ROXLU_RANDOMH
 
 // random: source openFrameworks + stackoverflow
+// The functions below use the generator of the calling thread, see 
+// RandomGenerator.h; use a RandomGenerator directly for bulk fills and
+// other distributions.
 
 #include "float.h"
 #include <sys/time.h>
+#include <unistd.h>
+#include "RandomGenerator.h"
 
 static void initRandom() {
 	struct timeval tv;
 	gettimeofday(&tv, 0);
 	long int n = (tv.tv_sec ^ tv.tv_usec) ^ getpid();
 	srand(n);
+	roxlu::RandomGenerator::seedThreads(n);
 }
 
 static void initRandom(int val) {
 	srand((long) val);
+	roxlu::RandomGenerator::seedThreads(val);
 }
 
 static float random(float max) {
-	return max * rand() / (RAND_MAX + 1.0f);
+	return max * roxlu::RandomGenerator::getThreadGenerator().uniform();
 }
 
 static float random(float x, float y) {
-	float high = 0;
-	float low = 0;
-	float result = 0;
-	
-	high = MAX(x,y);
-	low = MIN(x,y);
-	result = low + ((high-low) * rand()/(RAND_MAX + 1.0));
-	return result;
+	float high = MAX(x,y);
+	float low = MIN(x,y);
+	return roxlu::RandomGenerator::getThreadGenerator().uniform(low, high);
 }
 
 static float randomf() {
-	float rand_num = 0;
-	rand_num = (rand()/(RAND_MAX + 1.0)) * 2.0 - 1.0;
-	return rand_num;
+	return roxlu::RandomGenerator::getThreadGenerator().signedUniform();
 }
 
 static float randomuf() {
-	float rand_num = 0;
-	rand_num = rand()/(RAND_MAX + 1.0);
-	return rand_num;
+	return roxlu::RandomGenerator::getThreadGenerator().uniform();
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,174 @@
+#include "RandomGenerator.h"
+#include <pthread.h>
+#include <stdio.h>
+
+namespace roxlu {
+
+// state of the thread generators.
+static pthread_key_t random_thread_key;
+static pthread_once_t random_thread_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t random_thread_mutex = PTHREAD_MUTEX_INITIALIZER;
+static volatile uint32_t random_thread_generation = 1;
+
+static void random_thread_free(void* gen) {
+	delete static_cast<RandomGenerator*>(gen);
+}
+
+static void random_thread_create_key() {
+	if(pthread_key_create(&random_thread_key, random_thread_free) != 0) {
+		printf("RandomGenerator: cannot create thread key.\n");
+	}
+}
+
+// splitmix64, used to spread the seed over the state.
+static uint64_t random_splitmix(uint64_t& x) {
+	uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+RandomGenerator::RandomGenerator(uint64_t seed)
+	:spare(0.0f)
+	,has_spare(false)
+	,generation(0)
+{
+	this->seed(seed);
+}
+
+void RandomGenerator::seed(uint64_t seed) {
+	uint64_t a = random_splitmix(seed);
+	uint64_t b = random_splitmix(seed);
+	s[0] = (uint32_t)a;
+	s[1] = (uint32_t)(a >> 32);
+	s[2] = (uint32_t)b;
+	s[3] = (uint32_t)(b >> 32);
+	if((s[0] | s[1] | s[2] | s[3]) == 0) {
+		s[0] = 1;
+	}
+	has_spare = false;
+}
+
+void RandomGenerator::jump() {
+	static const uint32_t JUMP[] = { 0x8764000b, 0xf542d2d3, 0x6fa035c3, 0x77f2db5b };
+	uint32_t s0 = 0;
+	uint32_t s1 = 0;
+	uint32_t s2 = 0;
+	uint32_t s3 = 0;
+	for(int i = 0; i < 4; ++i) {
+		for(int b = 0; b < 32; ++b) {
+			if(JUMP[i] & (1u << b)) {
+				s0 ^= s[0];
+				s1 ^= s[1];
+				s2 ^= s[2];
+				s3 ^= s[3];
+			}
+			next();
+		}
+	}
+	s[0] = s0;
+	s[1] = s1;
+	s[2] = s2;
+	s[3] = s3;
+	has_spare = false;
+}
+
+// Marsaglia polar method
+float RandomGenerator::normal(float mean, float stddev) {
+	if(has_spare) {
+		has_spare = false;
+		return mean + stddev * spare;
+	}
+	float u, v, d;
+	do {
+		u = signedUniform();
+		v = signedUniform();
+		d = u * u + v * v;
+	} while(d >= 1.0f || d == 0.0f);
+	float m = sqrtf(-2.0f * logf(d) / d);
+	spare = v * m;
+	has_spare = true;
+	return mean + stddev * u * m;
+}
+
+Vec2 RandomGenerator::onCircle(float radius) {
+	float a = uniform() * 6.283185307f;
+	return Vec2(cosf(a) * radius, sinf(a) * radius);
+}
+
+// uniform z and angle; no rejection needed.
+Vec3 RandomGenerator::onSphere(float radius) {
+	float z = signedUniform();
+	float a = uniform() * 6.283185307f;
+	float r = sqrtf(1.0f - z * z) * radius;
+	return Vec3(cosf(a) * r, sinf(a) * r, z * radius);
+}
+
+void RandomGenerator::fill(float* dest, size_t num, float min, float max) {
+	float scale = (max - min) * (1.0f / 16777216.0f);
+	for(size_t i = 0; i < num; ++i) {
+		dest[i] = min + (next() >> 8) * scale;
+	}
+}
+
+void RandomGenerator::fill(Vec2* dest, size_t num, const Vec2& min, const Vec2& max) {
+	for(size_t i = 0; i < num; ++i) {
+		dest[i].x = uniform(min.x, max.x);
+		dest[i].y = uniform(min.y, max.y);
+	}
+}
+
+void RandomGenerator::fill(Vec3* dest, size_t num, const Vec3& min, const Vec3& max) {
+	for(size_t i = 0; i < num; ++i) {
+		dest[i].x = uniform(min.x, max.x);
+		dest[i].y = uniform(min.y, max.y);
+		dest[i].z = uniform(min.z, max.z);
+	}
+}
+
+void RandomGenerator::fillNormal(float* dest, size_t num, float mean, float stddev) {
+	for(size_t i = 0; i < num; ++i) {
+		dest[i] = normal(mean, stddev);
+	}
+}
+
+void RandomGenerator::fillOnSphere(Vec3* dest, size_t num, float radius) {
+	for(size_t i = 0; i < num; ++i) {
+		dest[i] = onSphere(radius);
+	}
+}
+
+RandomGenerator& RandomGenerator::getThreadGenerator() {
+	pthread_once(&random_thread_once, random_thread_create_key);
+	RandomGenerator* gen = static_cast<RandomGenerator*>(pthread_getspecific(random_thread_key));
+	if(gen == NULL) {
+		gen = new RandomGenerator();
+		pthread_setspecific(random_thread_key, gen);
+	}
+	if(gen->generation != random_thread_generation) {
+		// take the next stream: one jump of the master per new thread.
+		RandomGenerator& master = getThreadMaster();
+		pthread_mutex_lock(&random_thread_mutex);
+		master.jump();
+		*gen = master;
+		gen->generation = random_thread_generation;
+		pthread_mutex_unlock(&random_thread_mutex);
+	}
+	return *gen;
+}
+
+void RandomGenerator::seedThreads(uint64_t seed) {
+	RandomGenerator& master = getThreadMaster();
+	pthread_mutex_lock(&random_thread_mutex);
+	master.seed(seed);
+	__sync_fetch_and_add(&random_thread_generation, 1);
+	pthread_mutex_unlock(&random_thread_mutex);
+}
+
+// The generator the thread streams are jumped from; guarded by random_thread_mutex.
+RandomGenerator& RandomGenerator::getThreadMaster() {
+	static RandomGenerator master;
+	return master;
+}
+
+} // roxlu
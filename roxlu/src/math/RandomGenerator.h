@@ -0,0 +1,95 @@
+#ifndef ROXLU_RANDOMGENERATORH
+#define ROXLU_RANDOMGENERATORH
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+#include "Vec2.h"
+#include "Vec3.h"
+
+/**
+ * Small, fast pseudo random number generator (xoshiro128**) with
+ * helpers for the distributions we use most.
+ *
+ * Every generator has its own state, so you can use one per thread
+ * without locking. getThreadGenerator() returns the generator of the
+ * calling thread; these are created on first use and each thread gets
+ * its own stream: a shared generator, seeded with seedThreads(), is
+ * jumped once for every new thread and copied into the thread's own
+ * generator. The random() functions in Random.h use it.
+ *
+ * For deterministic parallel work create a generator with a fixed seed
+ * and jump() it once per range/thread; every jump skips 2^64 numbers so
+ * the streams will never overlap.
+ *
+ *		RandomGenerator gen(1234);
+ *		gen.fillOnSphere(&particles[0], particles.size(), 10.0f);
+ *
+ */
+namespace roxlu {
+
+class RandomGenerator {
+public:
+	RandomGenerator(uint64_t seed = 5489);
+	void seed(uint64_t seed);
+	void jump(); // skip 2^64 numbers
+
+	inline uint32_t next();
+	inline float uniform(); // [0, 1)
+	inline float uniform(float min, float max); // [min, max)
+	inline float signedUniform(); // [-1, 1)
+	float normal(float mean = 0.0f, float stddev = 1.0f);
+	Vec2 onCircle(float radius = 1.0f);
+	Vec3 onSphere(float radius = 1.0f);
+
+	// bulk fill
+	void fill(float* dest, size_t num, float min = 0.0f, float max = 1.0f);
+	void fill(Vec2* dest, size_t num, const Vec2& min, const Vec2& max);
+	void fill(Vec3* dest, size_t num, const Vec3& min, const Vec3& max);
+	void fillNormal(float* dest, size_t num, float mean = 0.0f, float stddev = 1.0f);
+	void fillOnSphere(Vec3* dest, size_t num, float radius = 1.0f);
+
+	static RandomGenerator& getThreadGenerator();
+	static void seedThreads(uint64_t seed); // reseeds the generators of all threads on their next use
+
+private:
+	static inline uint32_t rotl(uint32_t x, int k);
+	static RandomGenerator& getThreadMaster();
+
+	uint32_t s[4];
+	float spare; // normal() generates two values at once
+	bool has_spare;
+	uint32_t generation; // used by getThreadGenerator()
+};
+
+inline uint32_t RandomGenerator::rotl(uint32_t x, int k) {
+	return (x << k) | (x >> (32 - k));
+}
+
+inline uint32_t RandomGenerator::next() {
+	uint32_t result = rotl(s[1] * 5, 7) * 9;
+	uint32_t t = s[1] << 9;
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rotl(s[3], 11);
+	return result;
+}
+
+inline float RandomGenerator::uniform() {
+	return (next() >> 8) * (1.0f / 16777216.0f);
+}
+
+inline float RandomGenerator::uniform(float min, float max) {
+	return min + (max - min) * uniform();
+}
+
+inline float RandomGenerator::signedUniform() {
+	return uniform() * 2.0f - 1.0f;
+}
+
+} // roxlu
+
+#endif